@@ -11,7 +11,14 @@ enum okon_prepare_result
   okon_prepare_result_could_not_open_intermediate_files, //!< Issue while creating intermediate
                                                          //!< files.
   okon_prepare_result_could_not_open_output,             //!< Issue while creating output file.
-  okon_prepare_result_unspecified_failure                //!< Unspecified failure occurred
+  okon_prepare_result_unspecified_failure,               //!< Unspecified failure occurred
+  okon_prepare_result_input_not_sorted,                  //!< Hashes of the input file are not
+                                                         //!< sorted. See okon_merge().
+  okon_prepare_result_incompatible_input                 //!< A prepared input file has other hash
+                                                         //!< type or shorter fingerprints than the
+                                                         //!< output, or has been prepared by a
+                                                         //!< newer okon version with features this
+                                                         //!< one doesn't know.
 };
 
 enum okon_prepare_progress_special_value
@@ -30,12 +37,14 @@ enum okon_prepare_progress_special_value
  */
 typedef void (*okon_prepare_progress_callback_t)(void* user_data, int progress);
 
-/** Prepares file based on input database.
- * Truncates 00-FF files in @param working_directory.
+/** Prepares file based on input database. The file has the legacy layout, see
+ * okon_prepare_with_options() for the others.
+ * Truncates 00-FF and btree files in @param working_directory.
  * Truncates @param output_processed_file_path file.
  * The function does not delete intermediate files. User needs to do it on their own.
  *
- * @param input_db_file_path Path to text file with hashes:count.
+ * @param input_db_file_path Path to text file with hashes:count. Hashes are SHA-1, unless
+ * okon_prepare_options::hash_type says otherwise.
  * @param working_directory Directory where intermediate files are going to be created.
  * @param output_processed_file_path Path to file where output data should be written to.
  * @param progress_callback Callback function to report progress. Optional parameter.
@@ -47,6 +56,155 @@ okon_prepare_result okon_prepare(const char* input_db_file_path, const char* wor
                                  okon_prepare_progress_callback_t progress_callback,
                                  void* progress_callback_user_data);
 
+/** Layout of the prepared file. The legacy one is the default, so files prepared by okon_prepare()
+ * can be read by every okon version. The compact one needs to be requested.
+ */
+enum okon_prepare_format
+{
+  okon_prepare_format_legacy, //!< Layout of files prepared by the first okon versions. Every node
+                              //!< stores all pointers.
+  okon_prepare_format_compact //!< Leaves store only keys, nodes don't store parent pointers.
+                              //!< Files can't be read by okon versions older than the layout.
+};
+
+enum okon_hash_type
+{
+  okon_hash_type_sha1,  //!< 20 bytes, 40 hex characters.
+  okon_hash_type_ntlm,  //!< 16 bytes, 32 hex characters.
+  okon_hash_type_sha256 //!< 32 bytes, 64 hex characters.
+};
+
+struct okon_prepare_stats
+{
+  unsigned long long keys_count; //!< Number of hashes stored in the prepared file.
+
+  /** Probability that a lookup of a hash that is not in the database reports that the hash exists.
+   * Zero, unless okon_prepare_options::fingerprint_size is used.
+   */
+  double false_positive_rate;
+
+  /** Number of input hashes that were not stored, because they are copies of other input hashes
+   * (or, with okon_prepare_options::fingerprint_size, have the same fingerprint).
+   */
+  unsigned long long duplicates_count;
+
+  /** Number of input lines that were skipped, because they don't start with a hex hash. */
+  unsigned long long invalid_lines_count;
+};
+
+struct okon_prepare_options
+{
+  /** Layout of the prepared file. Files of every layout can be searched in.
+   * okon_prepare_format_compact produces a ~17% smaller file, with less data read per lookup. It
+   * needs additional space in the working directory, for an intermediate file of a size of the
+   * output file.
+   */
+  okon_prepare_format format;
+
+  /** If non-zero, every leaf stores the prefix common to all its keys only once. Keys of a leaf
+   * are searched without decompressing them. Makes the file smaller, the more keys the file has,
+   * the bigger the gain. Used only with okon_prepare_format_compact.
+   */
+  int compress_leaves;
+
+  /** If non-zero and less than the width of the hash, only the first fingerprint_size bytes of
+   * every hash are stored and compared by lookups. It makes the file up to
+   * width / fingerprint_size times smaller, at the cost
+   * of false positives: for n hashes, a hash that is not in the database is reported as existing
+   * with the probability of about n / 2^(8 * fingerprint_size). E.g. for 600M hashes and 8 byte
+   * fingerprints it's ~3.3e-11. Zero means that whole hashes are stored. Used only with
+   * okon_prepare_format_compact.
+   */
+  unsigned fingerprint_size;
+
+  /** Where to write statistics of the preparation to. Optional parameter, written only if the
+   * preparation succeeded.
+   */
+  okon_prepare_stats* stats;
+
+  /** Type of the hashes in the input file. The width of the hashes is stored in the prepared file,
+   * lookups take it from there. Hashes other than SHA-1 are always prepared with
+   * okon_prepare_format_compact.
+   */
+  okon_hash_type hash_type;
+
+  /** If non-zero, the file is a B+ tree: all hashes are stored in leaves, which are laid out in
+   * order, one after another. Range queries (okon_handle_for_each_with_prefix()) and reading all
+   * hashes read the leaves sequentially. Such a file is built in one pass, without an intermediate
+   * file in the working directory, and has about the same size. Used only with
+   * okon_prepare_format_compact.
+   */
+  int bplus_tree;
+
+  /** If non-zero, every node starts with a summary of its keys: the first 8 bytes of every 32nd
+   * key, 256 bytes for a full node. Lookups search the summary first and then only the keys
+   * between two of its entries. With okon_open_options::partial_node_reads they read the summary
+   * and one small range of keys per node, instead of a couple of single keys and 4KB of them.
+   * Leaves compressed with compress_leaves have no summaries. Used only with
+   * okon_prepare_format_compact.
+   */
+  int node_summaries;
+};
+
+/** Prepares file based on input database. Works the same as okon_prepare() but allows to pass
+ * additional options.
+ *
+ * @param options Preparation options. Optional parameter. If NULL, the default options (the same
+ * as zero-initialized okon_prepare_options) are used.
+ *
+ * @sa okon_prepare.
+ */
+okon_prepare_result okon_prepare_with_options(const char* input_db_file_path,
+                                              const char* working_directory,
+                                              const char* output_processed_file_path,
+                                              const okon_prepare_options* options,
+                                              okon_prepare_progress_callback_t progress_callback,
+                                              void* progress_callback_user_data);
+
+/** Merges a file prepared by okon_prepare() with a text file of hashes, e.g. new hashes or a newer
+ * database, into a new prepared file. Both files are read once, in order, and nothing is sorted,
+ * so it's much faster than preparing the whole database again. The new file has the layout,
+ * the options and the hash type of the prepared one. Hashes that are in both files are stored
+ * once. Truncates btree file in @param working_directory and @param output_processed_file_path.
+ *
+ * @param prepared_file_path Path to a file prepared by okon_prepare() function.
+ * @param input_db_file_path Path to text file with hashes:count. Hashes have to be sorted, like in
+ * the databases ordered by hash. If they're not, okon_prepare_result_input_not_sorted is returned.
+ * Lines that don't start with a hex hash are skipped, like by okon_prepare().
+ * @param working_directory Directory where an intermediate file is going to be created.
+ * @param output_processed_file_path Path to file where output data should be written to. It has to
+ * be other than @param prepared_file_path.
+ * @param progress_callback Callback function to report progress. Optional parameter.
+ * @param progress_callback_user_data Pointer to user data to be passed to progress callback
+ * function. If @param progress_callback is NULL, this parameter is not used.
+ */
+okon_prepare_result okon_merge(const char* prepared_file_path, const char* input_db_file_path,
+                               const char* working_directory,
+                               const char* output_processed_file_path,
+                               okon_prepare_progress_callback_t progress_callback,
+                               void* progress_callback_user_data);
+
+/** Prepares one file based on many input databases. Works the same as okon_prepare_with_options()
+ * but takes many text files and already prepared files. Hashes of all of them are combined into
+ * one tree, without duplicates, so a lookup needs to search in one file only. Keys of prepared
+ * files are merged in without sorting them again.
+ *
+ * @param input_db_file_paths Paths to text files with hashes:count. Can be NULL if
+ * @param input_db_files_count is 0.
+ * @param prepared_file_paths Paths to files prepared by okon_prepare() function. They need to have
+ * the hash type of okon_prepare_options::hash_type, and store at least as many bytes of every hash
+ * as the output does (see okon_prepare_options::fingerprint_size). Can be NULL if
+ * @param prepared_files_count is 0.
+ *
+ * @sa okon_prepare_with_options.
+ */
+okon_prepare_result okon_prepare_multiple(
+  const char* const* input_db_file_paths, unsigned input_db_files_count,
+  const char* const* prepared_file_paths, unsigned prepared_files_count,
+  const char* working_directory, const char* output_processed_file_path,
+  const okon_prepare_options* options, okon_prepare_progress_callback_t progress_callback,
+  void* progress_callback_user_data);
+
 enum okon_exists_result
 {
   okon_exists_result_doesnt_exist,         //!< Hash was not found.
@@ -56,19 +214,333 @@ enum okon_exists_result
 
 /** Checks whether given hash exists in @param processed_file_path.
  *
- * @param sha1 Text based hash. The behavior is undefined if (sha1 + 39) is not accessible.
+ * @param sha1 Text based hash of the type the file has been prepared for. The behavior is undefined
+ * if the hash has less characters than the type needs, e.g. 40 for SHA-1.
  * @param prepared_file_path Path to a file prepared by okon_prepare() function.
  */
 okon_exists_result okon_exists_text(const char* sha1, const char* prepared_file_path);
 
 /** Checks whether given hash exists in @param processed_file_path.
  *
- * @param sha1 Binary based hash. The behavior is undefined if ((const uint8_t*)sha1 + 19) is not
- * accessible.
+ * @param sha1 Binary based hash of the type the file has been prepared for. The behavior is
+ * undefined if the hash has less bytes than the type needs, e.g. 20 for SHA-1.
  * @param prepared_file_path Path to a file prepared by okon_prepare() function.
  */
 okon_exists_result okon_exists_binary(const void* sha1, const char* processed_file_path);
 
+/** Handle to an opened prepared file. Keeping a handle open across many lookups avoids opening
+ * the file and reading the root node on every call.
+ */
+struct okon_handle;
+
+struct okon_open_options
+{
+  /** Memory budget in bytes for the cache of B-tree nodes. The cache is shared by all lookups done
+   * through the handle. Two upper levels of the tree are kept in the cache for the whole lifetime
+   * of the handle (if they fit in half of the budget). Zero disables the cache.
+   */
+  unsigned long long node_cache_size;
+
+  /** If non-zero, the checksum of the header and the size of the file are checked on open, which
+   * doesn't read the tree. See okon_verify(). Files without checksums pass the check.
+   */
+  int verify_header;
+
+  /** If non-zero, all inner nodes of the tree are read into memory on open, so lookups read only
+   * one leaf from the file. They take ~1/order of the file, see okon_handle_pinned_size(). Files
+   * prepared in the legacy format mix inner nodes with leaves, nothing is pinned for them.
+   */
+  int pin_inner_nodes;
+
+  /** If non-zero, the nodes pinned with pin_inner_nodes are locked in RAM (mlock), so they're never
+   * paged out. okon_open() fails if they can't be locked, e.g. if RLIMIT_MEMLOCK is too low.
+   */
+  int lock_pinned_nodes;
+
+  /** If non-zero, all hashes of the file are loaded into one sorted array in memory on open, backed
+   * by huge pages if possible. Lookups don't read the file at all and give the same results. It
+   * takes about as much memory as the hashes take in the file, see okon_handle_pinned_size().
+   * node_cache_size, pin_inner_nodes and partial_node_reads are ignored. okon_open() fails if the
+   * memory can't be allocated.
+   */
+  int load_into_memory;
+
+  /** If non-zero, lookups read only the parts of nodes they need, instead of whole nodes: a couple
+   * of single keys of the binary search, then up to 4KB of keys and the pointer to the child. It
+   * cuts the bytes read per lookup by an order of magnitude for files prepared with big orders,
+   * which pays off if the file isn't in the page cache, at the cost of a couple of reads more per
+   * node. Pinned inner nodes are searched as they are. Ignored if node_cache_size is non-zero.
+   */
+  int partial_node_reads;
+};
+
+/** Opens a file prepared by okon_prepare() function.
+ *
+ * @param prepared_file_path Path to a file prepared by okon_prepare() function.
+ * @param options Open options. Optional parameter. If NULL, the node cache is disabled.
+ * @return Handle to the file or NULL if the file could not be opened, has been prepared by a newer
+ * okon version with features this one doesn't know or didn't pass the check enabled by
+ * okon_open_options::verify_header. The handle needs to be closed with okon_close().
+ */
+okon_handle* okon_open(const char* prepared_file_path, const okon_open_options* options);
+
+/** Closes the handle opened by okon_open(). */
+void okon_close(okon_handle* handle);
+
+/** Checks whether given hash exists in a file opened with okon_open().
+ * The function is safe to be called concurrently on the same handle. The file is read with
+ * positional reads, so concurrent lookups don't wait for each other.
+ *
+ * @param handle Handle returned by okon_open().
+ * @param sha1 Text based hash. The behavior is undefined if the hash has less than
+ * 2 * okon_handle_key_size(handle) characters.
+ */
+okon_exists_result okon_handle_exists_text(okon_handle* handle, const char* sha1);
+
+/** Checks whether given hash exists in a file opened with okon_open().
+ * The function is safe to be called concurrently on the same handle. See
+ * okon_handle_exists_text().
+ *
+ * @param handle Handle returned by okon_open().
+ * @param sha1 Binary based hash. The behavior is undefined if the hash has less than
+ * okon_handle_key_size(handle) bytes.
+ */
+okon_exists_result okon_handle_exists_binary(okon_handle* handle, const void* sha1);
+
+/** Checks whether given hashes exist in a file opened with okon_open(). Gives the same results as
+ * calling okon_handle_exists_binary() for every hash. If the file has been opened with
+ * okon_open_options::load_into_memory, lookups of the batch are interleaved, so waiting for memory
+ * of one lookup overlaps with the others. Batches of at least a few dozen hashes benefit the most.
+ * The function is safe to be called concurrently on the same handle.
+ *
+ * @param handle Handle returned by okon_open().
+ * @param hashes Binary based hashes, one right after another, okon_handle_key_size(handle) bytes
+ * each.
+ * @param count Number of hashes.
+ * @param results Array of at least count elements. The result for the i-th hash is written to the
+ * i-th element.
+ */
+void okon_handle_exists_binary_batch(okon_handle* handle, const void* hashes,
+                                     unsigned long long count, okon_exists_result* results);
+
+/** Context of asynchronous lookups in a file opened with okon_open(). Lookups don't block the
+ * calling thread on reading the file, so thousands of them can be in flight on one thread, e.g. an
+ * event loop of an asynchronous runtime. Reads of nodes are submitted to io_uring on Linux if the
+ * kernel supports it, otherwise they're done by a couple of threads in the background. A context
+ * needs to be used from one thread at a time, a thread typically has its own one.
+ */
+typedef struct okon_async okon_async;
+
+/** Called with the result of an asynchronous lookup, from okon_async_poll(). */
+typedef void (*okon_exists_callback_t)(okon_exists_result result, void* user_data);
+
+/** Creates a context of asynchronous lookups.
+ *
+ * @param handle Handle returned by okon_open(). It needs to stay open till the context is closed.
+ * Inner nodes pinned with okon_open_options::pin_inner_nodes are searched without reading the
+ * file. The node cache of the handle is not used.
+ * @param queue_depth Maximal number of reads submitted to the system at once. More lookups can be
+ * in flight, their reads wait in a queue.
+ * @return Context or NULL if the file could not be opened. The context needs to be closed with
+ * okon_async_close().
+ */
+okon_async* okon_async_open(okon_handle* handle, unsigned queue_depth);
+
+/** Closes the context. Callbacks of the lookups in flight are not called. */
+void okon_async_close(okon_async* async);
+
+/** Starts an asynchronous check whether given hash exists. The callback is called with the result
+ * by one of the following okon_async_poll() calls, never by this function. If the file has been
+ * loaded with okon_open_options::load_into_memory, the lookup is done right away, but the callback
+ * is still called by okon_async_poll().
+ *
+ * @param sha1 Binary based hash. The behavior is undefined if the hash has less than
+ * okon_handle_key_size() bytes. It's copied, it doesn't need to outlive the call.
+ */
+void okon_async_exists_binary(okon_async* async, const void* sha1,
+                              okon_exists_callback_t callback, void* user_data);
+
+/** Continues lookups whose reads have completed and calls callbacks of the finished ones.
+ *
+ * @param wait If non-zero and lookups are in flight, blocks till at least one of them progresses.
+ * @return Number of called callbacks.
+ */
+unsigned okon_async_poll(okon_async* async, int wait);
+
+/** Returns the number of lookups whose callbacks haven't been called yet. */
+unsigned long long okon_async_in_flight(okon_async* async);
+
+/** Returns the width in bytes of the hashes stored in a file opened with okon_open(), e.g. 20 for
+ * SHA-1.
+ */
+unsigned okon_handle_key_size(okon_handle* handle);
+
+/** Returns the number of bytes of memory taken by the nodes pinned with
+ * okon_open_options::pin_inner_nodes or by the hashes loaded with
+ * okon_open_options::load_into_memory, 0 if nothing is kept in memory.
+ */
+unsigned long long okon_handle_pinned_size(okon_handle* handle);
+
+enum okon_tree_stats_constants
+{
+  okon_tree_stats_max_levels_count = 16 //!< Length of okon_tree_stats::level_nodes_counts.
+};
+
+/** Shape of the tree of a prepared file, e.g. to size caches. */
+struct okon_tree_stats
+{
+  unsigned long long keys_count;        //!< Number of hashes in the file.
+  unsigned long long nodes_count;       //!< Number of B-tree nodes, leaves included.
+  unsigned long long leaf_nodes_count;  //!< Number of leaves.
+  unsigned order;                       //!< Max number of hashes in a node.
+  unsigned height;                      //!< Number of levels of the tree. 1 if the root is a leaf.
+
+  /** Number of nodes of every level, starting from the root. Levels deeper than
+   * okon_tree_stats_max_levels_count are not reported, they're there only in trees of tiny orders.
+   */
+  unsigned long long level_nodes_counts[okon_tree_stats_max_levels_count];
+};
+
+enum okon_stats_result
+{
+  okon_stats_result_success,      //!< All the stats have been written.
+  okon_stats_result_not_available //!< The file has been prepared in the legacy format or by an
+                                  //!< older okon version, which didn't store the stats. Only the
+                                  //!< order and the node counts that are known are written, the
+                                  //!< rest is zeroed.
+};
+
+/** Returns the stats of the tree of a file opened with okon_open(). They're stored in the header
+ * of the file, so it doesn't read the tree.
+ *
+ * @param handle Handle returned by okon_open().
+ * @param stats Where to write the stats to.
+ */
+okon_stats_result okon_stats(okon_handle* handle, okon_tree_stats* stats);
+
+/** Function called for every hash found by okon_handle_for_each_with_prefix().
+ *
+ * @param user_data User data passed to okon_handle_for_each_with_prefix().
+ * @param hash okon_handle_key_size() bytes of a binary hash.
+ */
+typedef void (*okon_prefix_callback_t)(void* user_data, const void* hash);
+
+/** Finds all hashes that start with the given prefix in a file opened with okon_open(), e.g. to
+ * serve ranges of hashes the way the HIBP k-anonymity API does (5 character prefixes). Hashes are
+ * reported in ascending order. The tree is descended once and the following nodes are read in
+ * order, so the cost is close to a single lookup. The function is safe to be called concurrently
+ * on the same handle.
+ *
+ * @param handle Handle returned by okon_open().
+ * @param prefix Text based prefix of a hash.
+ * @param prefix_length Number of characters of @param prefix. If it's more than
+ * 2 * okon_handle_key_size(handle), only so many characters are used.
+ * @param callback Callback called for every found hash. Optional parameter. Hashes of a file
+ * prepared with okon_prepare_options::fingerprint_size have only the fingerprint bytes set, the
+ * rest of them are zeros.
+ * @param callback_user_data Pointer to user data to be passed to @param callback.
+ * @return Number of found hashes.
+ */
+unsigned long long okon_handle_for_each_with_prefix(okon_handle* handle, const char* prefix,
+                                                    unsigned prefix_length,
+                                                    okon_prefix_callback_t callback,
+                                                    void* callback_user_data);
+
+enum okon_export_format
+{
+  okon_export_format_text,  //!< One hash per line, as upper case hex.
+  okon_export_format_binary //!< Binary hashes, one right after another.
+};
+
+enum okon_export_result
+{
+  okon_export_result_success,                   //!< Hashes have been exported.
+  okon_export_result_could_not_open_input_file, //!< Issue while opening the prepared file.
+  okon_export_result_could_not_open_output,     //!< Issue while opening the output file.
+  okon_export_result_could_not_write_output     //!< Issue while writing the output file.
+};
+
+/** Writes all hashes of a prepared file to a file, in ascending order, e.g. to compare prepared
+ * files or to feed them to other tools. The prepared file is read sequentially, in big blocks.
+ * Only the fingerprints of hashes are written for files prepared with
+ * okon_prepare_options::fingerprint_size.
+ *
+ * @param prepared_file_path Path to a file prepared by okon_prepare() function.
+ * @param output_file_path Path to the file to write the hashes to. It's truncated.
+ * @param format Format of the hashes in the output file.
+ * @param exported_count Where to write the number of exported hashes to. Optional parameter.
+ */
+okon_export_result okon_export(const char* prepared_file_path, const char* output_file_path,
+                               okon_export_format format, unsigned long long* exported_count);
+
+enum okon_verify_result
+{
+  okon_verify_result_ok,                  //!< The file is intact.
+  okon_verify_result_could_not_open_file, //!< Issue while opening the file.
+  okon_verify_result_no_checksums,        //!< The file has been prepared without checksums, e.g.
+                                          //!< in the legacy format.
+  okon_verify_result_corrupted_header,    //!< Checksum of the header doesn't match.
+  okon_verify_result_truncated,           //!< The file is shorter than the header says.
+  okon_verify_result_corrupted            //!< Checksum of a block of the file doesn't match.
+};
+
+/** Checks the integrity of a prepared file. Files prepared in the compact format are split into
+ * blocks and CRC32C of every block is stored at the end of the file. Blocks are verified in
+ * parallel.
+ *
+ * @param prepared_file_path Path to a file prepared by okon_prepare() function.
+ * @param threads_count Number of threads to verify the blocks with. If 0, the number of hardware
+ * threads is used.
+ */
+okon_verify_result okon_verify(const char* prepared_file_path, unsigned threads_count);
+
+enum okon_lookup_metrics_constants
+{
+  okon_lookup_metrics_latency_histogram_buckets_count = 156 //!< Number of histogram buckets.
+};
+
+/** Counters describing the cost of lookups. Values are accumulated over all lookups done by the
+ * process since start or the last okon_reset_lookup_metrics() call.
+ */
+struct okon_lookup_metrics
+{
+  unsigned long long lookups;       //!< Number of finished lookups.
+  unsigned long long nodes_visited; //!< Number of B-tree nodes visited by lookups.
+  unsigned long long bytes_read;    //!< Number of bytes read from the storage by lookups.
+  unsigned long long cache_hits;    //!< Number of nodes served from a node cache.
+  unsigned long long cache_misses;  //!< Number of nodes that had to be read from the storage.
+
+  /** Lookup latency histogram. Bucket i counts lookups that took at least
+   * okon_lookup_metrics_bucket_lower_bound(i) and less than
+   * okon_lookup_metrics_bucket_lower_bound(i + 1) nanoseconds. The last bucket is unbounded.
+   */
+  unsigned long long latency_histogram[okon_lookup_metrics_latency_histogram_buckets_count];
+};
+
+enum okon_metrics_result
+{
+  okon_metrics_result_success, //!< Metrics have been written.
+  okon_metrics_result_disabled //!< okon has been built without OKON_WITH_METRICS. Metrics are
+                               //!< zeroed.
+};
+
+/** Retrieves lookup metrics.
+ *
+ * @param metrics Where to write the metrics to.
+ */
+okon_metrics_result okon_get_lookup_metrics(okon_lookup_metrics* metrics);
+
+/** Zeroes all lookup metrics. */
+void okon_reset_lookup_metrics();
+
+/** Returns the lowest latency in nanoseconds that is counted in the histogram bucket.
+ *
+ * @param bucket_index Index of the bucket, less than
+ * okon_lookup_metrics_latency_histogram_buckets_count. Greater indices give the lower bound of the
+ * last bucket.
+ */
+unsigned long long okon_lookup_metrics_bucket_lower_bound(unsigned bucket_index);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <okon/okon.h>
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+
+#  include <coroutine>
+
+namespace okon {
+
+/** Awaitable asynchronous lookup, for C++20 coroutines:
+ *
+ *     const okon_exists_result result = co_await okon::async_exists(async, sha1);
+ *
+ * The coroutine is suspended till the lookup is done and resumed by okon_async_poll() of the
+ * context, on the thread that polls it. It fits any coroutine task type, e.g. task<bool> of an
+ * asynchronous runtime, whose event loop calls okon_async_poll().
+ */
+class async_exists
+{
+public:
+  /** @param sha1 Binary based hash, see okon_async_exists_binary(). */
+  async_exists(okon_async* async, const void* sha1)
+    : m_async{ async }
+    , m_sha1{ sha1 }
+  {
+  }
+
+  bool await_ready() const noexcept
+  {
+    return false;
+  }
+
+  void await_suspend(std::coroutine_handle<> coroutine)
+  {
+    m_coroutine = coroutine;
+    okon_async_exists_binary(m_async, m_sha1, &async_exists::on_done, this);
+  }
+
+  okon_exists_result await_resume() const noexcept
+  {
+    return m_result;
+  }
+
+private:
+  static void on_done(okon_exists_result result, void* user_data)
+  {
+    auto* self = static_cast<async_exists*>(user_data);
+    self->m_result = result;
+    self->m_coroutine.resume();
+  }
+
+private:
+  okon_async* m_async;
+  const void* m_sha1;
+  std::coroutine_handle<> m_coroutine;
+  okon_exists_result m_result{ okon_exists_result_doesnt_exist };
+};
+}
+
+#endif
@@ -0,0 +1,399 @@
+#include "async_file.hpp"
+
+#include "fstream_wrapper.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#  define OKON_HAS_IO_URING
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+namespace {
+constexpr auto k_reading_threads_count{ 4u };
+
+uint64_t file_size(const std::string& path)
+{
+  std::ifstream file{ path, std::ios::in | std::ios::binary | std::ios::ate };
+  return file.is_open() ? static_cast<uint64_t>(file.tellg()) : 0u;
+}
+}
+
+namespace okon {
+
+#ifdef OKON_HAS_IO_URING
+// Rings shared with the kernel, see io_uring(7). Only reads are submitted and at most as many as
+// the submission ring has entries are in the rings at once, so the completion ring, which is
+// bigger, never overflows.
+struct async_file::io_uring_state
+{
+  ~io_uring_state()
+  {
+    if (sqes != MAP_FAILED) {
+      munmap(sqes, sqes_size);
+    }
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+      munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring != MAP_FAILED) {
+      munmap(sq_ring, sq_ring_size);
+    }
+    if (ring_fd >= 0) {
+      close(ring_fd);
+    }
+    if (file_fd >= 0) {
+      close(file_fd);
+    }
+  }
+
+  int file_fd{ -1 };
+  int ring_fd{ -1 };
+
+  void* sq_ring{ MAP_FAILED };
+  size_t sq_ring_size{ 0u };
+  void* cq_ring{ MAP_FAILED };
+  size_t cq_ring_size{ 0u };
+  void* sqes{ MAP_FAILED };
+  size_t sqes_size{ 0u };
+
+  unsigned* sq_tail{ nullptr };
+  unsigned sq_mask{ 0u };
+  unsigned* sq_array{ nullptr };
+  unsigned sq_entries{ 0u };
+
+  unsigned* cq_head{ nullptr };
+  unsigned* cq_tail{ nullptr };
+  unsigned cq_mask{ 0u };
+  io_uring_cqe* cqes{ nullptr };
+
+  // Queued in the submission ring, but not passed to the kernel yet.
+  unsigned to_submit{ 0u };
+
+  // Queued or in flight.
+  unsigned in_rings{ 0u };
+
+  std::deque<read_request> backlog;
+};
+#else
+struct async_file::io_uring_state
+{
+};
+#endif
+
+struct async_file::threads_state
+{
+  std::mutex mtx;
+  std::condition_variable requests_cv;
+  std::condition_variable completions_cv;
+  std::deque<read_request> requests;
+  std::vector<completion> completions;
+  bool stopping{ false };
+  std::vector<std::thread> threads;
+};
+
+async_file::async_file(const std::string& path, unsigned queue_depth, async_backend backend)
+  : m_open{ std::ifstream{ path, std::ios::in | std::ios::binary }.is_open() }
+  , m_size{ file_size(path) }
+{
+  if (!m_open) {
+    return;
+  }
+
+  if (backend == async_backend::threads || !setup_io_uring(path, queue_depth)) {
+    setup_threads(path);
+  }
+}
+
+async_file::~async_file()
+{
+#ifdef OKON_HAS_IO_URING
+  // The kernel writes to the buffers of reads in flight till they complete. Requests of the
+  // backlog never got to the kernel, so they are just dropped.
+  if (m_ring != nullptr) {
+    m_in_flight -= m_ring->backlog.size();
+    m_ring->backlog.clear();
+    std::vector<completion> ignored;
+
+    while (m_ring->in_rings > 0u) {
+      const auto in_rings = m_ring->in_rings;
+      poll_ring(/*wait=*/true, ignored);
+      if (m_ring->in_rings == in_rings) {
+        break;
+      }
+    }
+  }
+#endif
+
+  if (m_threads == nullptr) {
+    return;
+  }
+
+  {
+    std::lock_guard lock{ m_threads->mtx };
+    m_threads->stopping = true;
+  }
+  m_threads->requests_cv.notify_all();
+
+  for (auto& thread : m_threads->threads) {
+    thread.join();
+  }
+}
+
+bool async_file::is_open() const
+{
+  return m_open;
+}
+
+bool async_file::uses_io_uring() const
+{
+  return m_ring != nullptr;
+}
+
+uint64_t async_file::size() const
+{
+  return m_size;
+}
+
+uint64_t async_file::in_flight_count() const
+{
+  return m_in_flight;
+}
+
+bool async_file::setup_io_uring([[maybe_unused]] const std::string& path,
+                                [[maybe_unused]] unsigned queue_depth)
+{
+#ifdef OKON_HAS_IO_URING
+  auto ring = std::make_unique<io_uring_state>();
+
+  ring->file_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (ring->file_fd < 0) {
+    return false;
+  }
+
+  io_uring_params params{};
+  ring->ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &params));
+
+  // IORING_OP_READ came with the kernel that added IORING_FEAT_FAST_POLL.
+  if (ring->ring_fd < 0 || (params.features & IORING_FEAT_FAST_POLL) == 0u) {
+    return false;
+  }
+
+  const auto single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0u;
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (single_mmap) {
+    ring->sq_ring_size = std::max(ring->sq_ring_size, ring->cq_ring_size);
+  }
+
+  const auto map = [&ring](size_t size, off_t offset) {
+    return mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd,
+                offset);
+  };
+
+  ring->sq_ring = map(ring->sq_ring_size, IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED) {
+    return false;
+  }
+
+  ring->cq_ring = single_mmap ? ring->sq_ring : map(ring->cq_ring_size, IORING_OFF_CQ_RING);
+  ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  ring->sqes = map(ring->sqes_size, IORING_OFF_SQES);
+  if (ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+    return false;
+  }
+
+  auto* sq = static_cast<uint8_t*>(ring->sq_ring);
+  ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  ring->sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  ring->sq_entries = params.sq_entries;
+
+  auto* cq = static_cast<uint8_t*>(ring->cq_ring);
+  ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  ring->cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+  m_ring = std::move(ring);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void async_file::setup_threads(const std::string& path)
+{
+  m_threads = std::make_unique<threads_state>();
+  auto& state = *m_threads;
+
+  const auto read_requests = [&state, path] {
+    fstream_wrapper file{ path, std::ios::in | std::ios::binary };
+
+    for (;;) {
+      std::unique_lock lock{ state.mtx };
+      state.requests_cv.wait(lock, [&state] { return state.stopping || !state.requests.empty(); });
+      if (state.stopping) {
+        return;
+      }
+
+      const auto request = state.requests.front();
+      state.requests.pop_front();
+      lock.unlock();
+
+      auto result = int64_t{ -1 };
+      if (file.is_open()) {
+        file.seek_in(static_cast<fstream_wrapper::pos_type_t>(request.offset));
+        result = file.read(request.buffer, request.size);
+      }
+
+      lock.lock();
+      state.completions.push_back(completion{ request.tag, result });
+      lock.unlock();
+      state.completions_cv.notify_one();
+    }
+  };
+
+  for (auto i = 0u; i < k_reading_threads_count; ++i) {
+    state.threads.emplace_back(read_requests);
+  }
+}
+
+void async_file::submit_read(uint64_t offset, void* buffer, uint32_t size, uint64_t tag)
+{
+  ++m_in_flight;
+
+  if (m_ring != nullptr) {
+    m_ring->backlog.push_back(read_request{ offset, buffer, size, tag });
+    return;
+  }
+
+  {
+    std::lock_guard lock{ m_threads->mtx };
+    m_threads->requests.push_back(read_request{ offset, buffer, size, tag });
+  }
+  m_threads->requests_cv.notify_one();
+}
+
+void async_file::poll(bool wait, std::vector<completion>& completions)
+{
+  wait = wait && m_in_flight > 0u;
+
+  if (m_ring != nullptr) {
+    poll_ring(wait, completions);
+  } else if (m_threads != nullptr) {
+    poll_threads(wait, completions);
+  }
+}
+
+void async_file::submit_to_ring()
+{
+#ifdef OKON_HAS_IO_URING
+  auto& ring = *m_ring;
+
+  while (!ring.backlog.empty() && ring.in_rings < ring.sq_entries) {
+    const auto& request = ring.backlog.front();
+    const auto tail = *ring.sq_tail;
+    const auto index = tail & ring.sq_mask;
+
+    auto& sqe = static_cast<io_uring_sqe*>(ring.sqes)[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = ring.file_fd;
+    sqe.off = request.offset;
+    sqe.addr = reinterpret_cast<uint64_t>(request.buffer);
+    sqe.len = request.size;
+    sqe.user_data = request.tag;
+
+    ring.sq_array[index] = index;
+    __atomic_store_n(ring.sq_tail, tail + 1u, __ATOMIC_RELEASE);
+
+    ring.backlog.pop_front();
+    ++ring.to_submit;
+    ++ring.in_rings;
+  }
+#endif
+}
+
+void async_file::poll_ring([[maybe_unused]] bool wait,
+                           [[maybe_unused]] std::vector<completion>& completions)
+{
+#ifdef OKON_HAS_IO_URING
+  auto& ring = *m_ring;
+
+  submit_to_ring();
+
+  const auto has_completions = [&ring] {
+    return *ring.cq_head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+  };
+
+  // Nothing would ever complete with no reads in the rings, so it's not waited for.
+  const auto min_complete = wait && ring.in_rings > 0u && !has_completions() ? 1u : 0u;
+
+  while (ring.to_submit > 0u || min_complete > 0u) {
+    const auto flags = min_complete > 0u ? IORING_ENTER_GETEVENTS : 0u;
+    const auto submitted =
+      syscall(__NR_io_uring_enter, ring.ring_fd, ring.to_submit, min_complete, flags, nullptr, 0);
+
+    if (submitted < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    ring.to_submit -= static_cast<unsigned>(submitted);
+    if (min_complete == 0u || has_completions()) {
+      break;
+    }
+  }
+
+  auto head = *ring.cq_head;
+  const auto tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+
+  for (; head != tail; ++head) {
+    const auto& cqe = ring.cqes[head & ring.cq_mask];
+    completions.push_back(completion{ cqe.user_data, cqe.res });
+    --ring.in_rings;
+    --m_in_flight;
+  }
+
+  __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+  // Keep the ring busy with the requests that didn't fit into it before.
+  submit_to_ring();
+  if (ring.to_submit > 0u) {
+    const auto submitted =
+      syscall(__NR_io_uring_enter, ring.ring_fd, ring.to_submit, 0u, 0u, nullptr, 0);
+    if (submitted > 0) {
+      ring.to_submit -= static_cast<unsigned>(submitted);
+    }
+  }
+#endif
+}
+
+void async_file::poll_threads(bool wait, std::vector<completion>& completions)
+{
+  auto& state = *m_threads;
+  std::unique_lock lock{ state.mtx };
+
+  if (wait) {
+    state.completions_cv.wait(lock, [&state] { return !state.completions.empty(); });
+  }
+
+  completions.insert(std::end(completions), std::begin(state.completions),
+                     std::end(state.completions));
+  m_in_flight -= state.completions.size();
+  state.completions.clear();
+}
+}
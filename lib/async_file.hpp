@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace okon {
+
+enum class async_backend
+{
+  // io_uring if the system supports it, threads otherwise.
+  automatic,
+
+  // A couple of threads reading the file in the background.
+  threads
+};
+
+// File read asynchronously: reads are submitted without waiting for them and their completions are
+// collected later with poll(), so many reads can be in flight on one thread. On Linux it uses
+// io_uring if the kernel supports it. Otherwise, reads are done by a couple of threads in the
+// background. Submitting and polling needs to be done from one thread at a time.
+class async_file
+{
+public:
+  struct completion
+  {
+    uint64_t tag{ 0u };
+
+    // Number of read bytes, negative if the read failed.
+    int64_t result{ 0 };
+  };
+
+  explicit async_file(const std::string& path, unsigned queue_depth,
+                      async_backend backend = async_backend::automatic);
+  ~async_file();
+
+  async_file(const async_file&) = delete;
+  async_file& operator=(const async_file&) = delete;
+
+  bool is_open() const;
+  bool uses_io_uring() const;
+  uint64_t size() const;
+
+  // Reads size bytes at the offset. The buffer needs to stay valid till the completion of the read
+  // is returned by poll().
+  void submit_read(uint64_t offset, void* buffer, uint32_t size, uint64_t tag);
+
+  // Appends completions of the finished reads. If wait is true and there are reads in flight,
+  // blocks till at least one of them finishes.
+  void poll(bool wait, std::vector<completion>& completions);
+
+  // Number of submitted reads whose completions haven't been returned by poll() yet.
+  uint64_t in_flight_count() const;
+
+private:
+  struct read_request
+  {
+    uint64_t offset;
+    void* buffer;
+    uint32_t size;
+    uint64_t tag;
+  };
+
+  struct io_uring_state;
+  struct threads_state;
+
+  bool setup_io_uring(const std::string& path, unsigned queue_depth);
+  void setup_threads(const std::string& path);
+
+  // Moves requests that didn't fit into the ring to it and submits them.
+  void submit_to_ring();
+  void poll_ring(bool wait, std::vector<completion>& completions);
+  void poll_threads(bool wait, std::vector<completion>& completions);
+
+private:
+  bool m_open{ false };
+  uint64_t m_size{ 0u };
+  uint64_t m_in_flight{ 0u };
+  std::unique_ptr<io_uring_state> m_ring;
+  std::unique_ptr<threads_state> m_threads;
+};
+}
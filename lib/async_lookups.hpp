@@ -0,0 +1,219 @@
+#pragma once
+
+#include "async_file.hpp"
+#include "btree_node.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace okon {
+
+enum class async_lookup_result
+{
+  not_found,
+  found,
+  read_failed
+};
+
+// Lookups in a tree that don't block on reading nodes. Every read of a node is submitted to an
+// async_file and the lookup continues when poll() collects the read, so thousands of lookups can
+// be in flight on one thread. Pinned inner nodes are searched right away, without reads. Callback
+// is called with the async_lookup_result of a lookup, only from poll(). Like async_file, it needs
+// to be used from one thread at a time.
+template <typename Tree, typename Callback>
+class async_lookups
+{
+public:
+  using key_t = typename Tree::key_t;
+
+  // The tree needs to outlive the object. path is the path of the file of the tree.
+  explicit async_lookups(const Tree& tree, const std::string& path, unsigned queue_depth,
+                         async_backend backend = async_backend::automatic);
+
+  bool is_open() const;
+  const async_file& file() const;
+
+  void submit(const key_t& key, Callback callback);
+
+  // Continues the lookups whose reads have finished and calls callbacks of the lookups that are
+  // done. If wait is true and there are lookups in flight, blocks till at least one read finishes.
+  // Returns the number of called callbacks.
+  unsigned poll(bool wait);
+
+  // Number of lookups whose callbacks haven't been called yet.
+  uint64_t in_flight_count() const;
+
+private:
+  struct lookup
+  {
+    key_t key;
+    btree_node::pointer_t ptr;
+    Callback callback;
+
+    // Bytes of the node being read. It doesn't change its size, so reads can be done right into
+    // it.
+    std::vector<uint8_t> node;
+  };
+
+  // Lookup that is done, waiting for its callback to be called.
+  struct finished_lookup
+  {
+    Callback callback;
+    async_lookup_result result;
+  };
+
+  // Goes down the tree till the lookup is done or needs to read a node.
+  void advance(uint32_t index);
+  void finish(uint32_t index, async_lookup_result result);
+  uint64_t max_node_size() const;
+
+private:
+  const Tree& m_tree;
+
+  // Lookups are kept on the heap, so their buffers stay where they are when more lookups come.
+  std::vector<std::unique_ptr<lookup>> m_lookups;
+  std::vector<uint32_t> m_free_lookups;
+  std::vector<async_file::completion> m_completions;
+  std::vector<finished_lookup> m_finished;
+  uint64_t m_in_flight{ 0u };
+
+  // Destroyed first, so reads in flight are done before their buffers are freed.
+  async_file m_file;
+};
+
+template <typename Tree, typename Callback>
+async_lookups<Tree, Callback>::async_lookups(const Tree& tree, const std::string& path,
+                                   unsigned queue_depth, async_backend backend)
+  : m_tree{ tree }
+  , m_file{ path, queue_depth, backend }
+{
+}
+
+template <typename Tree, typename Callback>
+bool async_lookups<Tree, Callback>::is_open() const
+{
+  return m_file.is_open();
+}
+
+template <typename Tree, typename Callback>
+const async_file& async_lookups<Tree, Callback>::file() const
+{
+  return m_file;
+}
+
+template <typename Tree, typename Callback>
+void async_lookups<Tree, Callback>::submit(const key_t& key, Callback callback)
+{
+  if (m_free_lookups.empty()) {
+    m_free_lookups.push_back(static_cast<uint32_t>(m_lookups.size()));
+    m_lookups.push_back(std::make_unique<lookup>());
+    m_lookups.back()->node.resize(max_node_size());
+  }
+
+  const auto index = m_free_lookups.back();
+  m_free_lookups.pop_back();
+
+  auto& l = *m_lookups[index];
+  l.key = key;
+  l.ptr = m_tree.lookup_root();
+  l.callback = std::move(callback);
+
+  ++m_in_flight;
+  advance(index);
+}
+
+template <typename Tree, typename Callback>
+unsigned async_lookups<Tree, Callback>::poll(bool wait)
+{
+  // Lookups that are done already are not waited for.
+  m_completions.clear();
+  m_file.poll(wait && m_finished.empty(), m_completions);
+
+  for (const auto& completed : m_completions) {
+    const auto index = static_cast<uint32_t>(completed.tag);
+    auto& l = *m_lookups[index];
+
+    if (completed.result <= 0) {
+      finish(index, async_lookup_result::read_failed);
+      continue;
+    }
+
+    // The last node of the file can be shorter than the maximal size.
+    const auto read_size = static_cast<uint64_t>(completed.result);
+    std::fill(std::next(l.node.begin(), static_cast<std::ptrdiff_t>(read_size)), l.node.end(),
+              uint8_t{ 0u });
+
+    if (m_tree.search_node(l.node.data(), l.key, l.ptr)) {
+      finish(index, async_lookup_result::found);
+    } else {
+      advance(index);
+    }
+  }
+
+  // Callbacks can submit lookups, which can be done right away.
+  auto finished_count = 0u;
+  for (; finished_count < m_finished.size(); ++finished_count) {
+    auto finished = std::move(m_finished[finished_count]);
+    --m_in_flight;
+    finished.callback(finished.result);
+  }
+
+  m_finished.clear();
+  return finished_count;
+}
+
+template <typename Tree, typename Callback>
+uint64_t async_lookups<Tree, Callback>::in_flight_count() const
+{
+  return m_in_flight;
+}
+
+template <typename Tree, typename Callback>
+void async_lookups<Tree, Callback>::advance(uint32_t index)
+{
+  auto& l = *m_lookups[index];
+
+  while (l.ptr != btree_node::k_unused_pointer) {
+    if (const auto* pinned = m_tree.pinned_node(l.ptr)) {
+      if (m_tree.search_node(pinned, l.key, l.ptr)) {
+        finish(index, async_lookup_result::found);
+        return;
+      }
+
+      continue;
+    }
+
+    const auto location = m_tree.locate_node(l.ptr);
+    if (location.offset >= m_file.size()) {
+      finish(index, async_lookup_result::read_failed);
+      return;
+    }
+
+    const auto size = std::min(location.max_size, m_file.size() - location.offset);
+    m_file.submit_read(location.offset, l.node.data(), static_cast<uint32_t>(size), index);
+    return;
+  }
+
+  finish(index, async_lookup_result::not_found);
+}
+
+template <typename Tree, typename Callback>
+void async_lookups<Tree, Callback>::finish(uint32_t index, async_lookup_result result)
+{
+  m_finished.push_back(finished_lookup{ std::move(m_lookups[index]->callback), result });
+  m_free_lookups.push_back(index);
+}
+
+template <typename Tree, typename Callback>
+uint64_t async_lookups<Tree, Callback>::max_node_size() const
+{
+  const auto inner_size = m_tree.locate_node(0u).max_size;
+  const auto leaf_size = m_tree.locate_node(btree_node::k_leaf_pointer_flag).max_size;
+  return std::max(inner_size, leaf_size);
+}
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "btree_base.hpp"
+#include "btree_compactor.hpp"
+#include "file_header.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace okon {
+
+// Builds a file of the compact layout with file_flag_bplus_tree out of sorted keys, in one pass.
+// Leaves are filled up and written out one after another, so they end up contiguous and in key
+// order. The first key of every leaf but the first one goes up to the inner nodes, which are kept
+// in memory (there are ~order times less of them than leaves) and written after the last leaf.
+// It doesn't need an intermediate tree, unlike btree_compactor.
+template <typename DataStorage, typename Key = sha1_t>
+class bplus_tree_builder : public btree_base<DataStorage, Key>
+{
+public:
+  using node_t = basic_btree_node<Key>;
+
+  explicit bplus_tree_builder(DataStorage& storage, btree_node::order_t order,
+                              compact_format_options options = {});
+
+  void insert_sorted(const Key& key);
+  void finalize_inserting();
+
+private:
+  static file_header make_header(btree_node::order_t order, compact_format_options options);
+
+  // Writes the current leaf and starts the next one. Returns the pointer of the written leaf.
+  btree_node::pointer_t write_leaf();
+
+  // Adds the child on the right of the separator, to the open node of the level. If the level
+  // doesn't exist yet, it's created with left_child as the first child.
+  void add_child(unsigned level, const Key& separator, btree_node::pointer_t left_child,
+                 btree_node::pointer_t child);
+  btree_node::pointer_t new_inner_node(btree_node::pointer_t first_child);
+
+private:
+  node_t m_leaf;
+  uint64_t m_next_leaf_position{ 0u };
+  uint32_t m_leaves_count{ 0u };
+  uint64_t m_keys_count{ 0u };
+
+  // Inner nodes, indexed by their pointers.
+  std::vector<node_t> m_inner_nodes;
+
+  // Pointer of the inner node that children are added to, for every level above the leaves.
+  std::vector<btree_node::pointer_t> m_open_nodes;
+
+  // Number of inner nodes of every level above the leaves.
+  std::vector<uint32_t> m_level_nodes_counts;
+};
+
+template <typename DataStorage, typename Key>
+bplus_tree_builder<DataStorage, Key>::bplus_tree_builder(DataStorage& storage,
+                                                         btree_node::order_t order,
+                                                         compact_format_options options)
+  : btree_base<DataStorage, Key>{ storage, make_header(order, options) }
+  , m_leaf{ order, btree_node::k_unused_pointer }
+{
+  m_leaf.is_leaf = true;
+  m_leaf.this_pointer = btree_node::k_leaf_pointer_flag;
+}
+
+template <typename DataStorage, typename Key>
+file_header bplus_tree_builder<DataStorage, Key>::make_header(btree_node::order_t order,
+                                                              compact_format_options options)
+{
+  file_header header;
+  header.format = file_format::compact;
+  header.header_size = file_header::k_compact_header_size;
+  header.order = order;
+  header.flags = options.flags | file_flag_bplus_tree;
+  header.stored_key_size = stored_key_size_of<Key>(options);
+  header.key_size = sizeof(Key);
+  return header;
+}
+
+template <typename DataStorage, typename Key>
+void bplus_tree_builder<DataStorage, Key>::insert_sorted(const Key& key)
+{
+  if (m_leaf.keys_count == this->order()) {
+    const auto full_leaf_ptr = write_leaf();
+    add_child(/*level=*/0u, key, full_leaf_ptr, m_leaf.this_pointer);
+  }
+
+  m_leaf.push_back(key);
+  ++m_keys_count;
+}
+
+template <typename DataStorage, typename Key>
+void bplus_tree_builder<DataStorage, Key>::finalize_inserting()
+{
+  // With no keys at all, an empty leaf is written. It's the root.
+  write_leaf();
+
+  auto header = this->header();
+  header.leaf_nodes_count = m_leaves_count;
+  header.inner_nodes_count = static_cast<uint32_t>(m_inner_nodes.size());
+  header.root_ptr = m_open_nodes.empty() ? btree_node::k_leaf_pointer_flag : m_open_nodes.back();
+  header.keys_count = m_keys_count;
+
+  // Levels in the header start from the root.
+  header.height = static_cast<uint32_t>(m_level_nodes_counts.size()) + 1u;
+  auto levels = m_level_nodes_counts;
+  std::reverse(std::begin(levels), std::end(levels));
+  levels.push_back(m_leaves_count);
+  levels.resize(file_header::k_max_levels_in_header);
+  std::copy(std::begin(levels), std::end(levels), std::begin(header.level_nodes_counts));
+
+  const auto compressed = header.has_flag(file_flag_prefix_compressed_leaves);
+  const auto leaf_format = this->format_of(btree_node::k_leaf_pointer_flag);
+  header.leaves_size = compressed ? m_next_leaf_position * k_compressed_leaf_alignment
+                                  : m_next_leaf_position * node_view::max_stored_size(leaf_format);
+
+  // Offsets of the inner nodes depend on the size of the leaves.
+  this->set_header(header);
+
+  for (const auto& node : m_inner_nodes) {
+    this->write_node(node);
+  }
+}
+
+template <typename DataStorage, typename Key>
+btree_node::pointer_t bplus_tree_builder<DataStorage, Key>::write_leaf()
+{
+  std::fill(std::next(std::begin(m_leaf.keys), m_leaf.keys_count), std::end(m_leaf.keys), Key{});
+  this->write_node(m_leaf);
+  ++m_leaves_count;
+
+  if (this->header().has_flag(file_flag_prefix_compressed_leaves)) {
+    const auto size = prefix_compressed_leaf_size(m_leaf, this->header().stored_key_size);
+    m_next_leaf_position += (size + k_compressed_leaf_alignment - 1u) / k_compressed_leaf_alignment;
+  } else {
+    ++m_next_leaf_position;
+  }
+
+  assert(m_next_leaf_position < btree_node::k_leaf_pointer_flag);
+
+  const auto written_ptr = m_leaf.this_pointer;
+  m_leaf.this_pointer =
+    btree_node::k_leaf_pointer_flag | static_cast<btree_node::pointer_t>(m_next_leaf_position);
+  m_leaf.keys_count = 0u;
+
+  return written_ptr;
+}
+
+template <typename DataStorage, typename Key>
+void bplus_tree_builder<DataStorage, Key>::add_child(unsigned level, const Key& separator,
+                                                     btree_node::pointer_t left_child,
+                                                     btree_node::pointer_t child)
+{
+  if (level == m_open_nodes.size()) {
+    m_open_nodes.push_back(new_inner_node(left_child));
+    m_level_nodes_counts.push_back(1u);
+  }
+
+  const auto open_ptr = m_open_nodes[level];
+
+  // The separator doesn't fit, so it goes up, between the full node and a new one.
+  if (m_inner_nodes[open_ptr].keys_count == this->order()) {
+    const auto new_ptr = new_inner_node(child);
+    m_open_nodes[level] = new_ptr;
+    ++m_level_nodes_counts[level];
+    add_child(level + 1u, separator, open_ptr, new_ptr);
+    return;
+  }
+
+  auto& node = m_inner_nodes[open_ptr];
+  node.pointers[node.keys_count + 1u] = child;
+  node.push_back(separator);
+}
+
+template <typename DataStorage, typename Key>
+btree_node::pointer_t bplus_tree_builder<DataStorage, Key>::new_inner_node(
+  btree_node::pointer_t first_child)
+{
+  const auto ptr = static_cast<btree_node::pointer_t>(m_inner_nodes.size());
+
+  auto& node = m_inner_nodes.emplace_back(this->order(), btree_node::k_unused_pointer);
+  node.this_pointer = ptr;
+  node.pointers[0] = first_child;
+
+  return ptr;
+}
+}
@@ -2,54 +2,468 @@
 
 #include "btree_base.hpp"
 #include "btree_node.hpp"
+#include "key_prefix.hpp"
+#include "lookup_metrics.hpp"
+#include "node_cache.hpp"
+#include "node_view.hpp"
+#include "pinned_nodes.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <mutex>
 
 namespace okon {
-template <typename DataStorage>
-class btree : public btree_base<DataStorage>
+template <typename DataStorage, typename Key = sha1_t>
+class btree : public btree_base<DataStorage, Key>
 {
 public:
-  explicit btree(DataStorage& storage);
+  // Maximal number of bytes of keys read at once by partial node reads.
+  static constexpr uint64_t k_partial_read_window_size{ 4096u };
+
+  explicit btree(DataStorage& storage, node_cache* cache = nullptr);
+
+  // After the first lookups of a thread, it doesn't allocate memory, unless a node read from the
+  // storage is inserted into the cache.
+  bool contains(const Key& key) const;
+
+  // Reads all the inner nodes into memory, so lookups read only leaves from the storage. They take
+  // ~1/order of the file. If lock_in_memory is true, they are locked in RAM too. Returns false if
+  // they couldn't be locked. Legacy files mix inner nodes with leaves, so nothing is pinned for
+  // them. Needs to be called before any lookup.
+  bool pin_inner_nodes(bool lock_in_memory);
+
+  // Nullptr if inner nodes are not pinned.
+  const pinned_nodes* pinned_inner_nodes() const;
+
+  // If enabled, lookups read only the parts of a node its search needs: the header, single keys of
+  // the first steps of the binary search, till the rest of the keys fit into
+  // k_partial_read_window_size bytes, the rest of the keys and the pointer to the child. If the
+  // node has a summary (file_flag_node_summaries), it's read with the header and the binary search
+  // starts with the keys between two of its entries, which fit into the window. For big
+  // orders it's an order of magnitude fewer bytes than the whole node, at the cost of a couple of
+  // reads more. Pinned nodes are searched as they are. Ignored if the tree has a cache, which
+  // needs whole nodes. Needs to be called before any lookup.
+  void set_partial_node_reads(bool enabled);
+
+  // Calls fun(key) for every key whose first prefix_bits bits are equal to the ones of the prefix,
+  // in ascending order. The tree is descended once, to the first of them, and the following
+  // nodes are visited in order till a key of another prefix is found. Keys of a file with
+  // truncated keys are zero padded, only their stored bits are compared.
+  template <typename Function>
+  void for_each_key_with_prefix(const Key& prefix, uint32_t prefix_bits, Function&& fun) const;
+
+  // Where a node is stored, see locate_node().
+  struct node_location
+  {
+    uint64_t offset{ 0u };
+
+    // Upper bound of the number of bytes the node takes.
+    uint64_t max_size{ 0u };
+  };
 
-  bool contains(const sha1_t& sha1) const;
+  // Steps of contains(), for code that reads nodes on its own, e.g. asynchronously. A lookup
+  // starts at lookup_root() and goes down with search_node() till the key is found or there's no
+  // child to go down to.
+  btree_node::pointer_t lookup_root() const;
+  node_location locate_node(btree_node::pointer_t ptr) const;
+
+  // Bytes of the node if it's pinned, nullptr otherwise.
+  const uint8_t* pinned_node(btree_node::pointer_t ptr) const;
+
+  // Returns true if the key is in the node. Otherwise sets ptr to the child to go down to,
+  // k_unused_pointer if there's none.
+  bool search_node(const uint8_t* node, const Key& key, btree_node::pointer_t& ptr) const;
 
 private:
-  bool contains(const btree_node& node, const sha1_t& sha1) const;
-  btree_node read_root() const;
+  using node_ptr_t = node_cache::node_ptr_t;
+
+  // Bytes of a node visited by a lookup. Pinned nodes are not owned by it.
+  struct visited_node
+  {
+    node_ptr_t owned;
+    const uint8_t* data{ nullptr };
+    uint64_t size{ 0u };
+  };
+
+  // Returns false once a key of another prefix has been reached.
+  template <typename Function>
+  bool visit_keys_with_prefix(btree_node::pointer_t ptr, unsigned level, const Key& first_key,
+                              uint32_t prefix_bits, Function& fun) const;
+
+  // Variant for files with file_flag_bplus_tree. Keys of inner nodes are copies of keys of leaves,
+  // so only the leaves are visited, one after another.
+  template <typename Function>
+  void visit_leaf_keys_with_prefix(const Key& first_key, uint32_t prefix_bits,
+                                   Function& fun) const;
+
+  // If the node is neither pinned nor cached and there's no cache to insert it into, it's read
+  // into the buffer, if given. The buffer needs to outlive the returned node.
+  visited_node visit_node(btree_node::pointer_t ptr, unsigned level,
+                          node_bytes_t* buffer = nullptr) const;
+  node_ptr_t read_node_for_lookup(btree_node::pointer_t ptr, unsigned level) const;
+  void read_node_into(btree_node::pointer_t ptr, node_bytes_t& node) const;
+
+  // Like search_node(), but reads only the parts of the node that the search needs.
+  bool search_node_partially(const Key& key, btree_node::pointer_t& ptr) const;
+  void read_part(uint64_t offset, void* data, uint64_t size) const;
+
+  // Lock of the storage for a read. Empty for storages with positional reads.
+  std::unique_lock<std::mutex> lock_storage() const;
+
+private:
+  node_cache* m_cache{ nullptr };
+  std::unique_ptr<pinned_nodes> m_pinned;
+  bool m_partial_node_reads{ false };
+
+  // Storage is accessed with seek-then-read, so reads of nodes that are not cached need to be
+  // serialized, unless the storage has positional reads.
+  mutable std::mutex m_storage_mtx;
 };
 
-template <typename DataStorage>
-btree<DataStorage>::btree(DataStorage& storage)
-  : btree_base<DataStorage>{ storage }
+template <typename DataStorage, typename Key>
+btree<DataStorage, Key>::btree(DataStorage& storage, node_cache* cache)
+  : btree_base<DataStorage, Key>{ storage }
+  , m_cache{ cache }
+{
+}
+
+template <typename DataStorage, typename Key>
+bool btree<DataStorage, Key>::pin_inner_nodes(bool lock_in_memory)
+{
+  const auto& header = this->header();
+  if (header.format == file_format::legacy) {
+    return true;
+  }
+
+  // Inner nodes are stored one after another and their pointers are their indices.
+  const auto node_size = node_view::max_stored_size(this->format_of(0u));
+  std::vector<uint8_t> bytes(node_size * header.inner_nodes_count);
+
+  if (!bytes.empty()) {
+    const auto lock = lock_storage();
+    this->read_bytes(this->node_offset(0u), bytes.data(), bytes.size());
+  }
+
+  m_pinned = std::make_unique<pinned_nodes>(std::move(bytes), node_size);
+
+  return !lock_in_memory || m_pinned->lock_in_memory();
+}
+
+template <typename DataStorage, typename Key>
+const pinned_nodes* btree<DataStorage, Key>::pinned_inner_nodes() const
+{
+  return m_pinned.get();
+}
+
+template <typename DataStorage, typename Key>
+bool btree<DataStorage, Key>::contains(const Key& key) const
+{
+  [[maybe_unused]] metrics::lookup_timer timer;
+
+  // Nodes are visited one at a time, so one buffer per thread is enough. It keeps its capacity,
+  // so reading into it doesn't allocate after the first lookups.
+  static thread_local node_bytes_t buffer;
+
+  auto ptr = this->root_ptr();
+
+  for (auto level = 0u; ptr != btree_node::k_unused_pointer; ++level) {
+    if (m_partial_node_reads && pinned_node(ptr) == nullptr) {
+      metrics::record_node_visit();
+      if (search_node_partially(key, ptr)) {
+        return true;
+      }
+
+      continue;
+    }
+
+    const auto node = visit_node(ptr, level, &buffer);
+    if (search_node(node.data, key, ptr)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+template <typename DataStorage, typename Key>
+void btree<DataStorage, Key>::set_partial_node_reads(bool enabled)
+{
+  m_partial_node_reads = enabled && m_cache == nullptr;
+}
+
+template <typename DataStorage, typename Key>
+btree_node::pointer_t btree<DataStorage, Key>::lookup_root() const
+{
+  return this->root_ptr();
+}
+
+template <typename DataStorage, typename Key>
+typename btree<DataStorage, Key>::node_location btree<DataStorage, Key>::locate_node(
+  btree_node::pointer_t ptr) const
+{
+  return node_location{ this->node_offset(ptr), node_view::max_stored_size(this->format_of(ptr)) };
+}
+
+template <typename DataStorage, typename Key>
+const uint8_t* btree<DataStorage, Key>::pinned_node(btree_node::pointer_t ptr) const
+{
+  const auto is_inner = (ptr & btree_node::k_leaf_pointer_flag) == 0u;
+  return m_pinned != nullptr && is_inner && ptr < m_pinned->nodes_count() ? m_pinned->node(ptr)
+                                                                          : nullptr;
+}
+
+template <typename DataStorage, typename Key>
+bool btree<DataStorage, Key>::search_node(const uint8_t* node, const Key& key,
+                                          btree_node::pointer_t& ptr) const
+{
+  const node_view view{ this->format_of(ptr), node };
+  const auto result = view.search(key.data());
+
+  if (result.found) {
+    return true;
+  }
+
+  ptr = view.child(result.place);
+  return false;
+}
+
+template <typename DataStorage, typename Key>
+template <typename Function>
+void btree<DataStorage, Key>::for_each_key_with_prefix(const Key& prefix, uint32_t prefix_bits,
+                                                       Function&& fun) const
 {
+  prefix_bits = std::min(prefix_bits, 8u * this->header().stored_key_size);
+  const auto first_key = first_key_of_prefix(prefix, prefix_bits);
+
+  if (this->header().has_flag(file_flag_bplus_tree)) {
+    visit_leaf_keys_with_prefix(first_key, prefix_bits, fun);
+  } else {
+    visit_keys_with_prefix(this->root_ptr(), /*level=*/0u, first_key, prefix_bits, fun);
+  }
 }
 
-template <typename DataStorage>
-bool btree<DataStorage>::contains(const sha1_t& sha1) const
+template <typename DataStorage, typename Key>
+template <typename Function>
+bool btree<DataStorage, Key>::visit_keys_with_prefix(btree_node::pointer_t ptr, unsigned level,
+                                                     const Key& first_key, uint32_t prefix_bits,
+                                                     Function& fun) const
 {
-  const auto node = read_root();
-  return contains(node, sha1);
+  if (ptr == btree_node::k_unused_pointer) {
+    return true;
+  }
+
+  const auto node = visit_node(ptr, level);
+  const node_view view{ this->format_of(ptr), node.data };
+  const auto result = view.search(first_key.data());
+
+  // Keys of the child on the left of a found key are less than it.
+  if (!result.found && !visit_keys_with_prefix(view.child(result.place), level + 1u, first_key,
+                                               prefix_bits, fun)) {
+    return false;
+  }
+
+  for (auto place = result.place; place < view.keys_count(); ++place) {
+    const auto key = view.template key<Key>(place);
+    if (!has_prefix(key, first_key, prefix_bits)) {
+      return false;
+    }
+
+    fun(key);
+
+    if (!visit_keys_with_prefix(view.child(place + 1u), level + 1u, first_key, prefix_bits,
+                                fun)) {
+      return false;
+    }
+  }
+
+  return true;
 }
 
-template <typename DataStorage>
-bool btree<DataStorage>::contains(const btree_node& node, const sha1_t& sha1) const
+template <typename DataStorage, typename Key>
+template <typename Function>
+void btree<DataStorage, Key>::visit_leaf_keys_with_prefix(const Key& first_key,
+                                                          uint32_t prefix_bits,
+                                                          Function& fun) const
 {
-  if (node.contains(sha1)) {
+  auto ptr = this->root_ptr();
+  auto level = 0u;
+
+  // A separator is the first key of the subtree on its right.
+  for (; (ptr & btree_node::k_leaf_pointer_flag) == 0u; ++level) {
+    const auto node = visit_node(ptr, level);
+    const node_view view{ this->format_of(ptr), node.data };
+    const auto result = view.search(first_key.data());
+    ptr = view.child(result.found ? result.place + 1u : result.place);
+  }
+
+  while (ptr != btree_node::k_unused_pointer) {
+    const auto node = visit_node(ptr, level);
+    const node_view view{ this->format_of(ptr), node.data };
+
+    for (auto place = view.search(first_key.data()).place; place < view.keys_count(); ++place) {
+      const auto key = view.template key<Key>(place);
+      if (!has_prefix(key, first_key, prefix_bits)) {
+        return;
+      }
+
+      fun(key);
+    }
+
+    ptr = this->next_leaf_ptr(ptr, node.size);
+  }
+}
+
+template <typename DataStorage, typename Key>
+typename btree<DataStorage, Key>::visited_node btree<DataStorage, Key>::visit_node(
+  btree_node::pointer_t ptr, unsigned level, node_bytes_t* buffer) const
+{
+  if (const auto* pinned = pinned_node(ptr)) {
+    metrics::record_node_visit();
+    return visited_node{ nullptr, pinned, m_pinned->node_size() };
+  }
+
+  if (m_cache == nullptr && buffer != nullptr) {
+    metrics::record_node_visit();
+    read_node_into(ptr, *buffer);
+    return visited_node{ nullptr, buffer->data(), buffer->size() };
+  }
+
+  auto node = read_node_for_lookup(ptr, level);
+  const auto* data = node->data();
+  const auto size = uint64_t{ node->size() };
+  return visited_node{ std::move(node), data, size };
+}
+
+template <typename DataStorage, typename Key>
+typename btree<DataStorage, Key>::node_ptr_t btree<DataStorage, Key>::read_node_for_lookup(
+  btree_node::pointer_t ptr, unsigned level) const
+{
+  metrics::record_node_visit();
+
+  if (m_cache != nullptr) {
+    if (auto cached = m_cache->find(ptr)) {
+      metrics::record_cache_hit();
+      return cached;
+    }
+
+    metrics::record_cache_miss();
+  }
+
+  auto node = std::make_shared<node_bytes_t>();
+  read_node_into(ptr, *node);
+
+  if (m_cache != nullptr) {
+    m_cache->insert(ptr, node, level);
+  }
+
+  return node;
+}
+
+template <typename DataStorage, typename Key>
+void btree<DataStorage, Key>::read_node_into(btree_node::pointer_t ptr, node_bytes_t& node) const
+{
+  {
+    const auto lock = lock_storage();
+    this->read_node_bytes(ptr, node);
+  }
+
+  metrics::record_bytes_read(node.size());
+}
+
+template <typename DataStorage, typename Key>
+std::unique_lock<std::mutex> btree<DataStorage, Key>::lock_storage() const
+{
+  if constexpr (has_positional_read_v<DataStorage>) {
+    return {};
+  } else {
+    return std::unique_lock{ m_storage_mtx };
+  }
+}
+
+template <typename DataStorage, typename Key>
+bool btree<DataStorage, Key>::search_node_partially(const Key& key,
+                                                    btree_node::pointer_t& ptr) const
+{
+  const auto format = this->format_of(ptr);
+  const auto offset = this->node_offset(ptr);
+
+  // One more key than fits into the window, see below.
+  std::array<uint8_t, k_partial_read_window_size + sizeof(Key)> buffer{};
+
+  // A summary of a huge order may not fit into the buffer. It's not used then.
+  const auto header_size = node_view::header_size(format);
+  const auto summary_fits = header_size <= buffer.size();
+  read_part(offset, buffer.data(), std::min<uint64_t>(header_size, buffer.size()));
+  const auto parts = node_view::parts_of(format, buffer.data());
+
+  // Only prefix compressed leaves have a prefix. If the key doesn't have it, it's not in the leaf.
+  const auto* prefix =
+    buffer.data() + node_view::k_keys_count_size + node_view::k_prefix_length_size;
+  if (std::memcmp(key.data(), prefix, parts.prefix_length) != 0) {
+    ptr = btree_node::k_unused_pointer;
+    return false;
+  }
+
+  const auto* suffix = key.data() + parts.prefix_length;
+  const auto key_size = parts.stored_key_size;
+  const auto keys_offset = offset + parts.keys_offset;
+
+  auto first = 0u;
+  auto count = parts.keys_count;
+
+  if (parts.summary_offset > 0u && summary_fits) {
+    const auto range = node_view::summary_range(buffer.data() + parts.summary_offset,
+                                                parts.keys_count, key_size, suffix);
+    first = range.first;
+    count = range.count;
+  }
+
+  while (uint64_t{ count } * key_size > k_partial_read_window_size) {
+    const auto step = count / 2u;
+    const auto middle = first + step;
+    read_part(keys_offset + uint64_t{ middle } * key_size, buffer.data(), key_size);
+
+    if (std::memcmp(buffer.data(), suffix, key_size) < 0) {
+      first = middle + 1u;
+      count -= step + 1u;
+    } else {
+      count = step;
+    }
+  }
+
+  // The key right after the range is read too, as it's the searched one if it's greater than all
+  // the keys of the range.
+  const auto window_count = std::min(count + 1u, parts.keys_count - first);
+  read_part(keys_offset + uint64_t{ first } * key_size, buffer.data(),
+            uint64_t{ window_count } * key_size);
+
+  const auto in_window = node_view::lower_bound(buffer.data(), count, key_size, suffix);
+  if (in_window < window_count &&
+      std::memcmp(buffer.data() + uint64_t{ in_window } * key_size, suffix, key_size) == 0) {
     return true;
   }
 
-  if (node.is_leaf) {
+  if (parts.is_leaf) {
+    ptr = btree_node::k_unused_pointer;
     return false;
   }
 
-  const auto place = node.place_for(sha1);
-  const auto next_node_ptr = node.pointers[place];
-  const auto next_node = this->read_node(next_node_ptr);
-  return contains(next_node, sha1);
+  const auto place = uint64_t{ first + in_window };
+  read_part(offset + parts.pointers_offset + place * sizeof(btree_node::pointer_t), &ptr,
+            sizeof(ptr));
+  return false;
 }
 
-template <typename DataStorage>
-btree_node btree<DataStorage>::read_root() const
+template <typename DataStorage, typename Key>
+void btree<DataStorage, Key>::read_part(uint64_t offset, void* data, uint64_t size) const
 {
-  return this->read_node(this->root_ptr());
+  {
+    const auto lock = lock_storage();
+    this->read_bytes(offset, data, size);
+  }
+
+  metrics::record_bytes_read(size);
 }
 }
@@ -1,15 +1,33 @@
 #pragma once
 
 #include "btree_node.hpp"
+#include "file_header.hpp"
+#include "node_view.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <type_traits>
+#include <vector>
 
 namespace okon {
 
+// Whether the storage reads at a given offset without seeking, e.g. pread_file. Such reads don't
+// share a position, so they can be done concurrently.
+template <typename DataStorage, typename = void>
+constexpr bool has_positional_read_v{ false };
+
 template <typename DataStorage>
+constexpr bool has_positional_read_v<
+  DataStorage,
+  std::void_t<decltype(std::declval<const DataStorage&>().read_at(0u, nullptr, 0u))>>{ true };
+
+template <typename DataStorage, typename Key = sha1_t>
 class btree_base
 {
 public:
+  using key_t = Key;
+  using node_t = basic_btree_node<Key>;
+
   explicit btree_base(DataStorage& storage, btree_node::order_t order);
   explicit btree_base(DataStorage& storage);
 
@@ -17,58 +35,187 @@ protected:
   explicit btree_base(DataStorage& storage, btree_node::order_t order,
                       btree_node::pointer_t root_ptr);
 
-  btree_node read_node(btree_node::pointer_t ptr) const;
-  void write_node(const btree_node& node) const;
+  // Creates a tree of the given header and writes the header out.
+  explicit btree_base(DataStorage& storage, const file_header& header);
+
+  node_t read_node(btree_node::pointer_t ptr) const;
+  void write_node(const node_t& node) const;
+
+  // Reads the node as it's stored, without decoding it. See node_view.
+  void read_node_bytes(btree_node::pointer_t ptr, node_bytes_t& bytes) const;
+  void read_bytes(uint64_t offset, void* data, uint64_t size) const;
+  node_format format_of(btree_node::pointer_t ptr) const;
+
+  // Pointer to the leaf that is stored right after the given one, k_unused_pointer if it's the
+  // last one. leaf_size is the number of bytes the given leaf takes. Only for files with
+  // file_flag_bplus_tree.
+  btree_node::pointer_t next_leaf_ptr(btree_node::pointer_t ptr, uint64_t leaf_size) const;
 
   void set_root_ptr(btree_node::pointer_t ptr);
   btree_node::pointer_t root_ptr() const;
-  constexpr uint64_t tree_offset() const;
+  uint64_t tree_offset() const;
   uint64_t node_offset(btree_node::pointer_t ptr) const;
   btree_node::order_t order() const;
+  const file_header& header() const;
+
+  // Replaces the header and writes it out.
+  void set_header(const file_header& header);
 
-  unsigned expected_min_number_of_keys(const btree_node& node) const;
+  unsigned expected_min_number_of_keys(const node_t& node) const;
+
+private:
+  node_t read_legacy_node(btree_node::pointer_t ptr) const;
+  node_t read_compact_node(btree_node::pointer_t ptr) const;
+  void write_legacy_node(const node_t& node) const;
+  void write_compact_node(const node_t& node) const;
+  void write_prefix_compressed_leaf(const node_t& node) const;
 
 private:
   DataStorage& m_storage;
-  btree_node::order_t m_order{};
-  btree_node::pointer_t m_root_ptr{ 0u };
+  file_header m_header;
 };
 
-template <typename DataStorage>
-btree_base<DataStorage>::btree_base(DataStorage& storage, btree_node::order_t order)
+template <typename DataStorage, typename Key>
+btree_base<DataStorage, Key>::btree_base(DataStorage& storage, btree_node::order_t order)
   : m_storage{ storage }
-  , m_order{ order }
 {
+  m_header.format = file_format::legacy;
+  m_header.header_size = file_header::k_legacy_header_size;
+  m_header.order = order;
+  m_header.stored_key_size = sizeof(Key);
+  m_header.key_size = sizeof(Key);
+
   m_storage.seek_out(0u);
-  m_storage.write(&m_order, sizeof(m_order));
+  m_storage.write(&m_header.order, sizeof(m_header.order));
 }
 
-template <typename DataStorage>
-btree_base<DataStorage>::btree_base(DataStorage& storage)
+template <typename DataStorage, typename Key>
+btree_base<DataStorage, Key>::btree_base(DataStorage& storage)
   : m_storage{ storage }
+  , m_header{ read_file_header(storage) }
 {
-  m_storage.seek_in(0u);
-  m_storage.read(&m_order, sizeof(m_order));
-  m_storage.read(&m_root_ptr, sizeof(m_root_ptr));
 }
 
-template <typename DataStorage>
-void btree_base<DataStorage>::set_root_ptr(btree_node::pointer_t ptr)
+template <typename DataStorage, typename Key>
+btree_base<DataStorage, Key>::btree_base(DataStorage& storage, const file_header& header)
+  : m_storage{ storage }
+  , m_header{ header }
 {
-  m_root_ptr = ptr;
-  constexpr auto root_ptr_offset = sizeof(m_order);
-  m_storage.seek_out(root_ptr_offset);
-  m_storage.write(&m_root_ptr, sizeof(btree_node::pointer_t));
+  write_file_header(m_storage, m_header);
 }
 
-template <typename DataStorage>
-btree_node btree_base<DataStorage>::read_node(btree_node::pointer_t ptr) const
+template <typename DataStorage, typename Key>
+void btree_base<DataStorage, Key>::set_root_ptr(btree_node::pointer_t ptr)
+{
+  m_header.root_ptr = ptr;
+
+  if (m_header.format == file_format::legacy) {
+    m_storage.seek_out(file_header::k_root_ptr_offset_in_legacy_header);
+    m_storage.write(&m_header.root_ptr, sizeof(btree_node::pointer_t));
+  } else {
+    write_file_header(m_storage, m_header);
+  }
+}
+
+template <typename DataStorage, typename Key>
+typename btree_base<DataStorage, Key>::node_t btree_base<DataStorage, Key>::read_node(
+  btree_node::pointer_t ptr) const
+{
+  return m_header.format == file_format::legacy ? read_legacy_node(ptr) : read_compact_node(ptr);
+}
+
+template <typename DataStorage, typename Key>
+void btree_base<DataStorage, Key>::read_node_bytes(btree_node::pointer_t ptr,
+                                                   node_bytes_t& bytes) const
+{
+  const auto format = format_of(ptr);
+
+  if constexpr (has_positional_read_v<DataStorage>) {
+    // One read of the maximal size instead of two. The last node of the file can be shorter.
+    bytes.resize(node_view::max_stored_size(format));
+    const auto read_size = m_storage.read_at(node_offset(ptr), bytes.data(), bytes.size());
+    std::fill(std::next(bytes.begin(), static_cast<std::ptrdiff_t>(read_size)), bytes.end(),
+              uint8_t{ 0u });
+    bytes.resize(node_view::stored_size(format, bytes.data()));
+    return;
+  }
+
+  const auto fixed_part_size = node_view::fixed_part_size(format);
+
+  bytes.resize(fixed_part_size);
+  m_storage.seek_in(node_offset(ptr));
+  m_storage.read(bytes.data(), fixed_part_size);
+
+  const auto size = node_view::stored_size(format, bytes.data());
+  bytes.resize(size);
+  m_storage.read(bytes.data() + fixed_part_size, size - fixed_part_size);
+}
+
+template <typename DataStorage, typename Key>
+void btree_base<DataStorage, Key>::read_bytes(uint64_t offset, void* data, uint64_t size) const
 {
-  const auto pointers_size = btree_node::binary_pointers_size(this->order());
-  const auto keys_size = btree_node::binary_keys_size(this->order());
+  if constexpr (has_positional_read_v<DataStorage>) {
+    m_storage.read_at(offset, data, size);
+    return;
+  }
+
+  m_storage.seek_in(offset);
+  m_storage.read(data, size);
+}
+
+template <typename DataStorage, typename Key>
+node_format btree_base<DataStorage, Key>::format_of(btree_node::pointer_t ptr) const
+{
+  if (m_header.format == file_format::legacy) {
+    return node_format{ node_layout::legacy, this->order(), sizeof(Key) };
+  }
+
+  const auto layout = [this, ptr] {
+    if ((ptr & btree_node::k_leaf_pointer_flag) == 0u) {
+      return node_layout::compact_inner;
+    }
+
+    return m_header.has_flag(file_flag_prefix_compressed_leaves)
+      ? node_layout::prefix_compressed_leaf
+      : node_layout::compact_leaf;
+  }();
+
+  return node_format{ layout, this->order(), m_header.stored_key_size,
+                      m_header.has_flag(file_flag_node_summaries) };
+}
+
+template <typename DataStorage, typename Key>
+btree_node::pointer_t btree_base<DataStorage, Key>::next_leaf_ptr(btree_node::pointer_t ptr,
+                                                                  uint64_t leaf_size) const
+{
+  const auto position = uint64_t{ ptr & ~btree_node::k_leaf_pointer_flag };
+
+  if (m_header.has_flag(file_flag_prefix_compressed_leaves)) {
+    const auto next_position =
+      position + (leaf_size + k_compressed_leaf_alignment - 1u) / k_compressed_leaf_alignment;
+    if (next_position * k_compressed_leaf_alignment >= m_header.leaves_size) {
+      return btree_node::k_unused_pointer;
+    }
+
+    return btree_node::k_leaf_pointer_flag | static_cast<btree_node::pointer_t>(next_position);
+  }
+
+  if (position + 1u >= m_header.leaf_nodes_count) {
+    return btree_node::k_unused_pointer;
+  }
+
+  return btree_node::k_leaf_pointer_flag | static_cast<btree_node::pointer_t>(position + 1u);
+}
+
+template <typename DataStorage, typename Key>
+typename btree_base<DataStorage, Key>::node_t btree_base<DataStorage, Key>::read_legacy_node(
+  btree_node::pointer_t ptr) const
+{
+  const auto pointers_size = node_t::binary_pointers_size(this->order());
+  const auto keys_size = node_t::binary_keys_size(this->order());
   const uint64_t offset = node_offset(ptr);
 
-  btree_node node{ this->order(), btree_node::k_unused_pointer };
+  node_t node{ this->order(), btree_node::k_unused_pointer };
 
   m_storage.seek_in(offset);
   m_storage.read(&node.is_leaf, sizeof(node.is_leaf));
@@ -82,11 +229,55 @@ btree_node btree_base<DataStorage>::read_node(btree_node::pointer_t ptr) const
   return node;
 }
 
-template <typename DataStorage>
-void btree_base<DataStorage>::write_node(const okon::btree_node& node) const
+template <typename DataStorage, typename Key>
+typename btree_base<DataStorage, Key>::node_t btree_base<DataStorage, Key>::read_compact_node(
+  btree_node::pointer_t ptr) const
+{
+  node_bytes_t bytes;
+  read_node_bytes(ptr, bytes);
+  const node_view view{ format_of(ptr), bytes.data() };
+
+  node_t node{ this->order(), btree_node::k_unused_pointer };
+  node.is_leaf = view.is_leaf();
+  node.keys_count = view.keys_count();
+
+  if (!node.is_leaf) {
+    for (auto i = 0u; i < node.pointers.size(); ++i) {
+      node.pointers[i] = view.child(i);
+    }
+  }
+
+  // Only the used keys are read. The rest of the node is never accessed.
+  for (auto i = 0u; i < node.keys_count; ++i) {
+    node.keys[i] = view.template key<Key>(i);
+  }
+
+  node.this_pointer = ptr;
+
+  return node;
+}
+
+template <typename DataStorage, typename Key>
+void btree_base<DataStorage, Key>::write_node(const node_t& node) const
+{
+  switch (format_of(node.this_pointer).layout) {
+    case node_layout::legacy:
+      write_legacy_node(node);
+      break;
+    case node_layout::prefix_compressed_leaf:
+      write_prefix_compressed_leaf(node);
+      break;
+    default:
+      write_compact_node(node);
+      break;
+  }
+}
+
+template <typename DataStorage, typename Key>
+void btree_base<DataStorage, Key>::write_legacy_node(const node_t& node) const
 {
-  const auto pointers_size = btree_node::binary_pointers_size(m_order);
-  const auto keys_size = btree_node::binary_keys_size(m_order);
+  const auto pointers_size = node_t::binary_pointers_size(this->order());
+  const auto keys_size = node_t::binary_keys_size(this->order());
   const uint64_t offset = node_offset(node.this_pointer);
 
   m_storage.seek_out(offset);
@@ -98,31 +289,119 @@ void btree_base<DataStorage>::write_node(const okon::btree_node& node) const
   m_storage.write(&node.parent_pointer, sizeof(node.parent_pointer));
 }
 
-template <typename DataStorage>
-constexpr uint64_t btree_base<DataStorage>::tree_offset() const
+template <typename DataStorage, typename Key>
+void btree_base<DataStorage, Key>::write_compact_node(const node_t& node) const
 {
-  return sizeof(m_order) + sizeof(m_root_ptr);
+  const uint64_t offset = node_offset(node.this_pointer);
+
+  m_storage.seek_out(offset);
+
+  m_storage.write(&node.keys_count, sizeof(node.keys_count));
+
+  const auto format = format_of(node.this_pointer);
+  if (const auto summary_size = node_view::summary_size(format); summary_size > 0u) {
+    std::vector<uint8_t> summary(summary_size);
+    write_summary(node, format, summary.data());
+    m_storage.write(summary.data(), summary_size);
+  }
+
+  if (!node.is_leaf) {
+    m_storage.write(node.pointers.data(), node_t::binary_pointers_size(this->order()));
+  }
+
+  const auto key_size = m_header.stored_key_size;
+  if (key_size == sizeof(Key)) {
+    m_storage.write(node.keys.data(), node_t::binary_keys_size(this->order()));
+    return;
+  }
+
+  for (const auto& key : node.keys) {
+    m_storage.write(key.data(), key_size);
+  }
 }
 
-template <typename DataStorage>
-uint64_t btree_base<DataStorage>::node_offset(btree_node::pointer_t ptr) const
+template <typename DataStorage, typename Key>
+void btree_base<DataStorage, Key>::write_prefix_compressed_leaf(const node_t& node) const
+{
+  const auto key_size = m_header.stored_key_size;
+  const auto prefix_length = common_prefix_length(node, key_size);
+  const auto stored_prefix_length = static_cast<uint8_t>(prefix_length);
+  const uint64_t offset = node_offset(node.this_pointer);
+
+  m_storage.seek_out(offset);
+
+  m_storage.write(&node.keys_count, sizeof(node.keys_count));
+  m_storage.write(&stored_prefix_length, sizeof(stored_prefix_length));
+
+  if (node.keys_count > 0u) {
+    m_storage.write(node.keys[0].data(), prefix_length);
+  }
+
+  for (auto i = 0u; i < node.keys_count; ++i) {
+    m_storage.write(node.keys[i].data() + prefix_length, key_size - prefix_length);
+  }
+}
+
+template <typename DataStorage, typename Key>
+uint64_t btree_base<DataStorage, Key>::tree_offset() const
 {
-  return tree_offset() + uint64_t{ btree_node::binary_size(m_order) } * uint64_t{ ptr };
+  return m_header.header_size;
 }
 
-template <typename DataStorage>
-uint32_t btree_base<DataStorage>::order() const
+template <typename DataStorage, typename Key>
+uint64_t btree_base<DataStorage, Key>::node_offset(btree_node::pointer_t ptr) const
 {
-  return m_order;
+  if (m_header.format == file_format::legacy) {
+    return tree_offset() + uint64_t{ node_t::binary_size(this->order()) } * uint64_t{ ptr };
+  }
+
+  const auto inner_size = node_view::max_stored_size(format_of(0u));
+  const auto leaves_first = m_header.has_flag(file_flag_bplus_tree);
+
+  if ((ptr & btree_node::k_leaf_pointer_flag) == 0u) {
+    const auto inner_nodes_offset = tree_offset() + (leaves_first ? m_header.leaves_size : 0u);
+    return inner_nodes_offset + inner_size * uint64_t{ ptr };
+  }
+
+  const auto leaf_position = uint64_t{ ptr & ~btree_node::k_leaf_pointer_flag };
+  const auto leaves_offset =
+    tree_offset() + (leaves_first ? 0u : inner_size * uint64_t{ m_header.inner_nodes_count });
+
+  if (m_header.has_flag(file_flag_prefix_compressed_leaves)) {
+    return leaves_offset + k_compressed_leaf_alignment * leaf_position;
+  }
+
+  const auto leaf_size = node_view::max_stored_size(format_of(btree_node::k_leaf_pointer_flag));
+  return leaves_offset + leaf_size * leaf_position;
 }
 
-template <typename DataStorage>
-btree_node::pointer_t btree_base<DataStorage>::root_ptr() const
+template <typename DataStorage, typename Key>
+uint32_t btree_base<DataStorage, Key>::order() const
 {
-  return m_root_ptr;
+  return m_header.order;
 }
-template <typename DataStorage>
-unsigned btree_base<DataStorage>::expected_min_number_of_keys(const btree_node& node) const
+
+template <typename DataStorage, typename Key>
+btree_node::pointer_t btree_base<DataStorage, Key>::root_ptr() const
+{
+  return m_header.root_ptr;
+}
+
+template <typename DataStorage, typename Key>
+const file_header& btree_base<DataStorage, Key>::header() const
+{
+  return m_header;
+}
+
+template <typename DataStorage, typename Key>
+void btree_base<DataStorage, Key>::set_header(const file_header& header)
+{
+  m_header = header;
+  write_file_header(m_storage, m_header);
+}
+
+template <typename DataStorage, typename Key>
+unsigned btree_base<DataStorage, Key>::expected_min_number_of_keys(const node_t& node) const
 {
   return node.this_pointer == this->root_ptr()
     ? 1u
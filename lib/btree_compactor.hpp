@@ -0,0 +1,261 @@
+#pragma once
+
+#include "btree_base.hpp"
+#include "file_header.hpp"
+
+#include <cassert>
+#include <vector>
+
+namespace okon {
+
+struct compact_format_options
+{
+  // Bitset of file_flags.
+  uint32_t flags{ 0u };
+
+  // See file_header::stored_key_size. Zero, or a value not less than the key width, stores whole
+  // keys.
+  uint32_t stored_key_size{ 0u };
+};
+
+// Number of bytes of every key that the options store.
+template <typename Key>
+uint32_t stored_key_size_of(const compact_format_options& options)
+{
+  const auto whole_keys = (options.stored_key_size == 0u || options.stored_key_size > sizeof(Key));
+  return whole_keys ? sizeof(Key) : options.stored_key_size;
+}
+
+// Rewrites a tree of the legacy layout into the compact one (see file_format::compact), with
+// optional features enabled by file_flags.
+// Inner nodes are written level by level, starting from the root. Leaves are written in key
+// order, so they are laid out contiguously at the end of the file.
+template <typename DataStorage, typename Key = sha1_t>
+class btree_compactor
+{
+public:
+  explicit btree_compactor(DataStorage& source, DataStorage& destination,
+                           compact_format_options options = {});
+
+  void compact();
+
+private:
+  class source_tree : public btree_base<DataStorage, Key>
+  {
+  public:
+    explicit source_tree(DataStorage& storage)
+      : btree_base<DataStorage, Key>{ storage }
+    {
+    }
+
+    using btree_base<DataStorage, Key>::order;
+    using btree_base<DataStorage, Key>::read_node;
+    using btree_base<DataStorage, Key>::root_ptr;
+  };
+
+  class destination_tree : public btree_base<DataStorage, Key>
+  {
+  public:
+    explicit destination_tree(DataStorage& storage, const file_header& header)
+      : btree_base<DataStorage, Key>{ storage, header }
+    {
+    }
+
+    using btree_base<DataStorage, Key>::set_header;
+    using btree_base<DataStorage, Key>::write_node;
+  };
+
+  using level_t = std::vector<btree_node::pointer_t>;
+
+  struct written_leaves
+  {
+    // In the order of the source leaves.
+    level_t pointers;
+    uint64_t keys_count{ 0u };
+  };
+
+  std::vector<level_t> collect_levels(const source_tree& source) const;
+  file_header make_header(const source_tree& source, const std::vector<level_t>& levels) const;
+
+  written_leaves write_leaves(const source_tree& source, const destination_tree& destination,
+                              const level_t& leaves) const;
+
+  // Returns the number of keys of the written nodes.
+  uint64_t write_inner_nodes(const source_tree& source, const destination_tree& destination,
+                             const std::vector<level_t>& levels, const level_t& leaf_ptrs) const;
+
+  static void clear_unused_keys(basic_btree_node<Key>& node);
+
+private:
+  DataStorage& m_source;
+  DataStorage& m_destination;
+  compact_format_options m_options;
+};
+
+template <typename DataStorage, typename Key>
+btree_compactor<DataStorage, Key>::btree_compactor(DataStorage& source,
+                                                   DataStorage& destination,
+                                                   compact_format_options options)
+  : m_source{ source }
+  , m_destination{ destination }
+  , m_options{ options }
+{
+  m_options.stored_key_size = stored_key_size_of<Key>(options);
+}
+
+template <typename DataStorage, typename Key>
+void btree_compactor<DataStorage, Key>::compact()
+{
+  const source_tree source{ m_source };
+  const auto levels = collect_levels(source);
+  auto header = make_header(source, levels);
+  destination_tree destination{ m_destination, header };
+
+  // Size of a compressed leaf is known only after reading it, so the leaves are written first.
+  // Inner nodes pointing to them are written afterwards, into the region before the leaves.
+  const auto leaves = write_leaves(source, destination, levels.back());
+  const auto inner_keys_count = write_inner_nodes(source, destination, levels, leaves.pointers);
+
+  header.keys_count = leaves.keys_count + inner_keys_count;
+  destination.set_header(header);
+}
+
+template <typename DataStorage, typename Key>
+typename btree_compactor<DataStorage, Key>::written_leaves
+btree_compactor<DataStorage, Key>::write_leaves(const source_tree& source,
+                                                const destination_tree& destination,
+                                                const level_t& leaves) const
+{
+  const auto compressed = (m_options.flags & file_flag_prefix_compressed_leaves) != 0u;
+
+  written_leaves written;
+  written.pointers.reserve(leaves.size());
+
+  uint64_t next_leaf_position{ 0u };
+
+  for (const auto ptr : leaves) {
+    auto node = source.read_node(ptr);
+    clear_unused_keys(node);
+
+    assert(next_leaf_position < btree_node::k_leaf_pointer_flag);
+    node.this_pointer =
+      btree_node::k_leaf_pointer_flag | static_cast<btree_node::pointer_t>(next_leaf_position);
+    destination.write_node(node);
+    written.pointers.push_back(node.this_pointer);
+    written.keys_count += node.keys_count;
+
+    if (compressed) {
+      const auto size = prefix_compressed_leaf_size(node, m_options.stored_key_size);
+      next_leaf_position += (size + k_compressed_leaf_alignment - 1u) / k_compressed_leaf_alignment;
+    } else {
+      ++next_leaf_position;
+    }
+  }
+
+  return written;
+}
+
+template <typename DataStorage, typename Key>
+uint64_t btree_compactor<DataStorage, Key>::write_inner_nodes(const source_tree& source,
+                                                          const destination_tree& destination,
+                                                          const std::vector<level_t>& levels,
+                                                          const level_t& leaf_ptrs) const
+{
+  btree_node::pointer_t next_inner_ptr{ 0u };
+  btree_node::pointer_t level_begin_ptr{ 0u };
+  uint64_t keys_count{ 0u };
+
+  for (auto level = 0u; level + 1u < levels.size(); ++level) {
+    const auto children_are_leaves = (level + 2u == levels.size());
+
+    level_begin_ptr += static_cast<btree_node::pointer_t>(levels[level].size());
+    auto next_child_ptr = level_begin_ptr;
+    auto next_leaf_index = 0u;
+
+    for (const auto ptr : levels[level]) {
+      auto node = source.read_node(ptr);
+      node.this_pointer = next_inner_ptr++;
+
+      for (auto i = 0u; i < node.pointers.size(); ++i) {
+        const auto has_child =
+          (i <= node.keys_count && node.pointers[i] != btree_node::k_unused_pointer);
+
+        if (!has_child) {
+          node.pointers[i] = btree_node::k_unused_pointer;
+        } else if (children_are_leaves) {
+          node.pointers[i] = leaf_ptrs[next_leaf_index++];
+        } else {
+          node.pointers[i] = next_child_ptr++;
+        }
+      }
+
+      clear_unused_keys(node);
+      destination.write_node(node);
+      keys_count += node.keys_count;
+    }
+  }
+
+  return keys_count;
+}
+
+template <typename DataStorage, typename Key>
+std::vector<typename btree_compactor<DataStorage, Key>::level_t>
+btree_compactor<DataStorage, Key>::collect_levels(const source_tree& source) const
+{
+  std::vector<level_t> levels{ level_t{ source.root_ptr() } };
+
+  // All the leaves are on the same level, so it's enough to check the first node of a level.
+  while (!source.read_node(levels.back().front()).is_leaf) {
+    level_t next_level;
+
+    for (const auto ptr : levels.back()) {
+      const auto node = source.read_node(ptr);
+
+      for (auto i = 0u; i <= node.keys_count; ++i) {
+        if (node.pointers[i] != btree_node::k_unused_pointer) {
+          next_level.push_back(node.pointers[i]);
+        }
+      }
+    }
+
+    levels.emplace_back(std::move(next_level));
+  }
+
+  return levels;
+}
+
+template <typename DataStorage, typename Key>
+file_header btree_compactor<DataStorage, Key>::make_header(
+  const source_tree& source, const std::vector<level_t>& levels) const
+{
+  file_header header;
+  header.format = file_format::compact;
+  header.header_size = file_header::k_compact_header_size;
+  header.order = source.order();
+  header.leaf_nodes_count = static_cast<uint32_t>(levels.back().size());
+
+  for (auto level = 0u; level + 1u < levels.size(); ++level) {
+    header.inner_nodes_count += static_cast<uint32_t>(levels[level].size());
+  }
+
+  header.height = static_cast<uint32_t>(levels.size());
+  for (auto level = 0u; level < levels.size() && level < file_header::k_max_levels_in_header;
+       ++level) {
+    header.level_nodes_counts[level] = static_cast<uint32_t>(levels[level].size());
+  }
+
+  const auto root_is_leaf = (levels.size() == 1u);
+  header.root_ptr = root_is_leaf ? btree_node::k_leaf_pointer_flag : 0u;
+  header.flags = m_options.flags;
+  header.stored_key_size = m_options.stored_key_size;
+  header.key_size = sizeof(Key);
+
+  return header;
+}
+
+template <typename DataStorage, typename Key>
+void btree_compactor<DataStorage, Key>::clear_unused_keys(basic_btree_node<Key>& node)
+{
+  std::fill(std::next(std::begin(node.keys), node.keys_count), std::end(node.keys), Key{});
+}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "btree_base.hpp"
+#include "node_view.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace okon {
+
+// Reads all the keys of a tree in ascending order, with one pass over its nodes. Works with files
+// of every layout. Only the nodes on the path from the root to the current key are kept in memory.
+// Keys of a file with truncated keys (see file_header::stored_key_size) are zero padded. Leaves of
+// a file with file_flag_bplus_tree are read one after another, without visiting inner nodes.
+template <typename DataStorage, typename Key = sha1_t>
+class btree_keys_reader : public btree_base<DataStorage, Key>
+{
+public:
+  explicit btree_keys_reader(DataStorage& storage);
+
+  std::optional<Key> next_key();
+
+private:
+  struct path_part
+  {
+    btree_node::pointer_t ptr{ btree_node::k_unused_pointer };
+    node_bytes_t bytes;
+
+    // Index of the child to descend into, or of the key to return after the child was visited.
+    uint32_t place{ 0u };
+    bool child_visited{ false };
+  };
+
+  void descend(btree_node::pointer_t ptr);
+
+private:
+  std::vector<path_part> m_path;
+};
+
+template <typename DataStorage, typename Key>
+btree_keys_reader<DataStorage, Key>::btree_keys_reader(DataStorage& storage)
+  : btree_base<DataStorage, Key>{ storage }
+{
+  // The first leaf is at the beginning of the leaves.
+  descend(this->header().has_flag(file_flag_bplus_tree) ? btree_node::k_leaf_pointer_flag
+                                                       : this->root_ptr());
+}
+
+template <typename DataStorage, typename Key>
+std::optional<Key> btree_keys_reader<DataStorage, Key>::next_key()
+{
+  while (!m_path.empty()) {
+    auto& current = m_path.back();
+    const node_view view{ this->format_of(current.ptr), current.bytes.data() };
+
+    if (!current.child_visited) {
+      current.child_visited = true;
+      if (current.place <= view.keys_count()) {
+        descend(view.child(current.place));
+      }
+      continue;
+    }
+
+    if (current.place < view.keys_count()) {
+      const auto key = view.template key<Key>(current.place);
+      ++current.place;
+      current.child_visited = false;
+      return key;
+    }
+
+    if (this->header().has_flag(file_flag_bplus_tree)) {
+      const auto next_leaf_ptr = this->next_leaf_ptr(current.ptr, current.bytes.size());
+      m_path.pop_back();
+      descend(next_leaf_ptr);
+      continue;
+    }
+
+    m_path.pop_back();
+  }
+
+  return std::nullopt;
+}
+
+template <typename DataStorage, typename Key>
+void btree_keys_reader<DataStorage, Key>::descend(btree_node::pointer_t ptr)
+{
+  if (ptr == btree_node::k_unused_pointer) {
+    return;
+  }
+
+  auto& part = m_path.emplace_back();
+  part.ptr = ptr;
+  this->read_node_bytes(ptr, part.bytes);
+}
+}
@@ -2,32 +2,41 @@
 
 #include "sha1_utils.hpp"
 
+#include <algorithm>
 #include <cstdint>
 #include <limits>
 #include <optional>
 #include <vector>
 
 namespace okon {
-class btree_node
+template <typename Key>
+class basic_btree_node
 {
 public:
   using pointer_t = uint32_t;
   using order_t = uint32_t;
 
   static constexpr auto k_unused_pointer = std::numeric_limits<pointer_t>::max();
+  static constexpr pointer_t k_leaf_pointer_flag = pointer_t{ 1u } << 31u;
 
-  explicit btree_node(order_t order, pointer_t parent_ptr);
+  using key_t = Key;
+
+  explicit basic_btree_node(order_t order, pointer_t parent_ptr);
 
   static uint64_t binary_size(order_t order);
   static uint64_t binary_pointers_size(order_t order);
   static uint64_t binary_keys_size(order_t order);
 
-  uint32_t insert(const sha1_t& sha1);
-  void push_back(const sha1_t& sha1);
+  // key_size is the number of leading bytes of every key that are stored.
+  static uint64_t compact_inner_binary_size(order_t order, uint32_t key_size = sizeof(Key));
+  static uint64_t compact_leaf_binary_size(order_t order, uint32_t key_size = sizeof(Key));
+
+  uint32_t insert(const Key& key);
+  void push_back(const Key& key);
 
   order_t order() const;
-  uint32_t place_for(const sha1_t& sha1) const;
-  bool contains(const sha1_t& sha1) const;
+  uint32_t place_for(const Key& key) const;
+  bool contains(const Key& key) const;
 
   bool is_full() const;
 
@@ -41,9 +50,146 @@ public:
   bool is_leaf{ false };
   pointer_t keys_count{ 0u };
   std::vector<pointer_t> pointers;
-  std::vector<sha1_t> keys;
+  std::vector<Key> keys;
   pointer_t parent_pointer{ k_unused_pointer };
 
   pointer_t this_pointer{};
 };
+
+using btree_node = basic_btree_node<sha1_t>;
+
+template <typename Key>
+basic_btree_node<Key>::basic_btree_node(uint32_t order, pointer_t parent_ptr)
+  : pointers(order + 1, k_unused_pointer)
+  , keys{ order }
+  , parent_pointer{ parent_ptr }
+{
+}
+
+template <typename Key>
+uint64_t basic_btree_node<Key>::binary_size(uint32_t order)
+{
+  return sizeof(is_leaf) + sizeof(keys_count) + binary_pointers_size(order) +
+    binary_keys_size(order) + sizeof(parent_pointer);
+}
+
+template <typename Key>
+uint64_t basic_btree_node<Key>::binary_pointers_size(uint32_t order)
+{
+  return (order + 1) * sizeof(pointer_t);
+}
+
+template <typename Key>
+uint64_t basic_btree_node<Key>::binary_keys_size(uint32_t order)
+{
+  return order * sizeof(Key);
+}
+
+template <typename Key>
+uint64_t basic_btree_node<Key>::compact_inner_binary_size(uint32_t order, uint32_t key_size)
+{
+  return sizeof(keys_count) + binary_pointers_size(order) + uint64_t{ order } * key_size;
+}
+
+template <typename Key>
+uint64_t basic_btree_node<Key>::compact_leaf_binary_size(uint32_t order, uint32_t key_size)
+{
+  return sizeof(keys_count) + uint64_t{ order } * key_size;
+}
+
+template <typename Key>
+uint32_t basic_btree_node<Key>::insert(const Key& key)
+{
+  const auto place = place_for(key);
+
+  if (keys_count > 0) {
+    for (auto i = keys_count - 1; i >= place; --i) {
+      keys[i + 1] = keys[i];
+    }
+  }
+
+  keys[place] = key;
+  ++keys_count;
+
+  return place;
+}
+
+template <typename Key>
+void basic_btree_node<Key>::push_back(const Key& key)
+{
+  keys[keys_count] = key;
+  ++keys_count;
+}
+
+template <typename Key>
+uint32_t basic_btree_node<Key>::order() const
+{
+  return keys.size();
+}
+
+template <typename Key>
+uint32_t basic_btree_node<Key>::place_for(const Key& key) const
+{
+  const auto keys_end = std::next(std::cbegin(keys), keys_count);
+  const auto found = std::lower_bound(std::cbegin(keys), keys_end, key);
+  return std::distance(std::cbegin(keys), found);
+}
+
+template <typename Key>
+bool basic_btree_node<Key>::is_full() const
+{
+  return keys_count == order();
+}
+
+template <typename Key>
+bool basic_btree_node<Key>::contains(const Key& key) const
+{
+  const auto keys_end = std::next(std::cbegin(keys), keys_count);
+  const auto found = std::lower_bound(std::cbegin(keys), keys_end, key);
+
+  if (found == keys_end) {
+    return false;
+  }
+
+  return *found == key;
+}
+
+template <typename Key>
+typename basic_btree_node<Key>::pointer_t basic_btree_node<Key>::rightmost_pointer() const
+{
+  return pointers[keys_count];
+}
+
+template <typename Key>
+uint32_t basic_btree_node<Key>::children_count() const
+{
+  const auto found = std::find_if(std::cbegin(pointers), std::cend(pointers),
+                                  [](const auto& ptr) { return ptr == k_unused_pointer; });
+  return std::distance(std::cbegin(pointers), found);
+
+  return keys_count + 1u;
+}
+
+template <typename Key>
+std::optional<typename basic_btree_node<Key>::pointer_t>
+basic_btree_node<Key>::get_child_pointer_prev_of(pointer_t ptr) const
+{
+  const auto ptr_index = index_of_child_pointer(ptr);
+  if (!ptr_index.has_value() || *ptr_index == 0u) {
+    return std::nullopt;
+  }
+
+  return pointers[*ptr_index - 1u];
+}
+
+template <typename Key>
+std::optional<unsigned> basic_btree_node<Key>::index_of_child_pointer(pointer_t ptr) const
+{
+  const auto found = std::find(std::cbegin(pointers), std::cend(pointers), ptr);
+  if (found == std::cend(pointers)) {
+    return std::nullopt;
+  }
+
+  return static_cast<unsigned>(std::distance(std::cbegin(pointers), found));
+}
 }
@@ -8,10 +8,12 @@
 
 namespace okon {
 
-template <typename DataStorage>
-class btree_rebalancer : public btree_base<DataStorage>
+template <typename DataStorage, typename Key = sha1_t>
+class btree_rebalancer : public btree_base<DataStorage, Key>
 {
 public:
+  using node_t = basic_btree_node<Key>;
+
   explicit btree_rebalancer(DataStorage& storage, btree_node::pointer_t next_node_ptr,
                             unsigned tree_height);
 
@@ -19,21 +21,21 @@ public:
 
 private:
   btree_node::pointer_t new_node_pointer();
-  void create_nodes_to_fulfill_b_tree(btree_node& node, unsigned current_level);
+  void create_nodes_to_fulfill_b_tree(node_t& node, unsigned current_level);
   void rebalance_keys();
 
-  void rebalance_keys_in_node(btree_node& node);
+  void rebalance_keys_in_node(node_t& node);
 
   void initialize_current_key_providing_path();
 
-  unsigned get_number_of_keys_in_node_during_rebalance(const btree_node& node) const;
-  unsigned get_number_of_keys_taken_from_node_during_rebalance(const btree_node& node) const;
+  unsigned get_number_of_keys_in_node_during_rebalance(const node_t& node) const;
+  unsigned get_number_of_keys_taken_from_node_during_rebalance(const node_t& node) const;
 
-  sha1_t get_greatest_not_visited_key();
+  Key get_greatest_not_visited_key();
 
   struct keys_provider_path_part_data
   {
-    btree_node node;
+    node_t node;
     btree_node::pointer_t child_index{ btree_node::k_unused_pointer };
   };
 
@@ -50,18 +52,18 @@ private:
   std::unordered_set<btree_node::pointer_t> m_nodes_written_during_rebalancing;
 };
 
-template <typename DataStorage>
-btree_rebalancer<DataStorage>::btree_rebalancer(DataStorage& storage,
-                                                btree_node::pointer_t next_node_ptr,
-                                                unsigned tree_height)
-  : btree_base<DataStorage>{ storage }
+template <typename DataStorage, typename Key>
+btree_rebalancer<DataStorage, Key>::btree_rebalancer(DataStorage& storage,
+                                                     btree_node::pointer_t next_node_ptr,
+                                                     unsigned tree_height)
+  : btree_base<DataStorage, Key>{ storage }
   , m_next_node_ptr{ next_node_ptr }
   , m_tree_height{ tree_height }
 {
 }
 
-template <typename DataStorage>
-void btree_rebalancer<DataStorage>::rebalance()
+template <typename DataStorage, typename Key>
+void btree_rebalancer<DataStorage, Key>::rebalance()
 {
   const auto tree_is_empty = m_next_node_ptr == 0u;
   if (tree_is_empty) {
@@ -78,9 +80,9 @@ void btree_rebalancer<DataStorage>::rebalance()
   rebalance_keys();
 }
 
-template <typename DataStorage>
-void btree_rebalancer<DataStorage>::create_nodes_to_fulfill_b_tree(btree_node& node,
-                                                                   unsigned current_level)
+template <typename DataStorage, typename Key>
+void btree_rebalancer<DataStorage, Key>::create_nodes_to_fulfill_b_tree(node_t& node,
+                                                                        unsigned current_level)
 {
   if (node.is_leaf) {
     return;
@@ -106,7 +108,7 @@ void btree_rebalancer<DataStorage>::create_nodes_to_fulfill_b_tree(btree_node& n
   // Create missing children.
   for (auto child_index = children_count; child_index < expected_min_number_of_children;
        ++child_index) {
-    auto child = btree_node{ this->order(), node.this_pointer };
+    auto child = node_t{ this->order(), node.this_pointer };
     child.this_pointer = new_node_pointer();
     child.keys_count = 0u;
     child.is_leaf = children_are_leafs;
@@ -126,14 +128,14 @@ void btree_rebalancer<DataStorage>::create_nodes_to_fulfill_b_tree(btree_node& n
   this->write_node(node);
 }
 
-template <typename DataStorage>
-btree_node::pointer_t btree_rebalancer<DataStorage>::new_node_pointer()
+template <typename DataStorage, typename Key>
+btree_node::pointer_t btree_rebalancer<DataStorage, Key>::new_node_pointer()
 {
   return m_next_node_ptr++;
 }
 
-template <typename DataStorage>
-void btree_rebalancer<DataStorage>::rebalance_keys()
+template <typename DataStorage, typename Key>
+void btree_rebalancer<DataStorage, Key>::rebalance_keys()
 {
   auto root = this->read_node(this->root_ptr());
   rebalance_keys_in_node(root);
@@ -151,8 +153,8 @@ void btree_rebalancer<DataStorage>::rebalance_keys()
   }
 }
 
-template <typename DataStorage>
-void btree_rebalancer<DataStorage>::rebalance_keys_in_node(btree_node& node)
+template <typename DataStorage, typename Key>
+void btree_rebalancer<DataStorage, Key>::rebalance_keys_in_node(node_t& node)
 {
   if (node.is_leaf) {
     return;
@@ -206,10 +208,10 @@ void btree_rebalancer<DataStorage>::rebalance_keys_in_node(btree_node& node)
   }
 }
 
-template <typename DataStorage>
-void btree_rebalancer<DataStorage>::initialize_current_key_providing_path()
+template <typename DataStorage, typename Key>
+void btree_rebalancer<DataStorage, Key>::initialize_current_key_providing_path()
 {
-  std::vector<btree_node> nodes_path;
+  std::vector<node_t> nodes_path;
 
   // Go to rightmost leaf node.
   auto ptr = this->root_ptr();
@@ -236,9 +238,9 @@ void btree_rebalancer<DataStorage>::initialize_current_key_providing_path()
   }
 }
 
-template <typename DataStorage>
-unsigned btree_rebalancer<DataStorage>::get_number_of_keys_taken_from_node_during_rebalance(
-  const btree_node& node) const
+template <typename DataStorage, typename Key>
+unsigned btree_rebalancer<DataStorage, Key>::get_number_of_keys_taken_from_node_during_rebalance(
+  const node_t& node) const
 {
   const auto found = m_keys_took_by_provider.find(node.this_pointer);
   if (found == std::cend(m_keys_took_by_provider)) {
@@ -248,15 +250,15 @@ unsigned btree_rebalancer<DataStorage>::get_number_of_keys_taken_from_node_durin
   return found->second;
 }
 
-template <typename DataStorage>
-unsigned btree_rebalancer<DataStorage>::get_number_of_keys_in_node_during_rebalance(
-  const btree_node& node) const
+template <typename DataStorage, typename Key>
+unsigned btree_rebalancer<DataStorage, Key>::get_number_of_keys_in_node_during_rebalance(
+  const node_t& node) const
 {
   return node.keys_count - get_number_of_keys_taken_from_node_during_rebalance(node);
 }
 
-template <typename DataStorage>
-sha1_t btree_rebalancer<DataStorage>::get_greatest_not_visited_key()
+template <typename DataStorage, typename Key>
+Key btree_rebalancer<DataStorage, Key>::get_greatest_not_visited_key()
 {
   auto& current = current_key_providing_node();
 
@@ -315,9 +317,9 @@ sha1_t btree_rebalancer<DataStorage>::get_greatest_not_visited_key()
   return key;
 }
 
-template <typename DataStorage>
-typename btree_rebalancer<DataStorage>::keys_provider_path_part_data&
-btree_rebalancer<DataStorage>::current_key_providing_node()
+template <typename DataStorage, typename Key>
+typename btree_rebalancer<DataStorage, Key>::keys_provider_path_part_data&
+btree_rebalancer<DataStorage, Key>::current_key_providing_node()
 {
   return m_current_key_providing_path.back();
 }
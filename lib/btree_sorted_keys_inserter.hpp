@@ -8,33 +8,35 @@
 
 namespace okon {
 
-template <typename DataStorage>
-class btree_sorted_keys_inserter : public btree_base<DataStorage>
+template <typename DataStorage, typename Key = sha1_t>
+class btree_sorted_keys_inserter : public btree_base<DataStorage, Key>
 {
 public:
+  using node_t = basic_btree_node<Key>;
+
   explicit btree_sorted_keys_inserter(DataStorage& storage, btree_node::order_t order);
 
-  void insert_sorted(const sha1_t& sha1);
+  void insert_sorted(const Key& key);
   void finalize_inserting();
 
 private:
   btree_node::pointer_t new_node_pointer();
-  void split_node(const sha1_t& sha1, unsigned level_from_leafs = 0u);
-  void split_root_and_grow(const sha1_t& sha1, unsigned level_from_leafs);
+  void split_node(const Key& key, unsigned level_from_leafs = 0u);
+  void split_root_and_grow(const Key& key, unsigned level_from_leafs);
   void create_children_till_leaf(unsigned level_from_leafs);
-  btree_node& current_node();
+  node_t& current_node();
 
 private:
   DataStorage& m_storage;
   btree_node::pointer_t m_next_node_ptr{ 0u };
-  std::vector<btree_node> m_current_path;
+  std::vector<node_t> m_current_path;
   unsigned m_tree_height;
 };
 
-template <typename DataStorage>
-btree_sorted_keys_inserter<DataStorage>::btree_sorted_keys_inserter(DataStorage& storage,
-                                                                    btree_node::order_t order)
-  : btree_base<DataStorage>{ storage, order }
+template <typename DataStorage, typename Key>
+btree_sorted_keys_inserter<DataStorage, Key>::btree_sorted_keys_inserter(
+  DataStorage& storage, btree_node::order_t order)
+  : btree_base<DataStorage, Key>{ storage, order }
   , m_storage{ storage }
   , m_tree_height{ 1u }
 {
@@ -44,40 +46,40 @@ btree_sorted_keys_inserter<DataStorage>::btree_sorted_keys_inserter(DataStorage&
   root.is_leaf = true;
 }
 
-template <typename DataStorage>
-void btree_sorted_keys_inserter<DataStorage>::insert_sorted(const sha1_t& sha1)
+template <typename DataStorage, typename Key>
+void btree_sorted_keys_inserter<DataStorage, Key>::insert_sorted(const Key& key)
 {
   if (current_node().is_full()) {
-    split_node(sha1);
+    split_node(key);
   } else {
-    current_node().push_back(sha1);
+    current_node().push_back(key);
   }
 }
 
-template <typename DataStorage>
-void btree_sorted_keys_inserter<DataStorage>::finalize_inserting()
+template <typename DataStorage, typename Key>
+void btree_sorted_keys_inserter<DataStorage, Key>::finalize_inserting()
 {
   for (const auto& node : m_current_path) {
     this->write_node(node);
   }
 
-  btree_rebalancer rebalancer{ m_storage, m_next_node_ptr, m_tree_height };
+  btree_rebalancer<DataStorage, Key> rebalancer{ m_storage, m_next_node_ptr, m_tree_height };
   rebalancer.rebalance();
 }
 
-template <typename DataStorage>
-btree_node::pointer_t btree_sorted_keys_inserter<DataStorage>::new_node_pointer()
+template <typename DataStorage, typename Key>
+btree_node::pointer_t btree_sorted_keys_inserter<DataStorage, Key>::new_node_pointer()
 {
   return m_next_node_ptr++;
 }
 
-template <typename DataStorage>
-void btree_sorted_keys_inserter<DataStorage>::split_node(const sha1_t& sha1,
-                                                         unsigned level_from_leafs)
+template <typename DataStorage, typename Key>
+void btree_sorted_keys_inserter<DataStorage, Key>::split_node(const Key& key,
+                                                              unsigned level_from_leafs)
 {
   const auto is_root = (m_current_path.size() == 1u);
   if (is_root) {
-    return split_root_and_grow(sha1, level_from_leafs);
+    return split_root_and_grow(key, level_from_leafs);
   } else {
 
     this->write_node(current_node());
@@ -85,17 +87,17 @@ void btree_sorted_keys_inserter<DataStorage>::split_node(const sha1_t& sha1,
 
     auto& parent_node = current_node();
     if (parent_node.is_full()) {
-      return split_node(sha1, level_from_leafs + 1);
+      return split_node(key, level_from_leafs + 1);
     } else {
-      parent_node.insert(sha1);
+      parent_node.insert(key);
       return create_children_till_leaf(level_from_leafs);
     }
   }
 }
 
-template <typename DataStorage>
-void btree_sorted_keys_inserter<DataStorage>::split_root_and_grow(const sha1_t& sha1,
-                                                                  unsigned level_from_leafs)
+template <typename DataStorage, typename Key>
+void btree_sorted_keys_inserter<DataStorage, Key>::split_root_and_grow(const Key& key,
+                                                                       unsigned level_from_leafs)
 {
   const auto new_root_ptr = new_node_pointer();
 
@@ -107,7 +109,7 @@ void btree_sorted_keys_inserter<DataStorage>::split_root_and_grow(const sha1_t&
   m_current_path.pop_back();
 
   auto& new_root = m_current_path.emplace_back(this->order(), btree_node::k_unused_pointer);
-  new_root.insert(sha1);
+  new_root.insert(key);
   new_root.pointers[0] = old_root_ptr;
   new_root.this_pointer = new_root_ptr;
   new_root.is_leaf = false;
@@ -118,8 +120,9 @@ void btree_sorted_keys_inserter<DataStorage>::split_root_and_grow(const sha1_t&
   ++m_tree_height;
 }
 
-template <typename DataStorage>
-void btree_sorted_keys_inserter<DataStorage>::create_children_till_leaf(unsigned level_from_leafs)
+template <typename DataStorage, typename Key>
+void btree_sorted_keys_inserter<DataStorage, Key>::create_children_till_leaf(
+  unsigned level_from_leafs)
 {
   const auto is_on_leaf_level = (level_from_leafs == 0u);
 
@@ -141,8 +144,9 @@ void btree_sorted_keys_inserter<DataStorage>::create_children_till_leaf(unsigned
   return create_children_till_leaf(level_from_leafs - 1u);
 }
 
-template <typename DataStorage>
-btree_node& btree_sorted_keys_inserter<DataStorage>::current_node()
+template <typename DataStorage, typename Key>
+typename btree_sorted_keys_inserter<DataStorage, Key>::node_t&
+btree_sorted_keys_inserter<DataStorage, Key>::current_node()
 {
   return m_current_path.back();
 }
@@ -0,0 +1,81 @@
+#include "checksums.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#  define OKON_HAS_HARDWARE_CRC32C
+#  include <nmmintrin.h>
+#endif
+
+namespace {
+// Castagnoli polynomial, bit reversed.
+constexpr uint32_t k_crc32c_polynomial{ 0x82f63b78u };
+
+constexpr std::array<uint32_t, 256u> make_crc32c_table()
+{
+  std::array<uint32_t, 256u> table{};
+
+  for (auto i = 0u; i < table.size(); ++i) {
+    auto crc = uint32_t{ i };
+    for (auto bit = 0u; bit < 8u; ++bit) {
+      crc = (crc & 1u) != 0u ? (crc >> 1u) ^ k_crc32c_polynomial : crc >> 1u;
+    }
+    table[i] = crc;
+  }
+
+  return table;
+}
+
+constexpr auto k_crc32c_table{ make_crc32c_table() };
+
+uint32_t software_crc32c(uint32_t crc, const uint8_t* data, uint64_t size)
+{
+  for (auto i = uint64_t{ 0u }; i < size; ++i) {
+    crc = k_crc32c_table[(crc ^ data[i]) & 0xffu] ^ (crc >> 8u);
+  }
+
+  return crc;
+}
+
+#ifdef OKON_HAS_HARDWARE_CRC32C
+// The crc32 instruction of SSE4.2 computes CRC32C of 8 bytes at once. It's compiled for SSE4.2
+// regardless of OKON_ARCH and used only if the CPU has it.
+__attribute__((target("sse4.2"))) uint32_t hardware_crc32c(uint32_t crc, const uint8_t* data,
+                                                           uint64_t size)
+{
+  auto crc64 = uint64_t{ crc };
+
+  for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), data += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+
+  crc = static_cast<uint32_t>(crc64);
+
+  for (; size > 0u; --size, ++data) {
+    crc = _mm_crc32_u8(crc, *data);
+  }
+
+  return crc;
+}
+#endif
+}
+
+namespace okon {
+uint32_t crc32c(const void* data, uint64_t size, uint32_t crc)
+{
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+
+#ifdef OKON_HAS_HARDWARE_CRC32C
+  static const bool has_hardware_crc32c = __builtin_cpu_supports("sse4.2");
+  crc = has_hardware_crc32c ? hardware_crc32c(crc, bytes, size) : software_crc32c(crc, bytes, size);
+#else
+  crc = software_crc32c(crc, bytes, size);
+#endif
+
+  return ~crc;
+}
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "file_header.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace okon {
+
+// CRC32C (Castagnoli) of the bytes, continuing from the given checksum. Uses the crc32 instruction
+// if the CPU has SSE4.2.
+uint32_t crc32c(const void* data, uint64_t size, uint32_t crc = 0u);
+
+constexpr uint32_t k_checksum_block_size{ 1024u * 1024u };
+
+enum class verify_result
+{
+  valid,
+  no_checksums,
+  corrupted_header,
+  truncated,
+  corrupted
+};
+
+// Checksum of the header as it's stored, with the header_checksum field taken as zero.
+template <typename DataStorage>
+uint32_t stored_header_checksum(DataStorage& storage, const file_header& header)
+{
+  std::vector<uint8_t> bytes(std::max(header.header_size, file_header::k_compact_header_size));
+  storage.seek_in(0u);
+  storage.read(bytes.data(), header.header_size);
+  std::fill_n(std::next(bytes.begin(), file_header::k_header_checksum_offset),
+              sizeof(header.header_checksum), uint8_t{ 0u });
+
+  return crc32c(bytes.data(), header.header_size);
+}
+
+// Appends the table of checksums of the file's blocks and sets the checksums in the header, see
+// file_flag_checksums. Needs to be called after the whole tree has been written. Legacy files
+// have no room for checksums, they are left as they are.
+template <typename DataStorage>
+void append_checksums(DataStorage& storage)
+{
+  auto header = read_file_header(storage);
+  if (header.format == file_format::legacy) {
+    return;
+  }
+
+  header.flags |= file_flag_checksums;
+  header.checksum_block_size = k_checksum_block_size;
+  header.checksums_offset = storage.total_size();
+  header.header_checksum = 0u;
+
+  std::vector<uint32_t> checksums;
+  std::vector<uint8_t> block(header.checksum_block_size);
+
+  for (uint64_t offset = header.header_size; offset < header.checksums_offset;
+       offset += header.checksum_block_size) {
+    const auto size = std::min<uint64_t>(header.checksum_block_size,
+                                         header.checksums_offset - offset);
+    storage.seek_in(offset);
+    storage.read(block.data(), size);
+    checksums.push_back(crc32c(block.data(), size));
+  }
+
+  storage.seek_out(header.checksums_offset);
+  storage.write(checksums.data(), checksums.size() * sizeof(uint32_t));
+
+  write_file_header(storage, header);
+  header.header_checksum = stored_header_checksum(storage, header);
+  write_file_header(storage, header);
+}
+
+// Number of blocks that have checksums.
+inline uint64_t checksummed_blocks_count(const file_header& header)
+{
+  const auto data_size = header.checksums_offset - header.header_size;
+  return (data_size + header.checksum_block_size - 1u) / header.checksum_block_size;
+}
+
+// Cheap check done without reading the tree: the header checksum and whether the file has been
+// truncated.
+template <typename DataStorage>
+verify_result verify_header(DataStorage& storage)
+{
+  const auto header = read_file_header(storage);
+  if (!header.has_flag(file_flag_checksums) || header.checksum_block_size == 0u ||
+      header.checksums_offset < header.header_size) {
+    return header.format == file_format::legacy || !header.has_flag(file_flag_checksums)
+      ? verify_result::no_checksums
+      : verify_result::corrupted_header;
+  }
+
+  // The header's size is read from the file too, it's checked before the header is read whole.
+  if (header.header_size < file_header::k_compact_header_size ||
+      header.header_size > file_header::k_max_header_size ||
+      static_cast<uint64_t>(storage.total_size()) < header.header_size) {
+    return verify_result::corrupted_header;
+  }
+
+  if (stored_header_checksum(storage, header) != header.header_checksum) {
+    return verify_result::corrupted_header;
+  }
+
+  const auto expected_size =
+    header.checksums_offset + checksummed_blocks_count(header) * sizeof(uint32_t);
+  if (static_cast<uint64_t>(storage.total_size()) < expected_size) {
+    return verify_result::truncated;
+  }
+
+  return verify_result::valid;
+}
+
+// Verifies the header and checksums of all the blocks. Blocks are split into threads_count ranges,
+// verified in parallel. open_storage() is called once per thread and needs to return a new
+// storage of the file.
+template <typename OpenStorage>
+verify_result verify_checksums(OpenStorage open_storage, unsigned threads_count)
+{
+  auto storage = open_storage();
+  if (const auto result = verify_header(storage); result != verify_result::valid) {
+    return result;
+  }
+
+  const auto header = read_file_header(storage);
+  const auto blocks_count = checksummed_blocks_count(header);
+
+  std::vector<uint32_t> checksums(blocks_count);
+  storage.seek_in(header.checksums_offset);
+  storage.read(checksums.data(), blocks_count * sizeof(uint32_t));
+
+  threads_count = static_cast<unsigned>(
+    std::clamp<uint64_t>(threads_count, 1u, std::max<uint64_t>(blocks_count, 1u)));
+  const auto blocks_per_thread = (blocks_count + threads_count - 1u) / threads_count;
+
+  std::atomic<bool> corrupted{ false };
+
+  const auto verify_blocks = [&](uint64_t first_block, uint64_t end_block) {
+    auto thread_storage = open_storage();
+    std::vector<uint8_t> block(header.checksum_block_size);
+
+    for (auto i = first_block; i < end_block && !corrupted; ++i) {
+      const auto offset = header.header_size + i * header.checksum_block_size;
+      const auto size =
+        std::min<uint64_t>(header.checksum_block_size, header.checksums_offset - offset);
+
+      thread_storage.seek_in(offset);
+      const auto read_size = static_cast<uint64_t>(thread_storage.read(block.data(), size));
+
+      if (read_size != size || crc32c(block.data(), size) != checksums[i]) {
+        corrupted = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (auto i = 0u; i < threads_count; ++i) {
+    const auto first_block = std::min(blocks_count, i * blocks_per_thread);
+    const auto end_block = std::min(blocks_count, first_block + blocks_per_thread);
+    threads.emplace_back(verify_blocks, first_block, end_block);
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  return corrupted ? verify_result::corrupted : verify_result::valid;
+}
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "btree_node.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace okon {
+
+enum class file_format : uint32_t
+{
+  // [order][root pointer][nodes...]. Every node has the same size and stores all the pointers,
+  // the parent pointer included. Files prepared by the first okon versions have this layout.
+  legacy = 1u,
+
+  // [header][inner nodes...][leaves...]. Inner nodes don't store the parent pointer, leaves store
+  // only keys. A pointer to a leaf has btree_node::k_leaf_pointer_flag set, the rest of the
+  // pointer is an index of the node in its region.
+  compact = 2u
+};
+
+// Optional features of the compact layout. A reader can't read a file with a flag it doesn't know,
+// see is_supported().
+enum file_flags : uint32_t
+{
+  // Leaves store the common prefix of their keys once, followed by the keys' suffixes. Leaves are
+  // aligned to k_compressed_leaf_alignment and a pointer to a leaf is its offset from the
+  // beginning of the leaves region, in k_compressed_leaf_alignment units.
+  file_flag_prefix_compressed_leaves = 1u << 0u,
+
+  // B+ tree: all the keys are stored in leaves, a key of an inner node is a copy of the first key
+  // of the subtree on its right. Leaves are stored in key order right after the header, inner
+  // nodes after them. The leaf that follows a leaf in the file is its right sibling, so scans read
+  // the leaves sequentially and never go back to the inner nodes.
+  file_flag_bplus_tree = 1u << 1u,
+
+  // The file is split into blocks of checksum_block_size bytes, starting at the end of the header.
+  // CRC32C of every block is stored in a table at checksums_offset, right after the tree. The
+  // header has its own checksum. See checksums.hpp.
+  file_flag_checksums = 1u << 2u,
+
+  // Inner nodes and leaves that are not prefix compressed start with a summary of their keys: the
+  // leading bytes of every node_view::k_summary_keys_step-th key. A search reads the summary first
+  // and then only the keys between two of its entries. See node_view.
+  file_flag_node_summaries = 1u << 3u
+};
+
+constexpr uint32_t k_known_file_flags{ file_flag_prefix_compressed_leaves | file_flag_bplus_tree |
+                                       file_flag_checksums | file_flag_node_summaries };
+
+// With 31 bits of a leaf pointer it allows to address 128GiB of leaves.
+constexpr uint64_t k_compressed_leaf_alignment{ 64u };
+
+struct file_header
+{
+  // "okon" read as little endian uint32. Legacy files start with the order, which is never that
+  // big, so the magic is enough to tell the layouts apart.
+  static constexpr uint32_t k_magic{ 0x6e6f6b6fu };
+
+  file_format format{ file_format::legacy };
+  uint32_t header_size{ 0u };
+  btree_node::order_t order{ 0u };
+  btree_node::pointer_t root_ptr{ 0u };
+  uint32_t inner_nodes_count{ 0u };
+  uint32_t leaf_nodes_count{ 0u };
+  uint32_t flags{ 0u };
+
+  // Number of leading bytes of every key that are stored in the file. If it's less than
+  // key_size, lookups compare only the fingerprints and may report false positives.
+  uint32_t stored_key_size{ sizeof(sha1_t) };
+
+  // Width of the keys, e.g. 16 for NTLM, 20 for SHA-1 or 32 for SHA-256 hashes.
+  uint32_t key_size{ sizeof(sha1_t) };
+
+  // Number of bytes that the leaves take. Set only if file_flag_bplus_tree is.
+  uint64_t leaves_size{ 0u };
+
+  // See file_flag_checksums.
+  uint32_t checksum_block_size{ 0u };
+  uint64_t checksums_offset{ 0u };
+
+  // CRC32C of the header_size bytes of the header, with this field set to zero.
+  uint32_t header_checksum{ 0u };
+
+  // Revision of the compact layout. It's bumped on changes that older readers can't handle and
+  // that can't be described by a flag. Files written before the field was added are of the first
+  // revision.
+  uint32_t version{ k_version };
+
+  static constexpr uint32_t k_version{ 1u };
+
+  // Statistics of the tree, written once the whole tree is. Zero height means that the file has
+  // been written before they were added. Keys of inner nodes of a B+ tree are copies of keys of
+  // leaves, so they are not counted.
+  uint64_t keys_count{ 0u };
+  uint32_t height{ 0u };
+
+  // Number of nodes of every level, starting from the root. Only the first k_max_levels_in_header
+  // levels are stored, deeper ones can be there only in trees of tiny orders.
+  static constexpr uint32_t k_max_levels_in_header{ 16u };
+  std::array<uint32_t, k_max_levels_in_header> level_nodes_counts{};
+
+  bool has_flag(file_flags flag) const
+  {
+    return (flags & flag) != 0u;
+  }
+
+  static constexpr uint32_t k_legacy_header_size{ sizeof(order) + sizeof(root_ptr) };
+  static constexpr uint32_t k_header_checksum_offset{
+    sizeof(k_magic) + sizeof(format) + sizeof(header_size) + sizeof(order) + sizeof(root_ptr) +
+    sizeof(inner_nodes_count) + sizeof(leaf_nodes_count) + sizeof(flags) +
+    sizeof(stored_key_size) + sizeof(key_size) + sizeof(leaves_size) +
+    sizeof(checksum_block_size) + sizeof(checksums_offset)
+  };
+  static constexpr uint32_t k_compact_header_size{ k_header_checksum_offset +
+                                                   sizeof(header_checksum) + sizeof(version) +
+                                                   sizeof(keys_count) + sizeof(height) +
+                                                   sizeof(level_nodes_counts) };
+  // Headers of newer revisions can only grow by appended fields, never past this size.
+  static constexpr uint32_t k_max_header_size{ 64u * 1024u };
+
+  static constexpr uint64_t k_root_ptr_offset_in_legacy_header{ sizeof(order) };
+};
+
+// Whether this version of okon can read the file: its revision, all its features and the width of
+// its keys are known. Legacy files are always supported.
+inline bool is_supported(const file_header& header)
+{
+  if (header.format == file_format::legacy) {
+    return true;
+  }
+
+  const auto known_key_size = header.key_size == sizeof(ntlm_t) ||
+    header.key_size == sizeof(sha1_t) || header.key_size == sizeof(sha256_t);
+
+  return header.format == file_format::compact && header.version <= file_header::k_version &&
+    (header.flags & ~k_known_file_flags) == 0u && known_key_size && header.stored_key_size > 0u &&
+    header.stored_key_size <= header.key_size;
+}
+
+// Probability that a lookup of a key that is not in the file finds a key of the same fingerprint,
+// assuming uniformly distributed keys.
+inline double expected_false_positive_rate(uint64_t keys_count, uint32_t stored_key_size,
+                                           uint32_t key_size)
+{
+  if (stored_key_size >= key_size) {
+    return 0.0;
+  }
+
+  // 1 - (1 - 2^-bits)^keys_count, computed without losing precision for tiny probabilities.
+  const auto fingerprint_probability = std::ldexp(1.0, -8 * static_cast<int>(stored_key_size));
+  return -std::expm1(static_cast<double>(keys_count) * std::log1p(-fingerprint_probability));
+}
+
+template <typename DataStorage>
+file_header read_file_header(DataStorage& storage)
+{
+  file_header header;
+
+  uint32_t first_word{ 0u };
+  storage.seek_in(0u);
+  storage.read(&first_word, sizeof(first_word));
+
+  if (first_word != file_header::k_magic) {
+    header.format = file_format::legacy;
+    header.header_size = file_header::k_legacy_header_size;
+    header.order = first_word;
+    storage.read(&header.root_ptr, sizeof(header.root_ptr));
+    return header;
+  }
+
+  storage.read(&header.format, sizeof(header.format));
+  storage.read(&header.header_size, sizeof(header.header_size));
+
+  // Fields are only appended, so fields that are beyond the header of an older file keep their
+  // default values.
+  auto header_bytes_read = uint32_t{ sizeof(file_header::k_magic) + sizeof(header.format) +
+                                     sizeof(header.header_size) };
+
+  const auto read_field = [&storage, &header, &header_bytes_read](auto& field) {
+    if (header_bytes_read + sizeof(field) <= header.header_size) {
+      storage.read(&field, sizeof(field));
+    }
+    header_bytes_read += sizeof(field);
+  };
+
+  read_field(header.order);
+  read_field(header.root_ptr);
+  read_field(header.inner_nodes_count);
+  read_field(header.leaf_nodes_count);
+  read_field(header.flags);
+  read_field(header.stored_key_size);
+  read_field(header.key_size);
+  read_field(header.leaves_size);
+  read_field(header.checksum_block_size);
+  read_field(header.checksums_offset);
+  read_field(header.header_checksum);
+  read_field(header.version);
+  read_field(header.keys_count);
+  read_field(header.height);
+  read_field(header.level_nodes_counts);
+
+  return header;
+}
+
+template <typename DataStorage>
+void write_file_header(DataStorage& storage, const file_header& header)
+{
+  storage.seek_out(0u);
+
+  if (header.format == file_format::legacy) {
+    storage.write(&header.order, sizeof(header.order));
+    storage.write(&header.root_ptr, sizeof(header.root_ptr));
+    return;
+  }
+
+  storage.write(&file_header::k_magic, sizeof(file_header::k_magic));
+  storage.write(&header.format, sizeof(header.format));
+  storage.write(&header.header_size, sizeof(header.header_size));
+  storage.write(&header.order, sizeof(header.order));
+  storage.write(&header.root_ptr, sizeof(header.root_ptr));
+  storage.write(&header.inner_nodes_count, sizeof(header.inner_nodes_count));
+  storage.write(&header.leaf_nodes_count, sizeof(header.leaf_nodes_count));
+  storage.write(&header.flags, sizeof(header.flags));
+  storage.write(&header.stored_key_size, sizeof(header.stored_key_size));
+  storage.write(&header.key_size, sizeof(header.key_size));
+  storage.write(&header.leaves_size, sizeof(header.leaves_size));
+  storage.write(&header.checksum_block_size, sizeof(header.checksum_block_size));
+  storage.write(&header.checksums_offset, sizeof(header.checksums_offset));
+  storage.write(&header.header_checksum, sizeof(header.header_checksum));
+  storage.write(&header.version, sizeof(header.version));
+  storage.write(&header.keys_count, sizeof(header.keys_count));
+  storage.write(&header.height, sizeof(header.height));
+  storage.write(header.level_nodes_counts.data(), sizeof(header.level_nodes_counts));
+}
+}
@@ -29,6 +29,8 @@ public:
 
   void seek_in(pos_type_t pos)
   {
+    // A read that reached the end of the file leaves the stream failed.
+    m_file.clear();
     m_file.seekg(pos);
   }
   void seek_out(pos_type_t pos)
@@ -46,6 +48,13 @@ public:
     return m_file.tellp();
   }
 
+  pos_type_t total_size()
+  {
+    m_file.clear();
+    m_file.seekg(0, std::ios::end);
+    return m_file.tellg();
+  }
+
   bool is_open() const
   {
     return m_file.is_open();
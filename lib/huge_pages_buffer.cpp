@@ -0,0 +1,92 @@
+#include "huge_pages_buffer.hpp"
+
+#ifdef _WIN32
+#  include <new>
+#else
+#  include <sys/mman.h>
+#endif
+
+namespace {
+constexpr uint64_t k_huge_page_size{ 2u * 1024u * 1024u };
+
+uint64_t round_up_to_huge_page(uint64_t size)
+{
+  return (size + k_huge_page_size - 1u) / k_huge_page_size * k_huge_page_size;
+}
+}
+
+namespace okon {
+huge_pages_buffer::huge_pages_buffer(uint64_t size)
+  : m_size{ size }
+{
+  if (size == 0u) {
+    return;
+  }
+
+#ifdef _WIN32
+  m_data = new (std::nothrow) uint8_t[size]{};
+#else
+  m_mapped_size = round_up_to_huge_page(size);
+  void* mapped = MAP_FAILED;
+
+#  ifdef MAP_HUGETLB
+  mapped = mmap(nullptr, m_mapped_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  m_huge_pages = (mapped != MAP_FAILED);
+#  endif
+
+  if (mapped == MAP_FAILED) {
+    mapped = mmap(nullptr, m_mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                  0);
+
+#  ifdef MADV_HUGEPAGE
+    if (mapped != MAP_FAILED) {
+      madvise(mapped, m_mapped_size, MADV_HUGEPAGE);
+    }
+#  endif
+  }
+
+  if (mapped != MAP_FAILED) {
+    m_data = static_cast<uint8_t*>(mapped);
+  }
+#endif
+}
+
+huge_pages_buffer::~huge_pages_buffer()
+{
+  if (m_data == nullptr) {
+    return;
+  }
+
+#ifdef _WIN32
+  delete[] m_data;
+#else
+  munmap(m_data, m_mapped_size);
+#endif
+}
+
+bool huge_pages_buffer::is_allocated() const
+{
+  return m_data != nullptr || m_size == 0u;
+}
+
+uint8_t* huge_pages_buffer::data()
+{
+  return m_data;
+}
+
+const uint8_t* huge_pages_buffer::data() const
+{
+  return m_data;
+}
+
+uint64_t huge_pages_buffer::size() const
+{
+  return m_size;
+}
+
+bool huge_pages_buffer::uses_huge_pages() const
+{
+  return m_huge_pages;
+}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+namespace okon {
+
+// Zero-initialized memory for big read-only structures that are searched at random. It's backed by
+// huge pages if the system has them reserved (MAP_HUGETLB), otherwise transparent huge pages are
+// requested for it, so lookups don't miss the TLB on every access.
+class huge_pages_buffer
+{
+public:
+  explicit huge_pages_buffer(uint64_t size);
+  ~huge_pages_buffer();
+
+  huge_pages_buffer(const huge_pages_buffer&) = delete;
+  huge_pages_buffer& operator=(const huge_pages_buffer&) = delete;
+
+  // False if the memory couldn't be allocated.
+  bool is_allocated() const;
+
+  uint8_t* data();
+  const uint8_t* data() const;
+  uint64_t size() const;
+
+  // Whether the memory is backed by reserved huge pages.
+  bool uses_huge_pages() const;
+
+private:
+  uint8_t* m_data{ nullptr };
+  uint64_t m_size{ 0u };
+  uint64_t m_mapped_size{ 0u };
+  bool m_huge_pages{ false };
+};
+}
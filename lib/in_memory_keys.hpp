@@ -0,0 +1,389 @@
+#pragma once
+
+#include "btree_keys_reader.hpp"
+#include "file_header.hpp"
+#include "huge_pages_buffer.hpp"
+#include "key_prefix.hpp"
+#include "lookup_metrics.hpp"
+#include "read_ahead_storage.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace okon {
+namespace details {
+inline void prefetch([[maybe_unused]] const void* address)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address);
+#endif
+}
+}
+
+// All the keys of a prepared file loaded into one sorted array in memory, so lookups don't touch
+// the storage. Only the stored bytes of keys are kept, see file_header::stored_key_size. Hashes are
+// uniformly distributed, so a lookup starts with a couple of interpolation steps, which narrow the
+// range much faster than halving it, and finishes with a binary search. Works with files of every
+// layout and gives the same results as btree.
+template <typename Key>
+class in_memory_keys
+{
+public:
+  using key_t = Key;
+
+  template <typename DataStorage>
+  explicit in_memory_keys(DataStorage& storage);
+
+  // False if the memory couldn't be allocated.
+  bool is_loaded() const;
+
+  bool contains(const Key& key) const;
+
+  // Looks up count keys, calling fun(index, found) for each of them, not necessarily in order.
+  // Lookups are interleaved: a group of them is advanced one step at a time, each prefetching the
+  // key it compares with in the next step, so waiting for memory overlaps instead of adding up.
+  template <typename Function>
+  void contains_batch(const Key* keys, uint64_t count, Function&& fun) const;
+
+  // See btree::for_each_key_with_prefix().
+  template <typename Function>
+  void for_each_key_with_prefix(const Key& prefix, uint32_t prefix_bits, Function&& fun) const;
+
+  uint64_t keys_count() const;
+  uint64_t size_in_bytes() const;
+  bool uses_huge_pages() const;
+
+private:
+  static constexpr auto k_interpolation_steps{ 4u };
+
+  // For that few keys a binary search is cheaper than another interpolation step.
+  static constexpr uint64_t k_min_interpolation_range{ 64u };
+
+  // Upper bound of the number of keys of the file. Files prepared before the number of keys was
+  // stored in the header store every key at least once.
+  template <typename DataStorage>
+  static uint64_t max_keys_count(DataStorage& storage, const file_header& header);
+
+  // Enough lookups in flight to cover the memory latency with their steps.
+  static constexpr auto k_interleaved_lookups_count{ 16u };
+
+  // State of a search of one key, advanced step by step, so searches of many keys can be
+  // interleaved.
+  struct lookup
+  {
+    const uint8_t* key;
+    uint64_t target;
+
+    // The range [low, high) that the lower bound of the key is known to be in, and leading bytes
+    // of the keys around it.
+    uint64_t low;
+    uint64_t high;
+    uint64_t low_value;
+    uint64_t high_value;
+
+    unsigned interpolation_steps;
+
+    // Whether the last step has been an interpolation step, which should be followed by a guard
+    // step on the other side of the key.
+    bool guard_pending;
+    bool moved_low;
+
+    // Index of the key to compare with in the next step.
+    uint64_t probe;
+  };
+
+  const uint8_t* key_at(uint64_t index) const;
+
+  lookup start_lookup(const uint8_t* key) const;
+
+  // Picks the key to compare with in the next step. Returns false if the search is done.
+  bool next_probe(lookup& l) const;
+
+  // Compares with the picked key and narrows the range.
+  void narrow(lookup& l) const;
+
+  bool is_found(const lookup& l) const;
+
+  // Index of the first key that is not less than the given one.
+  uint64_t lower_bound(const uint8_t* key) const;
+
+  // Up to 8 first bytes of the key, as a big endian number.
+  uint64_t leading_bytes(const uint8_t* key) const;
+
+private:
+  uint32_t m_stored_key_size;
+  uint64_t m_keys_count{ 0u };
+  huge_pages_buffer m_keys;
+};
+
+template <typename Key>
+template <typename DataStorage>
+in_memory_keys<Key>::in_memory_keys(DataStorage& storage)
+  : m_stored_key_size{ std::min<uint32_t>(read_file_header(storage).stored_key_size, sizeof(Key)) }
+  , m_keys{ max_keys_count(storage, read_file_header(storage)) * m_stored_key_size }
+{
+  if (!m_keys.is_allocated()) {
+    return;
+  }
+
+  const auto capacity = m_keys.size() / m_stored_key_size;
+
+  read_ahead_storage<DataStorage> read_ahead{ storage };
+  btree_keys_reader<read_ahead_storage<DataStorage>, Key> reader{ read_ahead };
+
+  while (const auto key = reader.next_key()) {
+    if (m_keys_count == capacity) {
+      break;
+    }
+
+    std::memcpy(m_keys.data() + m_keys_count * m_stored_key_size, key->data(), m_stored_key_size);
+    ++m_keys_count;
+  }
+}
+
+template <typename Key>
+template <typename DataStorage>
+uint64_t in_memory_keys<Key>::max_keys_count(DataStorage& storage, const file_header& header)
+{
+  if (header.height != 0u) {
+    return header.keys_count;
+  }
+
+  const auto stored_key_size = std::min<uint32_t>(header.stored_key_size, sizeof(Key));
+  return static_cast<uint64_t>(storage.total_size()) / stored_key_size;
+}
+
+template <typename Key>
+bool in_memory_keys<Key>::is_loaded() const
+{
+  return m_keys.is_allocated();
+}
+
+template <typename Key>
+bool in_memory_keys<Key>::contains(const Key& key) const
+{
+  [[maybe_unused]] metrics::lookup_timer timer;
+
+  auto l = start_lookup(key.data());
+  while (next_probe(l)) {
+    narrow(l);
+  }
+
+  return is_found(l);
+}
+
+template <typename Key>
+template <typename Function>
+void in_memory_keys<Key>::contains_batch(const Key* keys, uint64_t count, Function&& fun) const
+{
+  std::array<lookup, k_interleaved_lookups_count> lookups;
+  std::array<uint64_t, k_interleaved_lookups_count> indices;
+  uint64_t next_index{ 0u };
+
+  // Starts the next key of the batch in the slot. Keys that need no probe at all are done right
+  // away. Returns false if there are no more keys.
+  const auto start_next = [&](unsigned slot) {
+    while (next_index < count) {
+      lookups[slot] = start_lookup(keys[next_index].data());
+      indices[slot] = next_index++;
+
+      if (next_probe(lookups[slot])) {
+        details::prefetch(key_at(lookups[slot].probe));
+        return true;
+      }
+
+      fun(indices[slot], is_found(lookups[slot]));
+    }
+
+    return false;
+  };
+
+  auto active_count = 0u;
+  while (active_count < k_interleaved_lookups_count && start_next(active_count)) {
+    ++active_count;
+  }
+
+  // Every lookup does one step and prefetches the key of its next step, so by the time it's its
+  // turn again the key is most likely in the cache.
+  while (active_count > 0u) {
+    for (auto slot = 0u; slot < active_count;) {
+      auto& l = lookups[slot];
+      narrow(l);
+
+      if (next_probe(l)) {
+        details::prefetch(key_at(l.probe));
+        ++slot;
+        continue;
+      }
+
+      fun(indices[slot], is_found(l));
+
+      if (start_next(slot)) {
+        ++slot;
+      } else {
+        --active_count;
+        lookups[slot] = lookups[active_count];
+        indices[slot] = indices[active_count];
+      }
+    }
+  }
+}
+
+template <typename Key>
+template <typename Function>
+void in_memory_keys<Key>::for_each_key_with_prefix(const Key& prefix, uint32_t prefix_bits,
+                                                   Function&& fun) const
+{
+  prefix_bits = std::min(prefix_bits, 8u * m_stored_key_size);
+  const auto first_key = first_key_of_prefix(prefix, prefix_bits);
+
+  for (auto index = lower_bound(first_key.data()); index < m_keys_count; ++index) {
+    Key key{};
+    std::memcpy(key.data(), key_at(index), m_stored_key_size);
+
+    if (!has_prefix(key, first_key, prefix_bits)) {
+      return;
+    }
+
+    fun(key);
+  }
+}
+
+template <typename Key>
+uint64_t in_memory_keys<Key>::keys_count() const
+{
+  return m_keys_count;
+}
+
+template <typename Key>
+uint64_t in_memory_keys<Key>::size_in_bytes() const
+{
+  return m_keys.size();
+}
+
+template <typename Key>
+bool in_memory_keys<Key>::uses_huge_pages() const
+{
+  return m_keys.uses_huge_pages();
+}
+
+template <typename Key>
+const uint8_t* in_memory_keys<Key>::key_at(uint64_t index) const
+{
+  return m_keys.data() + index * m_stored_key_size;
+}
+
+template <typename Key>
+typename in_memory_keys<Key>::lookup in_memory_keys<Key>::start_lookup(const uint8_t* key) const
+{
+  lookup l{};
+  l.key = key;
+  l.target = leading_bytes(key);
+  l.high = m_keys_count;
+
+  if (m_keys_count > 0u) {
+    l.low_value = leading_bytes(key_at(0u));
+    l.high_value = leading_bytes(key_at(m_keys_count - 1u));
+  }
+
+  return l;
+}
+
+template <typename Key>
+bool in_memory_keys<Key>::next_probe(lookup& l) const
+{
+  if (l.low >= l.high) {
+    return false;
+  }
+
+  const auto size = l.high - l.low;
+
+  if (l.guard_pending) {
+    // The key is most likely within a couple of standard deviations of the interpolation error from
+    // the guess, which for uniformly distributed keys is about sqrt(size) / 2. Probing that far on
+    // the other side of the key bounds the range from both sides.
+    l.guard_pending = false;
+    const auto window = std::min(static_cast<uint64_t>(std::sqrt(static_cast<double>(size))), size);
+    l.probe = l.moved_low ? l.low + window - 1u : l.high - window;
+    return true;
+  }
+
+  const auto can_interpolate = l.interpolation_steps < k_interpolation_steps &&
+    size > k_min_interpolation_range && l.low_value < l.target && l.target <= l.high_value;
+
+  if (!can_interpolate) {
+    l.interpolation_steps = k_interpolation_steps;
+    l.probe = l.low + size / 2u;
+    return true;
+  }
+
+  // The key is about as far into the range as its value is into the range of values.
+  const auto fraction =
+    static_cast<double>(l.target - l.low_value) / static_cast<double>(l.high_value - l.low_value);
+  const auto distance = static_cast<uint64_t>(fraction * static_cast<double>(size - 1u));
+  l.probe = l.low + std::min(distance, size - 1u);
+  l.guard_pending = true;
+  ++l.interpolation_steps;
+  return true;
+}
+
+template <typename Key>
+void in_memory_keys<Key>::narrow(lookup& l) const
+{
+  const auto* probed = key_at(l.probe);
+  const auto probed_value = leading_bytes(probed);
+
+  // Leading bytes of keys differ almost always, so the rest of them rarely needs to be compared.
+  l.moved_low = probed_value != l.target ? probed_value < l.target
+                                         : std::memcmp(probed, l.key, m_stored_key_size) < 0;
+
+  if (l.moved_low) {
+    l.low = l.probe + 1u;
+    l.low_value = probed_value;
+  } else {
+    l.high = l.probe;
+    l.high_value = probed_value;
+  }
+}
+
+template <typename Key>
+bool in_memory_keys<Key>::is_found(const lookup& l) const
+{
+  return l.low < m_keys_count && std::memcmp(key_at(l.low), l.key, m_stored_key_size) == 0;
+}
+
+template <typename Key>
+uint64_t in_memory_keys<Key>::lower_bound(const uint8_t* key) const
+{
+  auto l = start_lookup(key);
+  while (next_probe(l)) {
+    narrow(l);
+  }
+
+  return l.low;
+}
+
+template <typename Key>
+uint64_t in_memory_keys<Key>::leading_bytes(const uint8_t* key) const
+{
+  uint64_t value{ 0u };
+
+  // With a constant number of bytes the loop compiles to a load and a byte swap.
+  if (m_stored_key_size >= sizeof(uint64_t)) {
+    for (auto i = 0u; i < sizeof(uint64_t); ++i) {
+      value = (value << 8u) | key[i];
+    }
+
+    return value;
+  }
+
+  for (auto i = 0u; i < m_stored_key_size; ++i) {
+    value = (value << 8u) | key[i];
+  }
+
+  return value << (8u * (sizeof(uint64_t) - m_stored_key_size));
+}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace okon {
+
+// The first key that may have the prefix of the given length in bits: the prefix followed by
+// zeros.
+template <typename Key>
+Key first_key_of_prefix(const Key& prefix, uint32_t prefix_bits)
+{
+  Key first_key{};
+  const auto full_bytes = prefix_bits / 8u;
+  std::copy_n(std::cbegin(prefix), full_bytes, std::begin(first_key));
+  if (const auto remaining_bits = prefix_bits % 8u; remaining_bits > 0u) {
+    const auto mask = static_cast<uint8_t>(0xffu << (8u - remaining_bits));
+    first_key[full_bytes] = prefix[full_bytes] & mask;
+  }
+
+  return first_key;
+}
+
+// Whether the first prefix_bits bits of the key are equal to the ones of first_key, see
+// first_key_of_prefix().
+template <typename Key>
+bool has_prefix(const Key& key, const Key& first_key, uint32_t prefix_bits)
+{
+  const auto full_bytes = prefix_bits / 8u;
+  if (std::memcmp(key.data(), first_key.data(), full_bytes) != 0) {
+    return false;
+  }
+
+  const auto remaining_bits = prefix_bits % 8u;
+  const auto mask = static_cast<uint8_t>(0xffu << (8u - remaining_bits));
+  return remaining_bits == 0u || (key[full_bytes] & mask) == first_key[full_bytes];
+}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "btree_keys_reader.hpp"
+#include "file_header.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace okon {
+
+enum class export_format
+{
+  // One key per line, as upper case hex.
+  text,
+
+  // Bytes of keys, one right after another.
+  binary
+};
+
+// Writes all the keys of a prepared file to the output, in ascending order. Only the stored bytes
+// of truncated keys (see file_header::stored_key_size) are written. The output is written in big
+// blocks. Returns the number of written keys.
+template <typename Key, typename DataStorage>
+uint64_t export_keys(DataStorage& storage, std::ostream& output, export_format format)
+{
+  constexpr auto k_block_size{ 1024u * 1024u };
+  constexpr char k_hex_digits[]{ "0123456789ABCDEF" };
+
+  const auto stored_key_size =
+    std::min<uint32_t>(read_file_header(storage).stored_key_size, sizeof(Key));
+
+  btree_keys_reader<DataStorage, Key> reader{ storage };
+
+  std::vector<char> block;
+  block.reserve(k_block_size + 2u * sizeof(Key) + 1u);
+  uint64_t keys_count{ 0u };
+
+  while (const auto key = reader.next_key()) {
+    if (format == export_format::text) {
+      for (auto i = 0u; i < stored_key_size; ++i) {
+        block.push_back(k_hex_digits[(*key)[i] >> 4u]);
+        block.push_back(k_hex_digits[(*key)[i] & 0x0fu]);
+      }
+      block.push_back('\n');
+    } else {
+      block.insert(std::end(block), key->data(), key->data() + stored_key_size);
+    }
+
+    ++keys_count;
+
+    if (block.size() >= k_block_size) {
+      output.write(block.data(), static_cast<std::streamsize>(block.size()));
+      block.clear();
+    }
+  }
+
+  output.write(block.data(), static_cast<std::streamsize>(block.size()));
+
+  return keys_count;
+}
+}
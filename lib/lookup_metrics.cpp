@@ -0,0 +1,103 @@
+#include "lookup_metrics.hpp"
+
+#include <algorithm>
+
+namespace {
+constexpr auto k_sub_bucket_bits{ 2u };
+constexpr auto k_sub_buckets_count{ 1u << k_sub_bucket_bits };
+}
+
+namespace okon {
+unsigned latency_histogram_bucket_index(uint64_t nanoseconds)
+{
+  if (nanoseconds < k_sub_buckets_count) {
+    return static_cast<unsigned>(nanoseconds);
+  }
+
+  auto most_significant_bit = 63u;
+  while ((nanoseconds & (uint64_t{ 1u } << most_significant_bit)) == 0u) {
+    --most_significant_bit;
+  }
+
+  const auto sub_bucket =
+    (nanoseconds >> (most_significant_bit - k_sub_bucket_bits)) & (k_sub_buckets_count - 1u);
+  const auto index = (most_significant_bit - k_sub_bucket_bits + 1u) * k_sub_buckets_count +
+    static_cast<unsigned>(sub_bucket);
+
+  return std::min(index, k_latency_histogram_buckets_count - 1u);
+}
+
+uint64_t latency_histogram_bucket_lower_bound(unsigned bucket_index)
+{
+  // Values past the last bucket are counted in it, so indices past it are clamped the same way.
+  bucket_index = std::min(bucket_index, k_latency_histogram_buckets_count - 1u);
+
+  if (bucket_index < k_sub_buckets_count) {
+    return bucket_index;
+  }
+
+  const auto most_significant_bit = bucket_index / k_sub_buckets_count + k_sub_bucket_bits - 1u;
+  const auto sub_bucket = bucket_index % k_sub_buckets_count;
+  return uint64_t{ k_sub_buckets_count + sub_bucket } << (most_significant_bit - k_sub_bucket_bits);
+}
+
+lookup_metrics& lookup_metrics::global()
+{
+  static lookup_metrics metrics;
+  return metrics;
+}
+
+void lookup_metrics::record_node_visit()
+{
+  m_nodes_visited.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void lookup_metrics::record_bytes_read(uint64_t bytes)
+{
+  m_bytes_read.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void lookup_metrics::record_cache_hit()
+{
+  m_cache_hits.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void lookup_metrics::record_cache_miss()
+{
+  m_cache_misses.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void lookup_metrics::record_lookup(std::chrono::nanoseconds duration)
+{
+  const auto nanoseconds = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+  m_lookups.fetch_add(1u, std::memory_order_relaxed);
+  m_latency_histogram[latency_histogram_bucket_index(nanoseconds)].fetch_add(
+    1u, std::memory_order_relaxed);
+}
+
+void lookup_metrics::snapshot(okon_lookup_metrics& out) const
+{
+  out.lookups = m_lookups.load(std::memory_order_relaxed);
+  out.nodes_visited = m_nodes_visited.load(std::memory_order_relaxed);
+  out.bytes_read = m_bytes_read.load(std::memory_order_relaxed);
+  out.cache_hits = m_cache_hits.load(std::memory_order_relaxed);
+  out.cache_misses = m_cache_misses.load(std::memory_order_relaxed);
+
+  for (auto i = 0u; i < k_latency_histogram_buckets_count; ++i) {
+    out.latency_histogram[i] = m_latency_histogram[i].load(std::memory_order_relaxed);
+  }
+}
+
+void lookup_metrics::reset()
+{
+  m_lookups.store(0u, std::memory_order_relaxed);
+  m_nodes_visited.store(0u, std::memory_order_relaxed);
+  m_bytes_read.store(0u, std::memory_order_relaxed);
+  m_cache_hits.store(0u, std::memory_order_relaxed);
+  m_cache_misses.store(0u, std::memory_order_relaxed);
+
+  for (auto& bucket : m_latency_histogram) {
+    bucket.store(0u, std::memory_order_relaxed);
+  }
+}
+}
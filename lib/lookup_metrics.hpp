@@ -0,0 +1,95 @@
+#pragma once
+
+#include <okon/okon.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace okon {
+constexpr auto k_latency_histogram_buckets_count{
+  static_cast<unsigned>(okon_lookup_metrics_latency_histogram_buckets_count)
+};
+
+// HDR-like bucketing: every power of two is split into four linear sub-buckets, so the relative
+// error of a recorded value is at most 25%.
+unsigned latency_histogram_bucket_index(uint64_t nanoseconds);
+uint64_t latency_histogram_bucket_lower_bound(unsigned bucket_index);
+
+class lookup_metrics
+{
+public:
+  static lookup_metrics& global();
+
+  void record_node_visit();
+  void record_bytes_read(uint64_t bytes);
+  void record_cache_hit();
+  void record_cache_miss();
+  void record_lookup(std::chrono::nanoseconds duration);
+
+  void snapshot(okon_lookup_metrics& out) const;
+  void reset();
+
+private:
+  using counter_t = std::atomic<uint64_t>;
+
+  alignas(64) counter_t m_lookups{ 0u };
+  counter_t m_nodes_visited{ 0u };
+  counter_t m_bytes_read{ 0u };
+  counter_t m_cache_hits{ 0u };
+  counter_t m_cache_misses{ 0u };
+  alignas(64) std::array<counter_t, k_latency_histogram_buckets_count> m_latency_histogram{};
+};
+
+// Hooks used by the lookup path. If okon is built without OKON_WITH_METRICS, they are empty and
+// compiled out entirely.
+namespace metrics {
+inline void record_node_visit()
+{
+#ifdef OKON_WITH_METRICS
+  lookup_metrics::global().record_node_visit();
+#endif
+}
+
+inline void record_bytes_read([[maybe_unused]] uint64_t bytes)
+{
+#ifdef OKON_WITH_METRICS
+  lookup_metrics::global().record_bytes_read(bytes);
+#endif
+}
+
+inline void record_cache_hit()
+{
+#ifdef OKON_WITH_METRICS
+  lookup_metrics::global().record_cache_hit();
+#endif
+}
+
+inline void record_cache_miss()
+{
+#ifdef OKON_WITH_METRICS
+  lookup_metrics::global().record_cache_miss();
+#endif
+}
+
+class lookup_timer
+{
+public:
+#ifdef OKON_WITH_METRICS
+  lookup_timer()
+    : m_start{ std::chrono::steady_clock::now() }
+  {
+  }
+
+  ~lookup_timer()
+  {
+    lookup_metrics::global().record_lookup(std::chrono::steady_clock::now() - m_start);
+  }
+
+private:
+  std::chrono::steady_clock::time_point m_start;
+#endif
+};
+}
+}
@@ -0,0 +1,145 @@
+#include "merger.hpp"
+
+#include "bplus_tree_builder.hpp"
+#include "btree_compactor.hpp"
+#include "btree_keys_reader.hpp"
+#include "btree_sorted_keys_inserter.hpp"
+#include "checksums.hpp"
+#include "file_header.hpp"
+#include "original_file_reader.hpp"
+#include "sorted_keys_merge.hpp"
+
+namespace {
+constexpr auto k_file_chunk_size_to_read{ 1024u * 1024u };
+
+// This value should be kept in sync with okon_prepare_progress_special_value from okon.h
+constexpr auto k_progress_unknown{ -1 };
+}
+
+namespace okon {
+template <typename Key>
+basic_merger<Key>::basic_merger(std::string_view prepared_file_path,
+                                std::string_view delta_file_path,
+                                std::string_view working_directory_path,
+                                std::string_view output_file_path,
+                                progress_callback_t progress_callback)
+  : m_prepared_file_path{ prepared_file_path }
+  , m_delta_file_path{ delta_file_path }
+  , m_working_directory_path{ working_directory_path }
+  , m_output_file_path{ output_file_path }
+  , m_progress_callback{ std::move(progress_callback) }
+{
+}
+
+template <typename Key>
+prepare_result basic_merger<Key>::merge()
+{
+  fstream_wrapper prepared_file{ m_prepared_file_path, std::ios::in | std::ios::binary };
+  fstream_wrapper delta_file{ m_delta_file_path, std::ios::in | std::ios::binary };
+  if (!prepared_file.is_open() || !delta_file.is_open()) {
+    return result::could_not_open_input_file;
+  }
+
+  const auto header = read_file_header(prepared_file);
+
+  auto intermediate_tree_file =
+    make_intermediate_tree_file(m_working_directory_path, header.format, header.flags);
+  if (intermediate_tree_file && !intermediate_tree_file->is_open()) {
+    return result::could_not_open_intermediate_files;
+  }
+
+  fstream_wrapper output_file{ m_output_file_path,
+                               std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary };
+  if (!output_file.is_open()) {
+    return result::could_not_open_output;
+  }
+
+  m_progress_callback(k_progress_unknown);
+
+  auto& tree_file = intermediate_tree_file ? *intermediate_tree_file : output_file;
+
+  btree_keys_reader<fstream_wrapper, Key> source{ prepared_file };
+  original_file_reader<fstream_wrapper, Key> delta_reader{
+    delta_file,
+    /*buffer_size=*/k_file_chunk_size_to_read + k_text_sha1_length_for_simd,
+    /*size_to_read_from_storage=*/k_file_chunk_size_to_read,
+    /*number_of_buffers=*/4u
+  };
+
+  const auto next_source_key = [&source] { return source.next_key(); };
+  // Lines that don't start with a hex key are skipped, like by the preparer.
+  const auto next_delta_key = [this, &delta_reader]() -> std::optional<Key> {
+    while (const auto text = delta_reader.next_sha1()) {
+      const char* texts[]{ text->data() };
+      Key key;
+      if (text_keys_to_binary<Key>(texts, 1u, &key) != 0u) {
+        return key;
+      }
+
+      ++m_invalid_lines_count;
+    }
+
+    return std::nullopt;
+  };
+
+  // Checksums of the output are computed from scratch, after it's written.
+  const compact_format_options options{ header.flags & ~file_flag_checksums,
+                                        header.stored_key_size };
+
+  const auto merge_into = [&](auto& inserter) {
+    const auto merged_count = merge_sorted_keys<Key>({ next_source_key, next_delta_key },
+                                                     inserter, header.stored_key_size);
+    if (merged_count) {
+      m_keys_count = merged_count->inserted;
+      inserter.finalize_inserting();
+    }
+
+    return merged_count.has_value();
+  };
+
+  auto merged = false;
+
+  if (header.has_flag(file_flag_bplus_tree)) {
+    bplus_tree_builder<fstream_wrapper, Key> builder{ output_file, header.order, options };
+    merged = merge_into(builder);
+  } else {
+    btree_sorted_keys_inserter<fstream_wrapper, Key> inserter{ tree_file, header.order };
+    merged = merge_into(inserter);
+
+    if (merged && header.format == file_format::compact) {
+      btree_compactor<fstream_wrapper, Key> compactor{ tree_file, output_file, options };
+      compactor.compact();
+    }
+  }
+
+  if (!merged) {
+    // The reader thread finishes only after the whole file has been read.
+    while (delta_reader.next_sha1()) {
+    }
+
+    return result::input_not_sorted;
+  }
+
+  append_checksums(output_file);
+
+  m_progress_callback(100);
+
+  return result::success;
+}
+
+template <typename Key>
+unsigned long long basic_merger<Key>::keys_count() const
+{
+  return m_keys_count;
+}
+
+template <typename Key>
+unsigned long long basic_merger<Key>::invalid_lines_count() const
+{
+  return m_invalid_lines_count;
+}
+
+template class basic_merger<ntlm_t>;
+template class basic_merger<sha1_t>;
+template class basic_merger<sha256_t>;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "preparer.hpp"
+
+#include <functional>
+#include <optional>
+#include <string_view>
+
+namespace okon {
+
+// Merges a prepared file with a sorted text file of hashes (e.g. new hashes or a newer dump) into
+// a new prepared file, with one sequential pass over both of them. Nothing is sorted, so it's much
+// faster than preparing the whole database again. The new file has the layout, the features and
+// the key width of the prepared one. Instantiated for ntlm_t, sha1_t and sha256_t.
+template <typename Key>
+class basic_merger
+{
+public:
+  using result = prepare_result;
+  using progress_callback_t = std::function<void(int)>;
+
+  explicit basic_merger(std::string_view prepared_file_path, std::string_view delta_file_path,
+                        std::string_view working_directory_path,
+                        std::string_view output_file_path, progress_callback_t progress_callback);
+
+  result merge();
+
+  unsigned long long keys_count() const;
+
+  // Number of lines of the delta file that were skipped, because they don't start with a hex key.
+  unsigned long long invalid_lines_count() const;
+
+private:
+  std::string_view m_prepared_file_path;
+  std::string_view m_delta_file_path;
+  std::string_view m_working_directory_path;
+  std::string_view m_output_file_path;
+  progress_callback_t m_progress_callback;
+  unsigned long long m_keys_count{ 0u };
+  unsigned long long m_invalid_lines_count{ 0u };
+};
+
+extern template class basic_merger<ntlm_t>;
+extern template class basic_merger<sha1_t>;
+extern template class basic_merger<sha256_t>;
+}
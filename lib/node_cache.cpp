@@ -0,0 +1,142 @@
+#include "node_cache.hpp"
+
+#include <mutex>
+
+namespace okon {
+node_cache::node_cache(uint64_t budget_bytes)
+  : m_budget{ budget_bytes }
+{
+}
+
+node_cache::node_ptr_t node_cache::find(btree_node::pointer_t ptr) const
+{
+  std::shared_lock lock{ m_mtx };
+
+  const auto found = m_index.find(ptr);
+  if (found == std::cend(m_index)) {
+    return nullptr;
+  }
+
+  const auto& e = m_entries[found->second];
+  e.referenced.store(true, std::memory_order_relaxed);
+  return e.node;
+}
+
+void node_cache::insert(btree_node::pointer_t ptr, node_ptr_t node, unsigned level)
+{
+  const auto cost = node_cost(*node);
+  if (cost > m_budget) {
+    return;
+  }
+
+  std::unique_lock lock{ m_mtx };
+
+  const auto already_cached = (m_index.find(ptr) != std::cend(m_index));
+  if (already_cached) {
+    return;
+  }
+
+  // Pinned nodes may take at most half of the budget, so there is always room for hot leaves.
+  const auto pinned = (level < k_pinned_levels && m_pinned_bytes + cost <= m_budget / 2u);
+
+  if (!make_room_for(cost)) {
+    return;
+  }
+
+  const auto slot = take_free_slot();
+  auto& e = m_entries[slot];
+  e.ptr = ptr;
+  e.node = std::move(node);
+  e.cost = cost;
+  e.pinned = pinned;
+
+  // A new entry is not marked as referenced. A node read only once (e.g. a leaf visited by a
+  // single lookup) is the first candidate for eviction, which makes the cache scan resistant.
+  e.referenced.store(false, std::memory_order_relaxed);
+
+  m_index[ptr] = slot;
+  m_used_bytes += cost;
+  if (pinned) {
+    m_pinned_bytes += cost;
+  }
+}
+
+uint64_t node_cache::budget() const
+{
+  return m_budget;
+}
+
+uint64_t node_cache::used_bytes() const
+{
+  std::shared_lock lock{ m_mtx };
+  return m_used_bytes;
+}
+
+uint64_t node_cache::nodes_count() const
+{
+  std::shared_lock lock{ m_mtx };
+  return m_index.size();
+}
+
+uint64_t node_cache::node_cost(const node_bytes_t& node)
+{
+  return sizeof(node_bytes_t) + sizeof(entry) + node.capacity();
+}
+
+bool node_cache::make_room_for(uint64_t cost)
+{
+  // Two full rounds of the clock hand are enough to clear every reference bit and evict every
+  // not pinned node.
+  const auto max_steps = 2u * m_entries.size();
+  auto steps = 0u;
+
+  while (m_used_bytes + cost > m_budget) {
+    if (steps++ >= max_steps) {
+      return false;
+    }
+
+    if (m_clock_hand >= m_entries.size()) {
+      m_clock_hand = 0u;
+    }
+
+    const auto slot = m_clock_hand++;
+    auto& e = m_entries[slot];
+
+    if (!e.node || e.pinned) {
+      continue;
+    }
+
+    if (e.referenced.exchange(false, std::memory_order_relaxed)) {
+      continue;
+    }
+
+    evict(e, slot);
+  }
+
+  return true;
+}
+
+void node_cache::evict(entry& e, unsigned slot)
+{
+  m_index.erase(e.ptr);
+  m_used_bytes -= e.cost;
+
+  e.ptr = btree_node::k_unused_pointer;
+  e.node.reset();
+  e.cost = 0u;
+
+  m_free_slots.push_back(slot);
+}
+
+unsigned node_cache::take_free_slot()
+{
+  if (!m_free_slots.empty()) {
+    const auto slot = m_free_slots.back();
+    m_free_slots.pop_back();
+    return slot;
+  }
+
+  m_entries.emplace_back();
+  return static_cast<unsigned>(m_entries.size() - 1u);
+}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "btree_node.hpp"
+#include "node_view.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace okon {
+
+// Bounded cache of B-tree nodes with CLOCK eviction. Nodes are kept as they are stored, see
+// node_view. Safe to use by many concurrent readers:
+// lookups take a shared lock only, insertions and evictions take an exclusive one.
+//
+// Nodes from the first k_pinned_levels levels of the tree are never evicted, as long as they fit
+// in half of the budget. For a tree of order 1024 it's at most 1025 nodes (~25MB), which makes
+// every lookup go to the storage at most (height - 2) times.
+class node_cache
+{
+public:
+  using node_ptr_t = std::shared_ptr<const node_bytes_t>;
+
+  static constexpr auto k_pinned_levels{ 2u };
+
+  explicit node_cache(uint64_t budget_bytes);
+
+  node_ptr_t find(btree_node::pointer_t ptr) const;
+  void insert(btree_node::pointer_t ptr, node_ptr_t node, unsigned level);
+
+  uint64_t budget() const;
+  uint64_t used_bytes() const;
+  uint64_t nodes_count() const;
+
+  static uint64_t node_cost(const node_bytes_t& node);
+
+private:
+  struct entry
+  {
+    btree_node::pointer_t ptr{ btree_node::k_unused_pointer };
+    node_ptr_t node;
+    uint64_t cost{ 0u };
+    bool pinned{ false };
+    mutable std::atomic<bool> referenced{ false };
+  };
+
+  bool make_room_for(uint64_t cost);
+  void evict(entry& e, unsigned slot);
+  unsigned take_free_slot();
+
+private:
+  const uint64_t m_budget;
+  uint64_t m_used_bytes{ 0u };
+  uint64_t m_pinned_bytes{ 0u };
+  mutable std::shared_mutex m_mtx;
+  std::deque<entry> m_entries;
+  std::vector<unsigned> m_free_slots;
+  std::unordered_map<btree_node::pointer_t, unsigned> m_index;
+  unsigned m_clock_hand{ 0u };
+};
+}
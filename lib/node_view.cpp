@@ -0,0 +1,268 @@
+#include "node_view.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+using okon::btree_node;
+
+constexpr auto k_keys_count_size{ okon::node_view::k_keys_count_size };
+constexpr auto k_prefix_length_size{ okon::node_view::k_prefix_length_size };
+
+uint32_t read_u32(const uint8_t* data)
+{
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+uint32_t read_keys_count(const okon::node_format& format, const uint8_t* data)
+{
+  const auto keys_count_offset = (format.layout == okon::node_layout::legacy ? sizeof(bool) : 0u);
+  return std::min(read_u32(data + keys_count_offset), format.order);
+}
+
+uint32_t read_prefix_length(const okon::node_format& format, const uint8_t* data)
+{
+  return std::min<uint32_t>(data[k_keys_count_size], format.key_size);
+}
+}
+
+namespace okon {
+node_view::node_view(const node_format& format, const uint8_t* data)
+  : m_key_size{ format.key_size }
+  , m_keys_count{ read_keys_count(format, data) }
+  , m_prefix{ data }
+{
+  switch (format.layout) {
+    case node_layout::legacy:
+      m_is_leaf = (data[0] != 0u);
+      m_pointers = data + sizeof(bool) + k_keys_count_size;
+      m_keys = m_pointers + btree_node::binary_pointers_size(format.order);
+      break;
+    case node_layout::compact_inner:
+      m_pointers = data + k_keys_count_size + summary_size(format);
+      m_keys = m_pointers + btree_node::binary_pointers_size(format.order);
+      break;
+    case node_layout::compact_leaf:
+      m_is_leaf = true;
+      m_keys = data + k_keys_count_size + summary_size(format);
+      break;
+    case node_layout::prefix_compressed_leaf:
+      m_is_leaf = true;
+      m_prefix_length = read_prefix_length(format, data);
+      m_prefix = data + k_keys_count_size + k_prefix_length_size;
+      m_keys = m_prefix + m_prefix_length;
+      break;
+  }
+
+  if (summary_size(format) > 0u) {
+    m_summary = data + k_keys_count_size;
+  }
+}
+
+uint64_t node_view::fixed_part_size(const node_format& format)
+{
+  switch (format.layout) {
+    case node_layout::legacy:
+      return btree_node::binary_size(format.order);
+    case node_layout::compact_inner:
+      return k_keys_count_size + summary_size(format) +
+        btree_node::binary_pointers_size(format.order);
+    case node_layout::compact_leaf:
+      return k_keys_count_size + summary_size(format);
+    case node_layout::prefix_compressed_leaf:
+      return k_keys_count_size + k_prefix_length_size;
+  }
+
+  return 0u;
+}
+
+uint64_t node_view::summary_size(const node_format& format)
+{
+  const auto has_summary = format.has_summary &&
+    (format.layout == node_layout::compact_inner || format.layout == node_layout::compact_leaf);
+  if (!has_summary) {
+    return 0u;
+  }
+
+  const auto entries_count = (uint64_t{ format.order } + k_summary_keys_step - 1u) /
+    k_summary_keys_step;
+  return entries_count * k_summary_entry_size;
+}
+
+uint64_t node_view::stored_size(const node_format& format, const uint8_t* fixed_part)
+{
+  const auto keys_count = uint64_t{ read_keys_count(format, fixed_part) };
+
+  switch (format.layout) {
+    case node_layout::legacy:
+      return btree_node::binary_size(format.order);
+    case node_layout::compact_inner:
+    case node_layout::compact_leaf:
+      return fixed_part_size(format) + keys_count * format.key_size;
+    case node_layout::prefix_compressed_leaf: {
+      const auto prefix_length = read_prefix_length(format, fixed_part);
+      return fixed_part_size(format) + prefix_length +
+        keys_count * (format.key_size - prefix_length);
+    }
+  }
+
+  return 0u;
+}
+
+uint64_t node_view::max_stored_size(const node_format& format)
+{
+  // A prefix of a full prefix compressed leaf saves more than it takes.
+  return format.layout == node_layout::legacy
+    ? btree_node::binary_size(format.order)
+    : fixed_part_size(format) + uint64_t{ format.order } * format.key_size;
+}
+
+uint64_t node_view::header_size(const node_format& format)
+{
+  switch (format.layout) {
+    case node_layout::legacy:
+      return sizeof(bool) + k_keys_count_size;
+    case node_layout::prefix_compressed_leaf:
+      return k_keys_count_size + k_prefix_length_size + format.key_size;
+    default:
+      return k_keys_count_size + summary_size(format);
+  }
+}
+
+node_parts node_view::parts_of(const node_format& format, const uint8_t* header)
+{
+  node_parts parts;
+  parts.keys_count = read_keys_count(format, header);
+  parts.stored_key_size = format.key_size;
+
+  const auto summary_size = node_view::summary_size(format);
+  if (summary_size > 0u) {
+    parts.summary_offset = k_keys_count_size;
+  }
+
+  switch (format.layout) {
+    case node_layout::legacy:
+      parts.is_leaf = (header[0] != 0u);
+      parts.pointers_offset = sizeof(bool) + k_keys_count_size;
+      parts.keys_offset = parts.pointers_offset + btree_node::binary_pointers_size(format.order);
+      break;
+    case node_layout::compact_inner:
+      parts.pointers_offset = k_keys_count_size + summary_size;
+      parts.keys_offset = parts.pointers_offset + btree_node::binary_pointers_size(format.order);
+      break;
+    case node_layout::compact_leaf:
+      parts.is_leaf = true;
+      parts.keys_offset = k_keys_count_size + summary_size;
+      break;
+    case node_layout::prefix_compressed_leaf:
+      parts.is_leaf = true;
+      parts.prefix_length = read_prefix_length(format, header);
+      parts.keys_offset = k_keys_count_size + k_prefix_length_size + parts.prefix_length;
+      parts.stored_key_size -= parts.prefix_length;
+      break;
+  }
+
+  return parts;
+}
+
+bool node_view::is_leaf() const
+{
+  return m_is_leaf;
+}
+
+uint32_t node_view::keys_count() const
+{
+  return m_keys_count;
+}
+
+node_view::search_result node_view::search(const uint8_t* key) const
+{
+  const auto prefix_cmp = std::memcmp(key, m_prefix, m_prefix_length);
+  if (prefix_cmp < 0) {
+    return search_result{ false, 0u };
+  }
+  if (prefix_cmp > 0) {
+    return search_result{ false, m_keys_count };
+  }
+
+  const auto suffix = key + m_prefix_length;
+  const auto suffix_length = m_key_size - m_prefix_length;
+
+  auto range = keys_range{ 0u, m_keys_count };
+  if (m_summary != nullptr) {
+    range = summary_range(m_summary, m_keys_count, m_key_size, key);
+  }
+
+  const auto first =
+    range.first + lower_bound(key_data(range.first), range.count, suffix_length, suffix);
+
+  const auto found =
+    (first < m_keys_count && std::memcmp(key_data(first), suffix, suffix_length) == 0);
+  return search_result{ found, first };
+}
+
+uint32_t node_view::lower_bound(const uint8_t* keys, uint32_t count, uint32_t key_size,
+                                const uint8_t* key)
+{
+  auto first = 0u;
+
+  while (count > 0u) {
+    const auto step = count / 2u;
+    const auto middle = first + step;
+
+    if (std::memcmp(keys + uint64_t{ middle } * key_size, key, key_size) < 0) {
+      first = middle + 1u;
+      count -= step + 1u;
+    } else {
+      count = step;
+    }
+  }
+
+  return first;
+}
+
+node_view::keys_range node_view::summary_range(const uint8_t* summary, uint32_t keys_count,
+                                               uint32_t key_size, const uint8_t* key)
+{
+  const auto entries_count = (keys_count + k_summary_keys_step - 1u) / k_summary_keys_step;
+  const auto entry_size = std::min<uint32_t>(key_size, k_summary_entry_size);
+
+  std::array<uint8_t, k_summary_entry_size> key_entry{};
+  std::memcpy(key_entry.data(), key, entry_size);
+
+  // Entries less than the key's one are of keys less than the key, greater ones are of keys
+  // greater than it. Keys of entries equal to the key's one can be either.
+  const auto less_count =
+    lower_bound(summary, entries_count, k_summary_entry_size, key_entry.data());
+  const auto entry = [summary](uint32_t index) { return summary + index * k_summary_entry_size; };
+
+  auto not_greater_count = less_count;
+  while (not_greater_count < entries_count &&
+         std::memcmp(entry(not_greater_count), key_entry.data(), k_summary_entry_size) == 0) {
+    ++not_greater_count;
+  }
+
+  const auto first = less_count > 0u ? (less_count - 1u) * k_summary_keys_step + 1u : 0u;
+  const auto last = not_greater_count < entries_count
+    ? not_greater_count * k_summary_keys_step
+    : keys_count;
+  return keys_range{ first, last - first };
+}
+
+btree_node::pointer_t node_view::child(uint32_t place) const
+{
+  if (m_is_leaf) {
+    return btree_node::k_unused_pointer;
+  }
+
+  return read_u32(m_pointers + place * sizeof(btree_node::pointer_t));
+}
+
+const uint8_t* node_view::key_data(uint32_t index) const
+{
+  return m_keys + index * (m_key_size - m_prefix_length);
+}
+}
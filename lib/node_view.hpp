@@ -0,0 +1,194 @@
+#pragma once
+
+#include "btree_node.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace okon {
+
+// Bytes of a node, exactly as they are stored in a file.
+using node_bytes_t = std::vector<uint8_t>;
+
+// How a node is laid out in a file. See file_format and file_flags.
+enum class node_layout
+{
+  legacy,
+  compact_inner,
+  compact_leaf,
+
+  // [keys_count][prefix length][prefix][suffix of every key]. Every suffix has
+  // (key size - prefix length) bytes.
+  prefix_compressed_leaf
+};
+
+struct node_format
+{
+  node_layout layout{ node_layout::legacy };
+  btree_node::order_t order{ 0u };
+
+  // Number of leading bytes of every key that are stored. Lookups compare only these bytes.
+  uint32_t key_size{ 0u };
+
+  // See file_flag_node_summaries. Only compact_inner and compact_leaf nodes have summaries.
+  bool has_summary{ false };
+};
+
+// Where the parts of a node are, relative to the beginning of the node. Lets a lookup read only
+// the parts it needs instead of the whole node.
+struct node_parts
+{
+  bool is_leaf{ false };
+  uint32_t keys_count{ 0u };
+  uint32_t prefix_length{ 0u };
+
+  // Zero if the node has no summary.
+  uint64_t summary_offset{ 0u };
+  uint64_t pointers_offset{ 0u };
+  uint64_t keys_offset{ 0u };
+
+  // Number of bytes every key takes, without the prefix.
+  uint32_t stored_key_size{ 0u };
+};
+
+// Read-only view of the stored bytes of a node. Lets to search in a node without decoding it into
+// a btree_node. Keys of a prefix compressed leaf are never decompressed: the prefix is compared
+// once and the binary search compares only the suffixes.
+//
+// A node with a summary has it right after the keys count: k_summary_entry_size leading bytes of
+// keys 0, k_summary_keys_step, 2 * k_summary_keys_step, ..., zero padded, for all the keys the
+// order allows. A search narrows the keys down to the ones between two entries with the summary.
+class node_view
+{
+public:
+  // A range of keys, see summary_range().
+  struct keys_range
+  {
+    uint32_t first{ 0u };
+    uint32_t count{ 0u };
+  };
+
+  struct search_result
+  {
+    bool found{ false };
+
+    // Index of the first key that is not less than the searched one.
+    uint32_t place{ 0u };
+  };
+
+  static constexpr auto k_keys_count_size{ sizeof(btree_node::pointer_t) };
+  static constexpr auto k_prefix_length_size{ sizeof(uint8_t) };
+  static constexpr auto k_summary_keys_step{ 32u };
+  static constexpr auto k_summary_entry_size{ sizeof(uint64_t) };
+
+  explicit node_view(const node_format& format, const uint8_t* data);
+
+  // Number of bytes at the beginning of a node that are enough to compute the size of the node.
+  static uint64_t fixed_part_size(const node_format& format);
+
+  // Number of bytes the node takes in the storage. fixed_part points to fixed_part_size() bytes.
+  static uint64_t stored_size(const node_format& format, const uint8_t* fixed_part);
+
+  // Number of bytes a full node takes in the storage. No node of the format takes more.
+  static uint64_t max_stored_size(const node_format& format);
+
+  // Number of bytes the summary of a node of the format takes, zero if it has none.
+  static uint64_t summary_size(const node_format& format);
+
+  // Number of bytes at the beginning of a node that are enough to compute its parts, including
+  // the summary and the prefix of a prefix compressed leaf.
+  static uint64_t header_size(const node_format& format);
+
+  // header points to header_size() bytes.
+  static node_parts parts_of(const node_format& format, const uint8_t* header);
+
+  // Index of the first of the sorted keys that is not less than the key. keys point to count keys
+  // of key_size bytes each.
+  static uint32_t lower_bound(const uint8_t* keys, uint32_t count, uint32_t key_size,
+                              const uint8_t* key);
+
+  // Keys of the node the summary narrows the search for the key down to. The first key that is not
+  // less than the searched one is in the range or right after it. key_size is the number of
+  // stored bytes of keys.
+  static keys_range summary_range(const uint8_t* summary, uint32_t keys_count, uint32_t key_size,
+                                  const uint8_t* key);
+
+  bool is_leaf() const;
+  uint32_t keys_count() const;
+  // key points to at least key_size bytes.
+  search_result search(const uint8_t* key) const;
+  btree_node::pointer_t child(uint32_t place) const;
+
+  template <typename Key>
+  Key key(uint32_t index) const;
+
+private:
+  const uint8_t* key_data(uint32_t index) const;
+
+private:
+  bool m_is_leaf{ false };
+  uint32_t m_key_size{ 0u };
+  uint32_t m_keys_count{ 0u };
+  uint32_t m_prefix_length{ 0u };
+  const uint8_t* m_prefix{ nullptr };
+  const uint8_t* m_summary{ nullptr };
+  const uint8_t* m_pointers{ nullptr };
+  const uint8_t* m_keys{ nullptr };
+};
+
+template <typename Key>
+Key node_view::key(uint32_t index) const
+{
+  Key key{};
+  const auto stored_size = std::min<uint32_t>(m_key_size, sizeof(Key));
+  std::memcpy(key.data(), m_prefix, m_prefix_length);
+  std::memcpy(key.data() + m_prefix_length, key_data(index), stored_size - m_prefix_length);
+  return key;
+}
+
+// Length of the prefix that the stored parts of all the keys of a leaf have in common.
+template <typename Key>
+uint32_t common_prefix_length(const basic_btree_node<Key>& leaf, uint32_t key_size = sizeof(Key))
+{
+  if (leaf.keys_count == 0u) {
+    return 0u;
+  }
+
+  // Keys are sorted, so the prefix of the first and the last key is common for all of them.
+  const auto first = std::cbegin(leaf.keys[0]);
+  const auto last = std::cbegin(leaf.keys[leaf.keys_count - 1u]);
+  const auto mismatch = std::mismatch(first, std::next(first, key_size), last);
+  return static_cast<uint32_t>(std::distance(first, mismatch.first));
+}
+
+// Summary of the keys of the node, see node_view. summary points to node_view::summary_size()
+// bytes.
+template <typename Key>
+void write_summary(const basic_btree_node<Key>& node, const node_format& format, uint8_t* summary)
+{
+  const auto entries_count = node_view::summary_size(format) / node_view::k_summary_entry_size;
+  const auto entry_size = std::min<uint64_t>(format.key_size, node_view::k_summary_entry_size);
+
+  for (auto i = 0u; i < entries_count; ++i) {
+    auto* entry = summary + i * node_view::k_summary_entry_size;
+    std::memset(entry, 0, node_view::k_summary_entry_size);
+
+    const auto key_index = i * node_view::k_summary_keys_step;
+    if (key_index < node.keys_count) {
+      std::memcpy(entry, node.keys[key_index].data(), entry_size);
+    }
+  }
+}
+
+// Number of bytes the leaf takes in the storage when stored as a prefix compressed leaf.
+template <typename Key>
+uint64_t prefix_compressed_leaf_size(const basic_btree_node<Key>& leaf,
+                                     uint32_t key_size = sizeof(Key))
+{
+  const auto prefix_length = common_prefix_length(leaf, key_size);
+  return node_view::k_keys_count_size + node_view::k_prefix_length_size + prefix_length +
+    uint64_t{ leaf.keys_count } * (key_size - prefix_length);
+}
+}
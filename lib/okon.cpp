@@ -1,65 +1,718 @@
 #include <okon/okon.h>
 
+#include "async_lookups.hpp"
 #include "btree.hpp"
+#include "checksums.hpp"
 #include "fstream_wrapper.hpp"
+#include "in_memory_keys.hpp"
+#include "keys_exporter.hpp"
+#include "lookup_metrics.hpp"
+#include "merger.hpp"
+#include "node_cache.hpp"
+#include "pread_file.hpp"
 #include "preparer.hpp"
+#include "read_ahead_storage.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace {
+// Calls the function with a value of the key type of the given width. Width of SHA-1 is the
+// default.
+template <typename Function>
+auto visit_key_type(uint32_t key_size, Function&& fun)
+{
+  switch (key_size) {
+    case sizeof(okon::ntlm_t):
+      return fun(okon::ntlm_t{});
+    case sizeof(okon::sha256_t):
+      return fun(okon::sha256_t{});
+    default:
+      return fun(okon::sha1_t{});
+  }
+}
+
+uint32_t key_size_of(okon_hash_type hash_type)
+{
+  switch (hash_type) {
+    case okon_hash_type::okon_hash_type_ntlm:
+      return sizeof(okon::ntlm_t);
+    case okon_hash_type::okon_hash_type_sha256:
+      return sizeof(okon::sha256_t);
+    default:
+      return sizeof(okon::sha1_t);
+  }
+}
+
+template <typename Key>
+Key binary_key_from_text(const char* text)
+{
+  // The decoder may access more characters than the key has.
+  std::array<char, okon::k_text_sha1_length_for_simd> padded{};
+  std::memcpy(padded.data(), text, okon::k_text_key_length<Key>);
+  return okon::text_key_to_binary<Key>(padded.data());
+}
+
+template <typename Key>
+Key binary_key_from_bytes(const void* bytes)
+{
+  Key key;
+  std::memcpy(key.data(), bytes, sizeof(Key));
+  return key;
+}
+
+okon::preparer::progress_callback_t make_progress_callback(
+  okon_prepare_progress_callback_t user_progress_callback, void* progress_callback_user_data)
+{
+  if (!user_progress_callback) {
+    return [](int) {};
+  }
+
+  return [user_progress_callback, progress_callback_user_data](int progress) {
+    user_progress_callback(progress_callback_user_data, progress);
+  };
+}
+
+okon_prepare_result to_prepare_result(okon::prepare_result result)
+{
+  switch (result) {
+    case okon::prepare_result::success:
+      return okon_prepare_result::okon_prepare_result_success;
+    case okon::prepare_result::could_not_open_input_file:
+      return okon_prepare_result::okon_prepare_result_could_not_open_input_file;
+    case okon::prepare_result::could_not_open_intermediate_files:
+      return okon_prepare_result::okon_prepare_result_could_not_open_intermediate_files;
+    case okon::prepare_result::could_not_open_output:
+      return okon_prepare_result::okon_prepare_result_could_not_open_output;
+    case okon::prepare_result::input_not_sorted:
+      return okon_prepare_result::okon_prepare_result_input_not_sorted;
+    case okon::prepare_result::incompatible_input:
+      return okon_prepare_result::okon_prepare_result_incompatible_input;
+  }
+
+  return okon_prepare_result::okon_prepare_result_unspecified_failure;
+}
+
+template <typename Tree>
+constexpr bool is_in_memory_keys_v{ false };
+
+template <typename Key>
+constexpr bool is_in_memory_keys_v<okon::in_memory_keys<Key>>{ true };
+
+template <typename Tree, typename Key>
+okon_exists_result to_exists_result(const Tree& tree, const Key& key)
+{
+  return tree.contains(key) ? okon_exists_result::okon_exists_result_exists
+                            : okon_exists_result::okon_exists_result_doesnt_exist;
+}
+}
+
+struct okon_handle
+{
+  explicit okon_handle(const char* prepared_file_path, const okon_open_options& options)
+    : path{ prepared_file_path }
+    , file{ prepared_file_path }
+  {
+    if (options.node_cache_size > 0u) {
+      cache.emplace(options.node_cache_size);
+    }
+  }
+
+  std::string path;
+
+  // Read with positional reads, so lookups from many threads don't wait for each other.
+  okon::pread_file file;
+  std::optional<okon::node_cache> cache;
+  uint32_t key_size{ sizeof(okon::sha1_t) };
+  okon::file_header header;
+  uint64_t pinned_size{ 0u };
+
+  // Tree of the key type of the file, or its keys loaded into memory. The key type is known after
+  // reading the header.
+  std::variant<std::monostate, okon::btree<okon::pread_file, okon::ntlm_t>,
+               okon::btree<okon::pread_file, okon::sha1_t>,
+               okon::btree<okon::pread_file, okon::sha256_t>,
+               okon::in_memory_keys<okon::ntlm_t>, okon::in_memory_keys<okon::sha1_t>,
+               okon::in_memory_keys<okon::sha256_t>>
+    tree;
+};
+
+namespace {
+// Callback of a lookup submitted with okon_async_exists_binary().
+struct async_callback
+{
+  void operator()(okon::async_lookup_result result) const
+  {
+    switch (result) {
+      case okon::async_lookup_result::found:
+        fun(okon_exists_result::okon_exists_result_exists, user_data);
+        break;
+      case okon::async_lookup_result::not_found:
+        fun(okon_exists_result::okon_exists_result_doesnt_exist, user_data);
+        break;
+      case okon::async_lookup_result::read_failed:
+        fun(okon_exists_result::okon_prepare_result_could_not_open_file, user_data);
+        break;
+    }
+  }
+
+  okon_exists_callback_t fun{ nullptr };
+  void* user_data{ nullptr };
+};
+
+template <typename Key>
+using async_lookups_t = okon::async_lookups<okon::btree<okon::pread_file, Key>, async_callback>;
+}
+
+struct okon_async
+{
+  okon_handle* handle{ nullptr };
+
+  // Lookups reading the file of the handle. Empty if the handle doesn't read the file, e.g. it's
+  // loaded into memory.
+  std::variant<std::monostate, async_lookups_t<okon::ntlm_t>, async_lookups_t<okon::sha1_t>,
+               async_lookups_t<okon::sha256_t>>
+    lookups;
+
+  // Lookups that have been done right away. Their callbacks are called by the next poll.
+  std::vector<std::pair<async_callback, okon_exists_result>> done;
+};
 
 okon_prepare_result okon_prepare(const char* input_db_file_path, const char* working_directory,
                                  const char* output_processed_file_path,
                                  okon_prepare_progress_callback_t user_progress_callback,
                                  void* progress_callback_user_data)
 {
+  return okon_prepare_with_options(input_db_file_path, working_directory,
+                                   output_processed_file_path, nullptr, user_progress_callback,
+                                   progress_callback_user_data);
+}
+
+okon_prepare_result okon_prepare_with_options(
+  const char* input_db_file_path, const char* working_directory,
+  const char* output_processed_file_path, const okon_prepare_options* options,
+  okon_prepare_progress_callback_t user_progress_callback, void* progress_callback_user_data)
+{
+  return okon_prepare_multiple(&input_db_file_path, 1u, nullptr, 0u, working_directory,
+                               output_processed_file_path, options, user_progress_callback,
+                               progress_callback_user_data);
+}
+
+okon_prepare_result okon_prepare_multiple(
+  const char* const* input_db_file_paths, unsigned input_db_files_count,
+  const char* const* prepared_file_paths, unsigned prepared_files_count,
+  const char* working_directory, const char* output_processed_file_path,
+  const okon_prepare_options* options, okon_prepare_progress_callback_t user_progress_callback,
+  void* progress_callback_user_data)
+{
+  const auto opts = options != nullptr ? *options : okon_prepare_options{};
+
   std::ofstream{ output_processed_file_path };
 
   const auto progress_callback =
-    [user_progress_callback, progress_callback_user_data]() -> okon::preparer::progress_callback_t {
-    if (!user_progress_callback) {
-      return [](int) {};
+    make_progress_callback(user_progress_callback, progress_callback_user_data);
+
+  const auto key_size = key_size_of(opts.hash_type);
+
+  // Legacy files don't store the width of the keys, so they can store only SHA-1 hashes.
+  const auto legacy_requested = opts.format == okon_prepare_format::okon_prepare_format_legacy;
+  const auto format = (legacy_requested && key_size == sizeof(okon::sha1_t))
+    ? okon::file_format::legacy
+    : okon::file_format::compact;
+
+  okon::compact_format_options compact_options;
+  if (opts.compress_leaves != 0) {
+    compact_options.flags |= okon::file_flag_prefix_compressed_leaves;
+  }
+  if (opts.bplus_tree != 0) {
+    compact_options.flags |= okon::file_flag_bplus_tree;
+  }
+  if (opts.node_summaries != 0) {
+    compact_options.flags |= okon::file_flag_node_summaries;
+  }
+  if (opts.fingerprint_size > 0u && opts.fingerprint_size < key_size) {
+    compact_options.stored_key_size = opts.fingerprint_size;
+  }
+
+  const std::vector<std::string_view> input_paths(input_db_file_paths,
+                                                  input_db_file_paths + input_db_files_count);
+  const std::vector<std::string_view> prepared_paths(prepared_file_paths,
+                                                     prepared_file_paths + prepared_files_count);
+
+  const auto result = visit_key_type(key_size, [&](auto key) {
+    using key_t = decltype(key);
+
+    okon::basic_preparer<key_t> preparer{ input_paths,
+                                          prepared_paths,
+                                          working_directory,
+                                          output_processed_file_path,
+                                          format,
+                                          compact_options,
+                                          progress_callback };
+    const auto result = preparer.prepare();
+
+    if (result == okon::prepare_result::success && opts.stats != nullptr) {
+      opts.stats->keys_count = preparer.keys_count();
+      opts.stats->false_positive_rate = okon::expected_false_positive_rate(
+        preparer.keys_count(), preparer.output_stored_key_size(), key_size);
+      opts.stats->duplicates_count = preparer.duplicates_count();
+      opts.stats->invalid_lines_count = preparer.invalid_lines_count();
     }
 
-    return [user_progress_callback, progress_callback_user_data](int progress) {
-      user_progress_callback(progress_callback_user_data, progress);
-    };
+    return result;
+  });
+
+  return to_prepare_result(result);
+}
+
+okon_prepare_result okon_merge(const char* prepared_file_path, const char* input_db_file_path,
+                               const char* working_directory,
+                               const char* output_processed_file_path,
+                               okon_prepare_progress_callback_t user_progress_callback,
+                               void* progress_callback_user_data)
+{
+  const auto header = [prepared_file_path]() -> std::optional<okon::file_header> {
+    okon::fstream_wrapper file{ prepared_file_path, std::ios::in | std::ios::binary };
+    if (!file.is_open()) {
+      return std::nullopt;
+    }
+
+    return okon::read_file_header(file);
   }();
 
-  okon::preparer preparer{ input_db_file_path, working_directory, output_processed_file_path,
-                           progress_callback };
-  const auto result = preparer.prepare();
+  if (!header) {
+    return okon_prepare_result::okon_prepare_result_could_not_open_input_file;
+  }
 
-  switch (result) {
-    case okon::preparer::result ::success:
-      return okon_prepare_result ::okon_prepare_result_success;
-    case okon::preparer::result ::could_not_open_input_file:
-      return okon_prepare_result ::okon_prepare_result_could_not_open_input_file;
-    case okon::preparer::result ::could_not_open_intermediate_files:
-      return okon_prepare_result ::okon_prepare_result_could_not_open_intermediate_files;
-    case okon::preparer::result ::could_not_open_output:
-      return okon_prepare_result ::okon_prepare_result_could_not_open_output;
+  if (!okon::is_supported(*header)) {
+    return okon_prepare_result::okon_prepare_result_incompatible_input;
+  }
+
+  const auto progress_callback =
+    make_progress_callback(user_progress_callback, progress_callback_user_data);
+
+  const auto result = visit_key_type(header->key_size, [&](auto key) {
+    okon::basic_merger<decltype(key)> merger{ prepared_file_path, input_db_file_path,
+                                              working_directory, output_processed_file_path,
+                                              progress_callback };
+    return merger.merge();
+  });
+
+  return to_prepare_result(result);
+}
+
+namespace {
+// Dispatches on the width of the keys of the file, once per call.
+template <typename Function>
+okon_exists_result exists_in_file(const char* processed_file_path, Function&& fun)
+{
+  okon::pread_file file{ processed_file_path };
+
+  if (!file.is_open()) {
+    return okon_exists_result::okon_prepare_result_could_not_open_file;
+  }
+
+  const auto header = okon::read_file_header(file);
+  if (!okon::is_supported(header)) {
+    return okon_exists_result::okon_prepare_result_could_not_open_file;
   }
 
-  return okon_prepare_result ::okon_prepare_result_unspecified_failure;
+  return visit_key_type(header.key_size, [&file, &fun](auto key) {
+    const okon::btree<okon::pread_file, decltype(key)> tree{ file };
+    return fun(tree);
+  });
+}
+
+template <typename Function>
+okon_exists_result exists_in_handle(okon_handle* handle, Function&& fun)
+{
+  return std::visit(
+    [&fun](const auto& tree) {
+      if constexpr (std::is_same_v<std::decay_t<decltype(tree)>, std::monostate>) {
+        return okon_exists_result::okon_exists_result_doesnt_exist;
+      } else {
+        return fun(tree);
+      }
+    },
+    handle->tree);
+}
 }
 
 okon_exists_result okon_exists_text(const char* sha1, const char* processed_file_path)
 {
-  const auto sha1_bin = okon::text_sha1_to_binary(sha1);
-  return okon_exists_binary(sha1_bin.data(), processed_file_path);
+  return exists_in_file(processed_file_path, [sha1](const auto& tree) {
+    using key_t = typename std::decay_t<decltype(tree)>::key_t;
+    return to_exists_result(tree, binary_key_from_text<key_t>(sha1));
+  });
 }
 
 okon_exists_result okon_exists_binary(const void* sha1, const char* processed_file_path)
 {
-  okon::fstream_wrapper file{ processed_file_path,
-                              std::ios::in | std::ios::out | std::ios::binary };
+  return exists_in_file(processed_file_path, [sha1](const auto& tree) {
+    using key_t = typename std::decay_t<decltype(tree)>::key_t;
+    return to_exists_result(tree, binary_key_from_bytes<key_t>(sha1));
+  });
+}
+
+okon_handle* okon_open(const char* prepared_file_path, const okon_open_options* options)
+{
+  const auto opts = options != nullptr ? *options : okon_open_options{};
+
+  auto handle = std::make_unique<okon_handle>(prepared_file_path, opts);
+  if (!handle->file.is_open()) {
+    return nullptr;
+  }
+
+  if (opts.verify_header != 0) {
+    const auto result = okon::verify_header(handle->file);
+    if (result != okon::verify_result::valid && result != okon::verify_result::no_checksums) {
+      return nullptr;
+    }
+  }
+
+  const auto header = okon::read_file_header(handle->file);
+  if (!okon::is_supported(header)) {
+    return nullptr;
+  }
+
+  handle->header = header;
 
+  auto* cache = handle->cache ? &*handle->cache : nullptr;
+
+  const auto pinned = visit_key_type(header.key_size, [&handle, &opts, cache](auto key) {
+    handle->key_size = sizeof(key);
+
+    if (opts.load_into_memory != 0) {
+      using keys_t = okon::in_memory_keys<decltype(key)>;
+      const auto& keys = handle->tree.template emplace<keys_t>(handle->file);
+      handle->pinned_size = keys.size_in_bytes();
+      return keys.is_loaded();
+    }
+
+    using tree_t = okon::btree<okon::pread_file, decltype(key)>;
+    auto& tree = handle->tree.template emplace<tree_t>(handle->file, cache);
+
+    tree.set_partial_node_reads(opts.partial_node_reads != 0);
+
+    if (opts.pin_inner_nodes == 0) {
+      return true;
+    }
+
+    const auto locked = tree.pin_inner_nodes(opts.lock_pinned_nodes != 0);
+    if (const auto* nodes = tree.pinned_inner_nodes()) {
+      handle->pinned_size = nodes->size_in_bytes();
+    }
+
+    return locked;
+  });
+
+  if (!pinned) {
+    return nullptr;
+  }
+
+  return handle.release();
+}
+
+void okon_close(okon_handle* handle)
+{
+  delete handle;
+}
+
+okon_exists_result okon_handle_exists_text(okon_handle* handle, const char* sha1)
+{
+  return exists_in_handle(handle, [sha1](const auto& tree) {
+    using key_t = typename std::decay_t<decltype(tree)>::key_t;
+    return to_exists_result(tree, binary_key_from_text<key_t>(sha1));
+  });
+}
+
+okon_exists_result okon_handle_exists_binary(okon_handle* handle, const void* sha1)
+{
+  return exists_in_handle(handle, [sha1](const auto& tree) {
+    using key_t = typename std::decay_t<decltype(tree)>::key_t;
+    return to_exists_result(tree, binary_key_from_bytes<key_t>(sha1));
+  });
+}
+
+void okon_handle_exists_binary_batch(okon_handle* handle, const void* hashes,
+                                     unsigned long long count, okon_exists_result* results)
+{
+  std::visit(
+    [hashes, count, results](const auto& tree) {
+      using tree_t = std::decay_t<decltype(tree)>;
+
+      if constexpr (std::is_same_v<tree_t, std::monostate>) {
+        std::fill_n(results, count, okon_exists_result::okon_exists_result_doesnt_exist);
+      } else {
+        using key_t = typename tree_t::key_t;
+        const auto* bytes = static_cast<const uint8_t*>(hashes);
+
+        if constexpr (is_in_memory_keys_v<tree_t>) {
+          static_assert(sizeof(key_t) == std::tuple_size_v<key_t>);
+          tree.contains_batch(reinterpret_cast<const key_t*>(bytes), count,
+                              [results](uint64_t index, bool found) {
+                                results[index] = found
+                                  ? okon_exists_result::okon_exists_result_exists
+                                  : okon_exists_result::okon_exists_result_doesnt_exist;
+                              });
+        } else {
+          for (auto i = 0ull; i < count; ++i) {
+            results[i] = to_exists_result(tree, binary_key_from_bytes<key_t>(bytes));
+            bytes += sizeof(key_t);
+          }
+        }
+      }
+    },
+    handle->tree);
+}
+
+okon_async* okon_async_open(okon_handle* handle, unsigned queue_depth)
+{
+  auto async = std::make_unique<okon_async>();
+  async->handle = handle;
+
+  const auto opened = std::visit(
+    [&async, handle, queue_depth](const auto& tree) {
+      using tree_t = std::decay_t<decltype(tree)>;
+
+      if constexpr (std::is_same_v<tree_t, std::monostate> || is_in_memory_keys_v<tree_t>) {
+        return true;
+      } else {
+        using lookups_t = async_lookups_t<typename tree_t::key_t>;
+        const auto& lookups =
+          async->lookups.template emplace<lookups_t>(tree, handle->path, queue_depth);
+        return lookups.is_open();
+      }
+    },
+    handle->tree);
+
+  return opened ? async.release() : nullptr;
+}
+
+void okon_async_close(okon_async* async)
+{
+  delete async;
+}
+
+void okon_async_exists_binary(okon_async* async, const void* sha1,
+                              okon_exists_callback_t callback, void* user_data)
+{
+  const async_callback fun{ callback, user_data };
+
+  std::visit(
+    [async, sha1, &fun](auto& lookups) {
+      using lookups_t = std::decay_t<decltype(lookups)>;
+
+      if constexpr (std::is_same_v<lookups_t, std::monostate>) {
+        const auto result = exists_in_handle(async->handle, [sha1](const auto& tree) {
+          using key_t = typename std::decay_t<decltype(tree)>::key_t;
+          return to_exists_result(tree, binary_key_from_bytes<key_t>(sha1));
+        });
+        async->done.emplace_back(fun, result);
+      } else {
+        using key_t = typename lookups_t::key_t;
+        lookups.submit(binary_key_from_bytes<key_t>(sha1), fun);
+      }
+    },
+    async->lookups);
+}
+
+unsigned okon_async_poll(okon_async* async, int wait)
+{
+  auto done = std::exchange(async->done, {});
+  for (const auto& [fun, result] : done) {
+    fun.fun(result, fun.user_data);
+  }
+
+  const auto wait_for_reads = wait != 0 && done.empty();
+
+  return static_cast<unsigned>(done.size()) +
+    std::visit(
+           [wait_for_reads](auto& lookups) {
+             if constexpr (std::is_same_v<std::decay_t<decltype(lookups)>, std::monostate>) {
+               return 0u;
+             } else {
+               return lookups.poll(wait_for_reads);
+             }
+           },
+           async->lookups);
+}
+
+unsigned long long okon_async_in_flight(okon_async* async)
+{
+  return async->done.size() +
+    std::visit(
+           [](const auto& lookups) -> uint64_t {
+             if constexpr (std::is_same_v<std::decay_t<decltype(lookups)>, std::monostate>) {
+               return 0u;
+             } else {
+               return lookups.in_flight_count();
+             }
+           },
+           async->lookups);
+}
+
+unsigned okon_handle_key_size(okon_handle* handle)
+{
+  return handle->key_size;
+}
+
+unsigned long long okon_handle_pinned_size(okon_handle* handle)
+{
+  return handle->pinned_size;
+}
+
+okon_stats_result okon_stats(okon_handle* handle, okon_tree_stats* stats)
+{
+  static_assert(okon_tree_stats_constants::okon_tree_stats_max_levels_count ==
+                okon::file_header::k_max_levels_in_header);
+
+  const auto& header = handle->header;
+
+  *stats = okon_tree_stats{};
+  stats->order = header.order;
+  stats->leaf_nodes_count = header.leaf_nodes_count;
+  stats->nodes_count = uint64_t{ header.inner_nodes_count } + header.leaf_nodes_count;
+
+  if (header.height == 0u) {
+    return okon_stats_result::okon_stats_result_not_available;
+  }
+
+  stats->keys_count = header.keys_count;
+  stats->height = header.height;
+  std::copy(std::begin(header.level_nodes_counts), std::end(header.level_nodes_counts),
+            std::begin(stats->level_nodes_counts));
+
+  return okon_stats_result::okon_stats_result_success;
+}
+
+unsigned long long okon_handle_for_each_with_prefix(okon_handle* handle, const char* prefix,
+                                                    unsigned prefix_length,
+                                                    okon_prefix_callback_t callback,
+                                                    void* callback_user_data)
+{
+  unsigned long long found_count{ 0u };
+
+  std::visit(
+    [&](const auto& tree) {
+      if constexpr (!std::is_same_v<std::decay_t<decltype(tree)>, std::monostate>) {
+        using key_t = typename std::decay_t<decltype(tree)>::key_t;
+
+        // Characters that are not in the prefix are decoded as zeros and never compared.
+        std::array<char, okon::k_text_sha1_length_for_simd> text;
+        text.fill('0');
+        const auto length = std::min<unsigned>(prefix_length, okon::k_text_key_length<key_t>);
+        std::memcpy(text.data(), prefix, length);
+
+        const auto on_key = [&found_count, callback, callback_user_data](const key_t& key) {
+          ++found_count;
+          if (callback != nullptr) {
+            callback(callback_user_data, key.data());
+          }
+        };
+
+        tree.for_each_key_with_prefix(binary_key_from_text<key_t>(text.data()),
+                                      /*prefix_bits=*/4u * length, on_key);
+      }
+    },
+    handle->tree);
+
+  return found_count;
+}
+
+okon_export_result okon_export(const char* prepared_file_path, const char* output_file_path,
+                               okon_export_format format, unsigned long long* exported_count)
+{
+  okon::fstream_wrapper file{ prepared_file_path, std::ios::in | std::ios::binary };
   if (!file.is_open()) {
-    return okon_exists_result::okon_prepare_result_could_not_open_file;
+    return okon_export_result::okon_export_result_could_not_open_input_file;
+  }
+
+  const auto header = okon::read_file_header(file);
+  if (!okon::is_supported(header)) {
+    return okon_export_result::okon_export_result_could_not_open_input_file;
+  }
+
+  std::ofstream output{ output_file_path, std::ios::out | std::ios::trunc | std::ios::binary };
+  if (!output.is_open()) {
+    return okon_export_result::okon_export_result_could_not_open_output;
+  }
+
+  okon::read_ahead_storage<okon::fstream_wrapper> storage{ file };
+  const auto keys_format = format == okon_export_format::okon_export_format_binary
+    ? okon::export_format::binary
+    : okon::export_format::text;
+
+  const auto keys_count =
+    visit_key_type(header.key_size, [&storage, &output, keys_format](auto key) {
+      return okon::export_keys<decltype(key)>(storage, output, keys_format);
+    });
+
+  output.flush();
+  if (!output.good()) {
+    return okon_export_result::okon_export_result_could_not_write_output;
+  }
+
+  if (exported_count != nullptr) {
+    *exported_count = keys_count;
+  }
+
+  return okon_export_result::okon_export_result_success;
+}
+
+okon_verify_result okon_verify(const char* prepared_file_path, unsigned threads_count)
+{
+  const auto open_file = [prepared_file_path] {
+    return okon::fstream_wrapper{ prepared_file_path, std::ios::in | std::ios::binary };
+  };
+
+  if (!open_file().is_open()) {
+    return okon_verify_result::okon_verify_result_could_not_open_file;
   }
 
-  okon::btree tree{ file };
+  if (threads_count == 0u) {
+    threads_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
 
-  okon::sha1_t sha1_bin;
-  std::memcpy(&sha1_bin[0], sha1, 20u);
+  switch (okon::verify_checksums(open_file, threads_count)) {
+    case okon::verify_result::valid:
+      return okon_verify_result::okon_verify_result_ok;
+    case okon::verify_result::no_checksums:
+      return okon_verify_result::okon_verify_result_no_checksums;
+    case okon::verify_result::corrupted_header:
+      return okon_verify_result::okon_verify_result_corrupted_header;
+    case okon::verify_result::truncated:
+      return okon_verify_result::okon_verify_result_truncated;
+    default:
+      return okon_verify_result::okon_verify_result_corrupted;
+  }
+}
+
+okon_metrics_result okon_get_lookup_metrics(okon_lookup_metrics* metrics)
+{
+  okon::lookup_metrics::global().snapshot(*metrics);
 
-  return tree.contains(sha1_bin) ? okon_exists_result::okon_exists_result_exists
-                                 : okon_exists_result::okon_exists_result_doesnt_exist;
+#ifdef OKON_WITH_METRICS
+  return okon_metrics_result::okon_metrics_result_success;
+#else
+  return okon_metrics_result::okon_metrics_result_disabled;
+#endif
+}
+
+void okon_reset_lookup_metrics()
+{
+  okon::lookup_metrics::global().reset();
+}
+
+unsigned long long okon_lookup_metrics_bucket_lower_bound(unsigned bucket_index)
+{
+  return okon::latency_histogram_bucket_lower_bound(bucket_index);
 }
@@ -4,6 +4,8 @@
 #include "sha1_utils.hpp"
 
 #include <array>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <optional>
 #include <string_view>
@@ -11,8 +13,48 @@
 #include <vector>
 
 namespace okon {
+namespace details {
+// Stores positions of all the '\n' characters of the text in positions, which needs to have room
+// for size of them. Returns the number of them. With OKON_USE_SIMD, 64 bytes are compared at once
+// and the positions are extracted from the bit mask of the matches, so k_text_sha1_length_for_simd
+// bytes after the text need to be accessible, like in the buffers of the reader.
+inline unsigned index_new_lines(const char* text, unsigned size, uint32_t* positions)
+{
+  auto count = 0u;
+
+#ifdef OKON_USE_SIMD
+  for (auto offset = 0u; offset < size; offset += 64u) {
+    vcl::Vec64uc block;
+    block.load(text + offset);
+
+    auto matches = to_bits(block == vcl::Vec64uc{ '\n' });
+    if (size - offset < 64u) {
+      matches &= (uint64_t{ 1u } << (size - offset)) - 1u;
+    }
+
+    while (matches != 0u) {
+      positions[count++] = offset + vcl::bit_scan_forward(matches);
+      matches &= matches - 1u;
+    }
+  }
+#else
+  for (auto offset = 0u; offset < size; ++offset) {
+    const auto new_line = static_cast<const char*>(std::memchr(text + offset, '\n', size - offset));
+    if (new_line == nullptr) {
+      break;
+    }
 
-template <typename DataStorage>
+    offset = static_cast<unsigned>(new_line - text);
+    positions[count++] = offset;
+  }
+#endif
+
+  return count;
+}
+}
+
+// Reads text hashes of the Key type, one per line. Lines shorter than a hash are skipped.
+template <typename DataStorage, typename Key = sha1_t>
 class original_file_reader
 {
 public:
@@ -27,11 +69,20 @@ public:
 
   std::optional<std::string_view> next_sha1();
 
+  // Fills texts with beginnings of at most max_count next hashes, for a batched decoding. Returns
+  // the number of them, 0 at the end of the input. The texts are valid till the next call. A batch
+  // ends at the end of a chunk, so it never needs another chunk to be read.
+  unsigned next_sha1s(const char** texts, unsigned max_count);
+
   bool is_open() const;
 
 private:
   std::optional<std::string_view> read_split_sha1();
   void read_chunk();
+  void index_new_lines();
+
+  bool is_at_short_line();
+  void skip_short_lines();
 
   void advance_view(unsigned n);
   void advance_till_next_sha1();
@@ -45,40 +96,85 @@ private:
   std::vector<uint8_t>* m_buffer{ nullptr };
   std::string_view m_buffer_view;
   std::array<char, k_text_sha1_length_for_simd> m_backup_buffer{};
+
+  // Positions of the new lines of the current chunk, from the beginning of the buffer. Lines are
+  // skipped with them, without searching for the end of every line.
+  std::vector<uint32_t> m_new_lines;
+  unsigned m_new_lines_count{ 0u };
+  unsigned m_next_new_line{ 0u };
   bool m_need_to_read_and_advance_till_next_sha1{ false };
   bool m_has_more_input{ true };
 };
 
-template <typename DataStorage>
-std::optional<std::string_view> original_file_reader<DataStorage>::next_sha1()
+template <typename DataStorage, typename Key>
+std::optional<std::string_view> original_file_reader<DataStorage, Key>::next_sha1()
 {
-  if (m_need_to_read_and_advance_till_next_sha1) {
-    read_chunk();
-    if (!m_has_more_input) {
-      return std::nullopt;
+  while (true) {
+    if (m_need_to_read_and_advance_till_next_sha1) {
+      read_chunk();
+      if (!m_has_more_input) {
+        return std::nullopt;
+      }
+      advance_till_next_sha1();
+      m_need_to_read_and_advance_till_next_sha1 = false;
+    }
+
+    if (is_at_short_line()) {
+      advance_till_next_sha1();
+      continue;
+    }
+
+    if (m_buffer_view.size() < k_text_key_length<Key>) {
+      // An empty view means that the split line was short and has been skipped.
+      const auto sha1 = read_split_sha1();
+      if (!sha1 || !sha1->empty()) {
+        return sha1;
+      }
+
+      continue;
     }
+
+    const auto sha1_view = std::string_view{ m_buffer_view.data(), k_text_key_length<Key> };
+
     advance_till_next_sha1();
-    m_need_to_read_and_advance_till_next_sha1 = false;
+    return sha1_view;
   }
+}
 
-  if (m_buffer_view.size() < k_text_sha1_length) {
-    return read_split_sha1();
-  }
+template <typename DataStorage, typename Key>
+unsigned original_file_reader<DataStorage, Key>::next_sha1s(const char** texts, unsigned max_count)
+{
+  auto count = 0u;
 
-  const auto sha1_view = std::string_view{ m_buffer_view.data(), k_text_sha1_length };
+  while (count < max_count) {
+    // Short lines are skipped here only till the end of the chunk, so texts stay valid.
+    skip_short_lines();
 
-  advance_till_next_sha1();
-  return sha1_view;
+    const auto needs_next_chunk = m_need_to_read_and_advance_till_next_sha1 ||
+      m_buffer_view.size() < k_text_key_length<Key>;
+    if (count > 0u && needs_next_chunk) {
+      break;
+    }
+
+    const auto sha1 = next_sha1();
+    if (!sha1) {
+      break;
+    }
+
+    texts[count++] = sha1->data();
+  }
+
+  return count;
 }
 
-template <typename DataStorage>
-bool original_file_reader<DataStorage>::is_open() const
+template <typename DataStorage, typename Key>
+bool original_file_reader<DataStorage, Key>::is_open() const
 {
   return m_storage.is_open();
 }
 
-template <typename DataStorage>
-std::optional<std::string_view> original_file_reader<DataStorage>::read_split_sha1()
+template <typename DataStorage, typename Key>
+std::optional<std::string_view> original_file_reader<DataStorage, Key>::read_split_sha1()
 {
   const auto first_part_size = m_buffer_view.size();
   std::memcpy(&m_backup_buffer[0], m_buffer_view.data(), first_part_size);
@@ -88,18 +184,23 @@ std::optional<std::string_view> original_file_reader<DataStorage>::read_split_sh
     return std::nullopt;
   }
 
-  const auto second_part_size = k_text_sha1_length - first_part_size;
+  const auto second_part_size = k_text_key_length<Key> - first_part_size;
+  if (m_new_lines_count > 0u && m_new_lines[0u] < second_part_size) {
+    advance_till_next_sha1();
+    return std::string_view{};
+  }
+
   std::memcpy(std::next(&m_backup_buffer[0], first_part_size), m_buffer_view.data(),
               second_part_size);
 
   advance_view(second_part_size);
   advance_till_next_sha1();
 
-  return std::string_view{ m_backup_buffer.data(), k_text_sha1_length };
+  return std::string_view{ m_backup_buffer.data(), k_text_key_length<Key> };
 }
 
-template <typename DataStorage>
-void original_file_reader<DataStorage>::read_chunk()
+template <typename DataStorage, typename Key>
+void original_file_reader<DataStorage, Key>::read_chunk()
 {
   const auto buffer_index = m_buffers.take_for_processing();
   if (!buffer_index) {
@@ -116,27 +217,71 @@ void original_file_reader<DataStorage>::read_chunk()
 
   m_buffer_view = std::string_view{ reinterpret_cast<const char*>(m_buffer->data()),
                                     m_buffer->size() - k_text_sha1_length_for_simd };
+  index_new_lines();
+}
+
+template <typename DataStorage, typename Key>
+void original_file_reader<DataStorage, Key>::index_new_lines()
+{
+  const auto size = static_cast<unsigned>(m_buffer_view.size());
+  if (m_new_lines.size() < size) {
+    m_new_lines.resize(size);
+  }
+
+  m_new_lines_count = details::index_new_lines(m_buffer_view.data(), size, m_new_lines.data());
+  m_next_new_line = 0u;
 }
 
-template <typename DataStorage>
-void original_file_reader<DataStorage>::advance_view(unsigned n)
+// Whether the line at the beginning of the view ends before a whole hash, within the current chunk.
+template <typename DataStorage, typename Key>
+bool original_file_reader<DataStorage, Key>::is_at_short_line()
+{
+  if (m_buffer == nullptr || m_need_to_read_and_advance_till_next_sha1) {
+    return false;
+  }
+
+  const auto pos = static_cast<uint32_t>(m_buffer_view.data() -
+                                         reinterpret_cast<const char*>(m_buffer->data()));
+  while (m_next_new_line < m_new_lines_count && m_new_lines[m_next_new_line] < pos) {
+    ++m_next_new_line;
+  }
+
+  return m_next_new_line < m_new_lines_count &&
+    m_new_lines[m_next_new_line] < pos + k_text_key_length<Key>;
+}
+
+template <typename DataStorage, typename Key>
+void original_file_reader<DataStorage, Key>::skip_short_lines()
+{
+  while (is_at_short_line()) {
+    advance_till_next_sha1();
+  }
+}
+
+template <typename DataStorage, typename Key>
+void original_file_reader<DataStorage, Key>::advance_view(unsigned n)
 {
   m_buffer_view = std::string_view{ std::next(m_buffer_view.data(), n), m_buffer_view.size() - n };
 }
 
-template <typename DataStorage>
-void original_file_reader<DataStorage>::advance_till_next_sha1()
+template <typename DataStorage, typename Key>
+void original_file_reader<DataStorage, Key>::advance_till_next_sha1()
 {
-  const auto new_line_pos = m_buffer_view.find('\n');
-  if (new_line_pos == std::string_view::npos) {
+  const auto pos = static_cast<uint32_t>(m_buffer_view.data() -
+                                         reinterpret_cast<const char*>(m_buffer->data()));
+  while (m_next_new_line < m_new_lines_count && m_new_lines[m_next_new_line] < pos) {
+    ++m_next_new_line;
+  }
+
+  if (m_next_new_line == m_new_lines_count) {
     m_need_to_read_and_advance_till_next_sha1 = true;
     return;
   }
 
-  advance_view(new_line_pos + 1u);
+  advance_view(m_new_lines[m_next_new_line++] - pos + 1u);
 }
-template <typename DataStorage>
-void original_file_reader<DataStorage>::start_reader_thread()
+template <typename DataStorage, typename Key>
+void original_file_reader<DataStorage, Key>::start_reader_thread()
 {
   const auto fun = [this] {
     while (true) {
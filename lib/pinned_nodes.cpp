@@ -0,0 +1,71 @@
+#include "pinned_nodes.hpp"
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#endif
+
+namespace {
+bool lock_memory(const void* ptr, std::size_t size)
+{
+#ifdef _WIN32
+  return VirtualLock(const_cast<void*>(ptr), size) != 0;
+#else
+  return mlock(ptr, size) == 0;
+#endif
+}
+
+void unlock_memory(const void* ptr, std::size_t size)
+{
+#ifdef _WIN32
+  VirtualUnlock(const_cast<void*>(ptr), size);
+#else
+  munlock(ptr, size);
+#endif
+}
+}
+
+namespace okon {
+pinned_nodes::pinned_nodes(std::vector<uint8_t> bytes, uint64_t node_size)
+  : m_bytes{ std::move(bytes) }
+  , m_node_size{ node_size }
+{
+}
+
+pinned_nodes::~pinned_nodes()
+{
+  if (m_locked) {
+    unlock_memory(m_bytes.data(), m_bytes.size());
+  }
+}
+
+bool pinned_nodes::lock_in_memory()
+{
+  if (!m_locked && !m_bytes.empty()) {
+    m_locked = lock_memory(m_bytes.data(), m_bytes.size());
+  }
+
+  return m_locked || m_bytes.empty();
+}
+
+bool pinned_nodes::is_locked() const
+{
+  return m_locked;
+}
+
+uint64_t pinned_nodes::node_size() const
+{
+  return m_node_size;
+}
+
+uint64_t pinned_nodes::nodes_count() const
+{
+  return m_node_size == 0u ? 0u : m_bytes.size() / m_node_size;
+}
+
+uint64_t pinned_nodes::size_in_bytes() const
+{
+  return m_bytes.size();
+}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace okon {
+
+// Nodes of the same size, read into one contiguous block of memory that is kept for the lifetime
+// of the object. Lookups read them without locks, as nothing changes them. The block can be locked
+// in RAM, so it's never paged out.
+class pinned_nodes
+{
+public:
+  explicit pinned_nodes(std::vector<uint8_t> bytes, uint64_t node_size);
+  ~pinned_nodes();
+
+  pinned_nodes(const pinned_nodes&) = delete;
+  pinned_nodes& operator=(const pinned_nodes&) = delete;
+
+  // Locks the block in RAM (mlock). Returns false if it's not possible, e.g. the limit of locked
+  // memory (RLIMIT_MEMLOCK) is too low.
+  bool lock_in_memory();
+  bool is_locked() const;
+
+  const uint8_t* node(uint64_t index) const
+  {
+    return m_bytes.data() + index * m_node_size;
+  }
+
+  uint64_t node_size() const;
+  uint64_t nodes_count() const;
+  uint64_t size_in_bytes() const;
+
+private:
+  std::vector<uint8_t> m_bytes;
+  uint64_t m_node_size;
+  bool m_locked{ false };
+};
+}
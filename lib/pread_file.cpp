@@ -0,0 +1,121 @@
+#include "pread_file.hpp"
+
+#include <algorithm>
+#include <string>
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace okon {
+pread_file::pread_file(std::string_view path)
+{
+  const std::string null_terminated_path{ path };
+
+#ifdef _WIN32
+  const auto file =
+    CreateFileA(null_terminated_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+  m_file = file != INVALID_HANDLE_VALUE ? file : nullptr;
+#else
+  m_fd = open(null_terminated_path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+}
+
+pread_file::~pread_file()
+{
+#ifdef _WIN32
+  if (m_file != nullptr) {
+    CloseHandle(m_file);
+  }
+#else
+  if (m_fd >= 0) {
+    close(m_fd);
+  }
+#endif
+}
+
+bool pread_file::is_open() const
+{
+#ifdef _WIN32
+  return m_file != nullptr;
+#else
+  return m_fd >= 0;
+#endif
+}
+
+pread_file::size_type_t pread_file::read_at(pos_type_t offset, void* ptr, size_type_t size) const
+{
+  if (!is_open()) {
+    return 0u;
+  }
+
+  auto* data = static_cast<char*>(ptr);
+  size_type_t read_size{ 0u };
+
+  // A read can return less than requested, e.g. when it's interrupted, so it's continued till all
+  // the bytes are read or the end of the file is reached.
+  while (read_size < size) {
+    const auto pos = offset + read_size;
+
+#ifdef _WIN32
+    OVERLAPPED overlapped{};
+    overlapped.Offset = static_cast<DWORD>(pos);
+    overlapped.OffsetHigh = static_cast<DWORD>(pos >> 32u);
+
+    const auto to_read = static_cast<DWORD>(std::min<size_type_t>(size - read_size, 1u << 30u));
+    DWORD result{ 0u };
+    if (!ReadFile(m_file, data + read_size, to_read, &result, &overlapped) || result == 0u) {
+      break;
+    }
+#else
+    const auto result = pread(m_fd, data + read_size, size - read_size, static_cast<off_t>(pos));
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      break;
+    }
+#endif
+
+    read_size += static_cast<size_type_t>(result);
+  }
+
+  return read_size;
+}
+
+pread_file::size_type_t pread_file::read(void* ptr, size_type_t size)
+{
+  const auto read_size = read_at(m_pos, ptr, size);
+  m_pos += read_size;
+  return read_size;
+}
+
+void pread_file::seek_in(pos_type_t pos)
+{
+  m_pos = pos;
+}
+
+pread_file::pos_type_t pread_file::tell_in() const
+{
+  return m_pos;
+}
+
+pread_file::pos_type_t pread_file::total_size() const
+{
+#ifdef _WIN32
+  LARGE_INTEGER size{};
+  return is_open() && GetFileSizeEx(m_file, &size) ? static_cast<pos_type_t>(size.QuadPart) : 0u;
+#else
+  struct stat file_stat{};
+  return is_open() && fstat(m_fd, &file_stat) == 0 ? static_cast<pos_type_t>(file_stat.st_size)
+                                                    : 0u;
+#endif
+}
+}
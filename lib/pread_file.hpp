@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace okon {
+
+// Read-only file read with positional reads (pread), that don't share a file position. read_at()
+// can be called from many threads at once, so lookups in a tree of the file need no locking. The
+// sequential interface of fstream_wrapper (seek_in() then read()) is kept for reading headers and
+// loading keys, it needs to be used from one thread at a time.
+class pread_file
+{
+public:
+  using size_type_t = uint64_t;
+  using pos_type_t = uint64_t;
+
+  explicit pread_file(std::string_view path);
+  ~pread_file();
+
+  pread_file(const pread_file&) = delete;
+  pread_file& operator=(const pread_file&) = delete;
+
+  bool is_open() const;
+
+  // Reads size bytes at the offset. Returns the number of read bytes, less than size only at the
+  // end of the file or if the read failed.
+  size_type_t read_at(pos_type_t offset, void* ptr, size_type_t size) const;
+
+  size_type_t read(void* ptr, size_type_t size);
+  void seek_in(pos_type_t pos);
+  pos_type_t tell_in() const;
+  pos_type_t total_size() const;
+
+private:
+#ifdef _WIN32
+  void* m_file{ nullptr };
+#else
+  int m_fd{ -1 };
+#endif
+  pos_type_t m_pos{ 0u };
+};
+}
@@ -1,5 +1,9 @@
 #include "preparer.hpp"
 
+#include "btree_compactor.hpp"
+#include "checksums.hpp"
+#include "sorted_keys_merge.hpp"
+
 #include <algorithm>
 #include <atomic>
 #include <cstring>
@@ -11,37 +15,68 @@ namespace {
 constexpr auto k_sha1_buffer_max_size{ 1024u * 100u };
 constexpr auto k_file_chunk_size_to_read{ 1024u * 1024u };
 constexpr auto k_sorting_threads{ 3u };
+constexpr std::string_view k_intermediate_tree_file_name{ "btree" };
+constexpr auto k_tree_order{ 1024u };
 }
 
 namespace okon {
-preparer::preparer(std::string_view input_file_path, std::string_view working_directory_path,
-                   std::string_view output_file_path, progress_callback_t progress_callback)
-  : m_input_file_wrapper{ input_file_path }
-  , m_input_reader{ m_input_file_wrapper,
-                    /*buffer_size=*/k_file_chunk_size_to_read + k_text_sha1_length_for_simd,
-                    /*size_to_read_from_storage=*/k_file_chunk_size_to_read,
-                    /*number_of_buffers=*/4u }
+std::optional<fstream_wrapper> make_intermediate_tree_file(std::string_view working_directory_path,
+                                                           file_format format, uint32_t flags)
+{
+  if (format == file_format::legacy || (flags & file_flag_bplus_tree) != 0u) {
+    return std::nullopt;
+  }
+
+  auto path = std::string{ working_directory_path };
+  path += k_intermediate_tree_file_name;
+
+  return fstream_wrapper{ path, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary };
+}
+
+template <typename Key>
+basic_preparer<Key>::basic_preparer(std::vector<std::string_view> input_file_paths,
+                                    std::vector<std::string_view> prepared_file_paths,
+                                    std::string_view working_directory_path,
+                                    std::string_view output_file_path, file_format format,
+                                    compact_format_options compact_options,
+                                    progress_callback_t progress_callback)
+  : m_input_file_paths{ std::move(input_file_paths) }
+  , m_prepared_file_paths{ std::move(prepared_file_paths) }
   , m_intermediate_files{ working_directory_path, std::ios::in | std::ios::out | std::ios::trunc }
   , m_output_file_wrapper{ output_file_path }
-  , m_btree{ m_output_file_wrapper, /*order=*/1024u }
+  , m_format{ format }
+  , m_compact_options{ compact_options }
+  , m_intermediate_tree_file_wrapper{ make_intermediate_tree_file(working_directory_path, format,
+                                                                  compact_options.flags) }
   , m_sha1_buffers{ 256u }
   , m_sorted_files_ready_state{}
   , m_progress_callback{ std::move(progress_callback) }
 {
   m_sorted_files_ready_state.fill(false);
 
+  if (!builds_bplus_tree()) {
+    m_btree.emplace(tree_file(), k_tree_order);
+  }
+
   for (auto& buffer : m_sha1_buffers) {
     buffer.reserve(k_sha1_buffer_max_size);
   }
 }
 
-preparer::result preparer::prepare()
+template <typename Key>
+prepare_result basic_preparer<Key>::prepare()
 {
-  if (!m_input_reader.is_open()) {
-    return result::could_not_open_input_file;
+  for (const auto path : m_input_file_paths) {
+    if (!m_input_files.emplace_back(path, std::ios::in).is_open()) {
+      return result::could_not_open_input_file;
+    }
+  }
+
+  if (const auto opening_result = open_prepared_files(); opening_result != result::success) {
+    return opening_result;
   }
 
-  if (!m_intermediate_files.are_all_open()) {
+  if (!m_intermediate_files.are_all_open() || !tree_file().is_open()) {
     return result::could_not_open_intermediate_files;
   }
 
@@ -51,9 +86,28 @@ preparer::result preparer::prepare()
 
   report_progress(k_progress_unknown);
 
-  while (const auto sha1 = m_input_reader.next_sha1()) {
-    add_sha1_to_file(*sha1);
-    ++m_total_sha1_count;
+  for (auto& file : m_input_files) {
+    auto& reader = m_input_readers.emplace_back(
+      file,
+      /*buffer_size=*/k_file_chunk_size_to_read + k_text_sha1_length_for_simd,
+      /*size_to_read_from_storage=*/k_file_chunk_size_to_read,
+      /*number_of_buffers=*/4u);
+
+    std::array<const char*, k_text_keys_batch_size> texts;
+    std::array<Key, k_text_keys_batch_size> keys;
+
+    while (const auto count = reader.next_sha1s(texts.data(), k_text_keys_batch_size)) {
+      const auto valid_mask = text_keys_to_binary<Key>(texts.data(), count, keys.data());
+
+      for (auto i = 0u; i < count; ++i) {
+        if ((valid_mask >> i) & 1u) {
+          add_key_to_file(keys[i]);
+          ++m_total_sha1_count;
+        } else {
+          ++m_invalid_lines_count;
+        }
+      }
+    }
   }
 
   for (auto i = 0u; i < m_sha1_buffers.size(); ++i) {
@@ -64,15 +118,74 @@ preparer::result preparer::prepare()
   sort_files();
   m_writing_sorted_files_thread.join();
 
+  if (!m_prepared_files_are_sorted) {
+    return result::input_not_sorted;
+  }
+
   report_progress(100);
 
   return result::success;
 }
 
-void preparer::add_sha1_to_file(std::string_view sha1)
+template <typename Key>
+unsigned long long basic_preparer<Key>::keys_count() const
+{
+  return m_keys_count;
+}
+
+template <typename Key>
+unsigned long long basic_preparer<Key>::duplicates_count() const
+{
+  return m_duplicates_count;
+}
+
+template <typename Key>
+unsigned long long basic_preparer<Key>::invalid_lines_count() const
 {
-  const auto index = two_first_chars_to_byte(sha1.data());
-  m_sha1_buffers[index].emplace_back(text_sha1_to_binary(sha1.data()));
+  return m_invalid_lines_count;
+}
+
+template <typename Key>
+prepare_result basic_preparer<Key>::open_prepared_files()
+{
+  for (const auto path : m_prepared_file_paths) {
+    auto& file = m_prepared_files.emplace_back(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+      return result::could_not_open_input_file;
+    }
+
+    // Keys are copied as they are stored, so they can't be shorter than the output ones.
+    const auto header = read_file_header(file);
+    if (!is_supported(header) || header.key_size != sizeof(Key) ||
+        header.stored_key_size < output_stored_key_size()) {
+      return result::incompatible_input;
+    }
+
+    m_prepared_readers.emplace_back(file);
+  }
+
+  return result::success;
+}
+
+template <typename Key>
+uint32_t basic_preparer<Key>::output_stored_key_size() const
+{
+  return m_format == file_format::legacy ? sizeof(Key)
+                                         : stored_key_size_of<Key>(m_compact_options);
+}
+
+template <typename Key>
+bool basic_preparer<Key>::builds_bplus_tree() const
+{
+  return m_format == file_format::compact &&
+    (m_compact_options.flags & file_flag_bplus_tree) != 0u;
+}
+
+template <typename Key>
+void basic_preparer<Key>::add_key_to_file(const Key& key)
+{
+  const auto index = key[0];
+  m_sha1_buffers[index].push_back(key);
 
   if (m_sha1_buffers[index].size() >= k_sha1_buffer_max_size) {
     write_sha1_buffer(index);
@@ -80,19 +193,20 @@ void preparer::add_sha1_to_file(std::string_view sha1)
   }
 }
 
-void preparer::sort_files()
+template <typename Key>
+void basic_preparer<Key>::sort_files()
 {
-  const auto sort_pred = [](const sha1_t& lhs, const sha1_t& rhs) {
-    return std::memcmp(lhs.data(), rhs.data(), sizeof(sha1_t)) < 0;
+  const auto sort_pred = [](const Key& lhs, const Key& rhs) {
+    return std::memcmp(lhs.data(), rhs.data(), sizeof(Key)) < 0;
   };
 
   auto sorter = [sort_pred, this](unsigned start_index) {
-    std::vector<sha1_t> sha1s;
+    std::vector<Key> sha1s;
 
     for (auto i = start_index; i < k_intermediate_files_count; i += k_sorting_threads) {
       auto& file = *(std::next(m_intermediate_files.begin(), i));
       const std::streamsize file_size = file.tellp();
-      const auto sha1_count = file_size / sizeof(sha1_t);
+      const auto sha1_count = file_size / sizeof(Key);
       sha1s.resize(sha1_count);
       file.seekg(0);
       file.read(reinterpret_cast<char*>(&sha1s[0]), file_size);
@@ -120,47 +234,105 @@ void preparer::sort_files()
   }
 }
 
-void preparer::start_writing_sorted_files_thread()
+template <typename Key>
+void basic_preparer<Key>::start_writing_sorted_files_thread()
 {
   m_writing_sorted_files_thread = std::thread{ [this] {
-    std::vector<sha1_t> sha1s;
+    std::vector<next_key_function_t<Key>> sequences{ [this] { return next_sorted_key(); } };
+
+    for (auto& reader : m_prepared_readers) {
+      sequences.emplace_back([&reader] { return reader.next_key(); });
+    }
 
-    for (auto i = 0u; i < k_intermediate_files_count; ++i) {
-      {
-        std::unique_lock lock{ m_processing_sorted_files_mtx };
-        m_sorted_files_cvs[i].wait(lock, [i, this] { return m_sorted_files_ready_state[i]; });
+    // Copies of a key, e.g. from concatenated databases, are dropped here, before they reach the
+    // tree.
+    std::optional<merged_keys_count> merged_count;
+
+    if (builds_bplus_tree()) {
+      bplus_tree_builder<fstream_wrapper, Key> builder{ m_output_file_wrapper, k_tree_order,
+                                                        m_compact_options };
+      merged_count =
+        merge_sorted_keys<Key>(std::move(sequences), builder, output_stored_key_size());
+      builder.finalize_inserting();
+    } else {
+      merged_count =
+        merge_sorted_keys<Key>(std::move(sequences), *m_btree, output_stored_key_size());
+      m_btree->finalize_inserting();
+
+      if (m_format == file_format::compact) {
+        btree_compactor<fstream_wrapper, Key> compactor{ tree_file(), m_output_file_wrapper,
+                                                         m_compact_options };
+        compactor.compact();
       }
+    }
 
-      auto& file = m_intermediate_files[i];
+    append_checksums(m_output_file_wrapper);
 
-      file.seekp(0, std::ios::end);
-      const std::streamsize file_size = file.tellp();
-      const auto sha1_count = file_size / sizeof(sha1_t);
-      sha1s.resize(sha1_count);
-      file.seekg(0);
-      file.read(reinterpret_cast<char*>(&sha1s[0]), file_size);
+    // Only keys of a corrupted prepared file can be out of order.
+    m_prepared_files_are_sorted = merged_count.has_value();
+    if (merged_count) {
+      m_keys_count = merged_count->inserted;
+      m_duplicates_count = merged_count->duplicates;
+    }
+  } };
+}
 
-      for (const auto& sha1 : sha1s) {
-        m_btree.insert_sorted(sha1);
+template <typename Key>
+void basic_preparer<Key>::read_sorted_file(unsigned index)
+{
+  {
+    std::unique_lock lock{ m_processing_sorted_files_mtx };
+    m_sorted_files_cvs[index].wait(lock,
+                                   [index, this] { return m_sorted_files_ready_state[index]; });
+  }
 
-        ++m_sha1_written_to_tree_count;
-        const auto progress = 100 * m_sha1_written_to_tree_count / m_total_sha1_count;
-        report_progress(progress);
-      }
+  auto& file = m_intermediate_files[index];
+
+  file.seekp(0, std::ios::end);
+  const std::streamsize file_size = file.tellp();
+  const auto sha1_count = file_size / sizeof(Key);
+  m_sorted_keys.resize(sha1_count);
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(m_sorted_keys.data()), file_size);
+
+  m_sorted_keys_position = 0u;
+}
+
+template <typename Key>
+std::optional<Key> basic_preparer<Key>::next_sorted_key()
+{
+  while (m_sorted_keys_position == m_sorted_keys.size()) {
+    if (m_next_sorted_file_index == k_intermediate_files_count) {
+      return std::nullopt;
     }
 
-    m_btree.finalize_inserting();
-  } };
+    read_sorted_file(m_next_sorted_file_index++);
+  }
+
+  ++m_sha1_written_to_tree_count;
+  const auto progress = 100 * m_sha1_written_to_tree_count / m_total_sha1_count;
+  report_progress(progress);
+
+  return m_sorted_keys[m_sorted_keys_position++];
 }
 
-void preparer::write_sha1_buffer(unsigned buffer_index)
+template <typename Key>
+void basic_preparer<Key>::write_sha1_buffer(unsigned buffer_index)
 {
   auto& file = m_intermediate_files[buffer_index];
   file.write(reinterpret_cast<const char*>(m_sha1_buffers[buffer_index][0].data()),
-             sizeof(sha1_t) * m_sha1_buffers[buffer_index].size());
+             sizeof(Key) * m_sha1_buffers[buffer_index].size());
 }
 
-void preparer::report_progress(int progress)
+template <typename Key>
+fstream_wrapper& basic_preparer<Key>::tree_file()
+{
+  return m_intermediate_tree_file_wrapper ? *m_intermediate_tree_file_wrapper
+                                          : m_output_file_wrapper;
+}
+
+template <typename Key>
+void basic_preparer<Key>::report_progress(int progress)
 {
   if (m_last_reported_progress == progress) {
     return;
@@ -169,4 +341,8 @@ void preparer::report_progress(int progress)
   m_progress_callback(progress);
   m_last_reported_progress = progress;
 }
+
+template class basic_preparer<ntlm_t>;
+template class basic_preparer<sha1_t>;
+template class basic_preparer<sha256_t>;
 }
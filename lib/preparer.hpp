@@ -1,6 +1,10 @@
 #pragma once
 
+#include "bplus_tree_builder.hpp"
+#include "btree_compactor.hpp"
+#include "btree_keys_reader.hpp"
 #include "btree_sorted_keys_inserter.hpp"
+#include "file_header.hpp"
 #include "fstream_wrapper.hpp"
 #include "original_file_reader.hpp"
 #include "sha1_utils.hpp"
@@ -8,49 +12,108 @@
 
 #include <array>
 #include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <optional>
 #include <string_view>
+#include <vector>
 
 namespace okon {
 constexpr auto k_intermediate_files_count{ 256u };
 
-class preparer
+enum class prepare_result
 {
-public:
-  enum class result
-  {
-    success,
-    could_not_open_input_file,
-    could_not_open_intermediate_files,
-    could_not_open_output
-  };
+  success,
+  could_not_open_input_file,
+  could_not_open_intermediate_files,
+  could_not_open_output,
+  input_not_sorted,
+
+  // A prepared input file has keys of other width or stores less bytes of keys than the output.
+  incompatible_input
+};
 
+// Opens the file in the working directory that a legacy tree is built in, before it's rewritten to
+// the format. Returns std::nullopt for the legacy format and for B+ trees (file_flag_bplus_tree),
+// which are built directly in the output.
+std::optional<fstream_wrapper> make_intermediate_tree_file(std::string_view working_directory_path,
+                                                           file_format format, uint32_t flags);
+
+// Prepares a file of hashes of the Key type. Instantiated for ntlm_t, sha1_t and sha256_t.
+// Hashes of all the text input files are sorted together. The sorted hashes and the keys of all the
+// prepared input files are combined with a k-way merge, so the output is a single tree without
+// duplicates.
+template <typename Key>
+class basic_preparer
+{
+public:
+  using result = prepare_result;
   using progress_callback_t = std::function<void(int)>;
 
-  explicit preparer(std::string_view input_file_path, std::string_view working_directory_path,
-                    std::string_view output_file_path, progress_callback_t progress_callback);
+  explicit basic_preparer(std::vector<std::string_view> input_file_paths,
+                          std::vector<std::string_view> prepared_file_paths,
+                          std::string_view working_directory_path,
+                          std::string_view output_file_path, file_format format,
+                          compact_format_options compact_options,
+                          progress_callback_t progress_callback);
 
   result prepare();
 
+  // Number of keys stored in the output file.
+  unsigned long long keys_count() const;
+
+  // Number of input keys that weren't stored, because they are copies of other input keys. With
+  // truncated keys, also keys of the same fingerprint.
+  unsigned long long duplicates_count() const;
+
+  // Number of input lines that weren't stored, because they don't start with a hash.
+  unsigned long long invalid_lines_count() const;
+
+  // Number of bytes of every key stored in the output file. Less than the width of Key only for
+  // fingerprints of the compact format, the legacy one always stores whole keys.
+  uint32_t output_stored_key_size() const;
+
 private:
-  void add_sha1_to_file(std::string_view sha1);
+  result open_prepared_files();
+  bool builds_bplus_tree() const;
+
+  void add_key_to_file(const Key& key);
 
   void sort_files();
   void start_writing_sorted_files_thread();
+  void read_sorted_file(unsigned index);
+  std::optional<Key> next_sorted_key();
 
   void write_sha1_buffer(unsigned buffer_index);
 
+  fstream_wrapper& tree_file();
+
   void report_progress(int progress);
 
 private:
-  fstream_wrapper m_input_file_wrapper;
-  original_file_reader<fstream_wrapper> m_input_reader;
+  std::vector<std::string_view> m_input_file_paths;
+  std::vector<std::string_view> m_prepared_file_paths;
+
+  // Readers keep references to the files, so containers that never move their elements are used.
+  std::deque<fstream_wrapper> m_input_files;
+
+  // Reading threads of the readers may still be finishing after the last key has been read.
+  std::deque<original_file_reader<fstream_wrapper, Key>> m_input_readers;
+  std::deque<fstream_wrapper> m_prepared_files;
+  std::deque<btree_keys_reader<fstream_wrapper, Key>> m_prepared_readers;
+
   splitted_files m_intermediate_files;
   fstream_wrapper m_output_file_wrapper;
-  btree_sorted_keys_inserter<fstream_wrapper> m_btree;
-  std::vector<std::vector<sha1_t>> m_sha1_buffers;
+
+  // The inserter produces a tree of the legacy layout. If another format is requested, the tree
+  // is built in the working directory and rewritten to the output at the end. B+ trees are built
+  // by bplus_tree_builder directly in the output, without the inserter.
+  file_format m_format;
+  compact_format_options m_compact_options;
+  std::optional<fstream_wrapper> m_intermediate_tree_file_wrapper;
+  std::optional<btree_sorted_keys_inserter<fstream_wrapper, Key>> m_btree;
+  std::vector<std::vector<Key>> m_sha1_buffers;
 
   // This value should be kept in sync with okon_prepare_progress_special_value from okon.h
   static constexpr auto k_progress_unknown{ -1 };
@@ -60,10 +123,25 @@ private:
 
   unsigned long long m_total_sha1_count{};
   unsigned long long m_sha1_written_to_tree_count{};
+  unsigned long long m_keys_count{};
+  unsigned long long m_duplicates_count{};
+  unsigned long long m_invalid_lines_count{};
+  bool m_prepared_files_are_sorted{ true };
+
+  // The sorted intermediate file that keys are currently taken from, by next_sorted_key().
+  std::vector<Key> m_sorted_keys;
+  std::size_t m_sorted_keys_position{};
+  unsigned m_next_sorted_file_index{};
 
   std::mutex m_processing_sorted_files_mtx;
   std::array<std::condition_variable, k_intermediate_files_count> m_sorted_files_cvs;
   std::array<bool, k_intermediate_files_count> m_sorted_files_ready_state;
   std::thread m_writing_sorted_files_thread;
 };
+
+extern template class basic_preparer<ntlm_t>;
+extern template class basic_preparer<sha1_t>;
+extern template class basic_preparer<sha256_t>;
+
+using preparer = basic_preparer<sha1_t>;
 }
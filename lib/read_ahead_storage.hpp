@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace okon {
+
+// Read-only storage that reads the underlying one in big chunks, so reading many small nodes one
+// after another costs a few big sequential reads instead of a seek and a read per node. A couple
+// of chunks are kept, so jumping between the inner nodes and the leaves of a compact file doesn't
+// drop the chunk of leaves that is being read.
+template <typename DataStorage>
+class read_ahead_storage
+{
+public:
+  using size_type_t = uint64_t;
+
+  static constexpr size_type_t k_default_chunk_size{ 4u * 1024u * 1024u };
+
+  explicit read_ahead_storage(DataStorage& storage, size_type_t chunk_size = k_default_chunk_size,
+                              unsigned chunks_count = 2u);
+
+  size_type_t read(void* ptr, size_type_t size);
+  void seek_in(size_type_t pos);
+  size_type_t tell_in() const;
+
+private:
+  struct chunk
+  {
+    size_type_t offset{ 0u };
+    std::vector<uint8_t> data;
+    uint64_t last_use{ 0u };
+  };
+
+  // Returns the chunk with the byte at the position, or nullptr if it's beyond the storage.
+  const chunk* chunk_of(size_type_t pos);
+
+private:
+  DataStorage& m_storage;
+  size_type_t m_chunk_size;
+  std::vector<chunk> m_chunks;
+  size_type_t m_pos{ 0u };
+  uint64_t m_uses_count{ 0u };
+};
+
+template <typename DataStorage>
+read_ahead_storage<DataStorage>::read_ahead_storage(DataStorage& storage, size_type_t chunk_size,
+                                                    unsigned chunks_count)
+  : m_storage{ storage }
+  , m_chunk_size{ chunk_size }
+  , m_chunks(chunks_count)
+{
+}
+
+template <typename DataStorage>
+typename read_ahead_storage<DataStorage>::size_type_t read_ahead_storage<DataStorage>::read(
+  void* ptr, size_type_t size)
+{
+  auto* destination = static_cast<uint8_t*>(ptr);
+  size_type_t read_size{ 0u };
+
+  while (read_size < size) {
+    const auto* current = chunk_of(m_pos);
+    if (current == nullptr) {
+      break;
+    }
+
+    const auto offset_in_chunk = m_pos - current->offset;
+    const auto size_to_copy = std::min(size - read_size, current->data.size() - offset_in_chunk);
+    std::memcpy(destination + read_size, current->data.data() + offset_in_chunk, size_to_copy);
+
+    read_size += size_to_copy;
+    m_pos += size_to_copy;
+  }
+
+  return read_size;
+}
+
+template <typename DataStorage>
+void read_ahead_storage<DataStorage>::seek_in(size_type_t pos)
+{
+  m_pos = pos;
+}
+
+template <typename DataStorage>
+typename read_ahead_storage<DataStorage>::size_type_t read_ahead_storage<DataStorage>::tell_in()
+  const
+{
+  return m_pos;
+}
+
+template <typename DataStorage>
+const typename read_ahead_storage<DataStorage>::chunk* read_ahead_storage<DataStorage>::chunk_of(
+  size_type_t pos)
+{
+  ++m_uses_count;
+
+  const auto contains_pos = [pos](const chunk& c) {
+    return c.offset <= pos && pos < c.offset + c.data.size();
+  };
+
+  auto found = std::find_if(std::begin(m_chunks), std::end(m_chunks), contains_pos);
+
+  if (found == std::end(m_chunks)) {
+    const auto by_last_use = [](const chunk& lhs, const chunk& rhs) {
+      return lhs.last_use < rhs.last_use;
+    };
+    found = std::min_element(std::begin(m_chunks), std::end(m_chunks), by_last_use);
+
+    found->offset = pos - pos % m_chunk_size;
+    found->data.resize(m_chunk_size);
+    m_storage.seek_in(found->offset);
+    found->data.resize(m_storage.read(found->data.data(), m_chunk_size));
+
+    if (!contains_pos(*found)) {
+      return nullptr;
+    }
+  }
+
+  found->last_use = m_uses_count;
+  return &*found;
+}
+}
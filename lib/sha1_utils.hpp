@@ -13,8 +13,23 @@
 #endif
 
 namespace okon {
-using sha1_t = std::array<uint8_t, 20u>;
-constexpr auto k_text_sha1_length{ 40u };
+// Binary hash. Everything that stores or compares hashes is parametrized by the hash type, so the
+// width is known at compile time.
+template <std::size_t Size>
+using binary_key = std::array<uint8_t, Size>;
+
+using ntlm_t = binary_key<16u>;
+using sha1_t = binary_key<20u>;
+using sha256_t = binary_key<32u>;
+
+// Number of hex characters of a hash of the given type.
+template <typename Key>
+constexpr unsigned k_text_key_length{ 2u * std::tuple_size_v<Key> };
+
+constexpr auto k_text_sha1_length{ k_text_key_length<sha1_t> };
+
+// Number of bytes that need to be accessible from the beginning of a text hash to decode it with
+// SIMD. It's enough for every hash type.
 constexpr auto k_text_sha1_length_for_simd{ 64u };
 
 inline constexpr uint8_t char_to_index(char c)
@@ -50,21 +65,52 @@ inline constexpr uint8_t two_first_chars_to_byte(const char* cs)
 }
 
 namespace details {
+template <typename Key>
+Key string_key_to_binary(const char* key_text)
+{
+  Key key;
+
+  for (auto i = 0u; i < k_text_key_length<Key>; i += 2u) {
+    key[i / 2u] = two_first_chars_to_byte(key_text + i);
+  }
+
+  return key;
+}
+
 inline sha1_t string_sha1_to_binary(const char* sha1_text)
 {
-  okon::sha1_t sha1;
+  return string_key_to_binary<sha1_t>(sha1_text);
+}
+
+inline constexpr bool is_hex_char(char c)
+{
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+// Decodes the text key and checks that all its characters are hex digits.
+template <typename Key>
+bool decode_text_key(const char* key_text, Key& key)
+{
+  auto valid = true;
 
-  for (auto i = 0; i < 40; i += 2) {
-    sha1[i / 2] = two_first_chars_to_byte(sha1_text + i);
+  for (auto i = 0u; i < k_text_key_length<Key>; i += 2u) {
+    valid &= is_hex_char(key_text[i]) && is_hex_char(key_text[i + 1u]);
+    key[i / 2u] = two_first_chars_to_byte(key_text + i);
   }
 
-  return sha1;
+  return valid;
 }
 
 #ifdef OKON_USE_SIMD
+// Decodes the text key and checks that all its characters are hex digits. The whole text is
+// handled in one 64-byte vector: the nibbles are computed for all the characters at once, pairs of
+// them are joined in 16-bit lanes and packed to bytes, the first of which are the key.
 // The function assumes that ((const char*)text)[63] is accessible.
-inline sha1_t simd_string_sha1_to_binary(const void* text)
+template <typename Key>
+bool simd_decode_text_key(const void* text, Key& key)
 {
+  static_assert(k_text_key_length<Key> <= k_text_sha1_length_for_simd);
+
   const auto is_little_endian = [] {
     int value{ 1u };
     return *(char*)&value == 1;
@@ -74,42 +120,89 @@ inline sha1_t simd_string_sha1_to_binary(const void* text)
   vcl::Vec64uc v8;
   v8.load(text);
 
-  const auto is_alpha_mask = (v8 & 0b01000000u) != 0u;
+  // Characters out of the ranges wrap around to big values, so one comparison checks a range.
+  const auto digit = v8 - vcl::Vec64uc{ '0' };
+  const auto alpha = (v8 | vcl::Vec64uc{ 0x20u }) - vcl::Vec64uc{ 'a' };
+  const auto is_digit = digit < vcl::Vec64uc{ 10u };
+  const auto is_alpha = alpha < vcl::Vec64uc{ 6u };
 
-  v8 &= vcl::Vec64uc{ 0x0fu };
-  v8 = if_add(is_alpha_mask, v8, vcl::Vec64uc{ 9u });
+  constexpr auto length = k_text_key_length<Key>;
+  constexpr auto key_chars_mask = length == 64u ? ~uint64_t{ 0u } : (uint64_t{ 1u } << length) - 1u;
+  const auto valid = (to_bits(is_digit | is_alpha) & key_chars_mask) == key_chars_mask;
 
-  const auto shifted_8_to_left = v8 << 4u;
-  const auto shifted_16 = vcl::Vec32us{ shifted_8_to_left } << 8u;
+  v8 = select(is_digit, digit, alpha + vcl::Vec64uc{ 10u });
 
+  // The first character of a pair is in the lower byte of a lane, so the low byte of the result
+  // is (first << 4) | second.
   const auto v16 = vcl::Vec32us{ v8 };
-  const auto result = (v16 | shifted_16) >> 8u;
+  const auto pairs = (v16 << 4u) | (v16 >> 8u);
 
-  std::aligned_storage_t<sizeof(uint8_t) * 64u, 32u> result_storage;
-  auto result_storage_ptr = reinterpret_cast<uint8_t*>(&result_storage);
-  result.store_a(result_storage_ptr);
+  alignas(32) uint8_t bytes[32];
+  compress(pairs, pairs).get_low().store_a(bytes);
+  std::memcpy(key.data(), bytes, sizeof(Key));
 
-  sha1_t result_arr{};
-  auto result_storage_16_ptr = reinterpret_cast<uint16_t*>(result_storage_ptr);
-  for (auto i = 0; i < result_arr.size(); ++i) {
-    result_arr[i] = result_storage_16_ptr[i];
-  }
+  return valid;
+}
 
-  return result_arr;
+// The function assumes that ((const char*)text)[63] is accessible.
+template <typename Key>
+Key simd_string_key_to_binary(const void* text)
+{
+  Key key;
+  simd_decode_text_key(text, key);
+  return key;
+}
+
+// The function assumes that ((const char*)text)[63] is accessible.
+inline sha1_t simd_string_sha1_to_binary(const void* text)
+{
+  return simd_string_key_to_binary<sha1_t>(text);
 }
 #endif
 }
 
-inline sha1_t text_sha1_to_binary(const char* sha1_text)
+template <typename Key>
+Key text_key_to_binary(const char* key_text)
 {
 #ifdef OKON_USE_SIMD
-  return details::simd_string_sha1_to_binary(sha1_text);
+  return details::simd_string_key_to_binary<Key>(key_text);
 #else
-  return details::string_sha1_to_binary(sha1_text);
+  return details::string_key_to_binary<Key>(key_text);
 #endif
 }
 
-inline std::string binary_sha1_to_string(const sha1_t& sha1)
+// Maximal number of keys decoded by one call of text_keys_to_binary().
+constexpr auto k_text_keys_batch_size{ 64u };
+
+// Decodes count (at most k_text_keys_batch_size) text keys. Returns a mask with the i-th bit set if
+// texts[i] is a valid key, i.e. all its characters are hex digits. keys[i] of an invalid text is
+// unspecified. With OKON_USE_SIMD, ((const char*)texts[i])[63] needs to be accessible.
+template <typename Key>
+uint64_t text_keys_to_binary(const char* const* texts, unsigned count, Key* keys)
+{
+  assert(count <= k_text_keys_batch_size);
+
+  uint64_t valid_mask{ 0u };
+
+  for (auto i = 0u; i < count; ++i) {
+#ifdef OKON_USE_SIMD
+    const auto valid = details::simd_decode_text_key(texts[i], keys[i]);
+#else
+    const auto valid = details::decode_text_key(texts[i], keys[i]);
+#endif
+    valid_mask |= uint64_t{ valid } << i;
+  }
+
+  return valid_mask;
+}
+
+inline sha1_t text_sha1_to_binary(const char* sha1_text)
+{
+  return text_key_to_binary<sha1_t>(sha1_text);
+}
+
+template <std::size_t Size>
+std::string binary_sha1_to_string(const binary_key<Size>& sha1)
 {
   std::string result;
 
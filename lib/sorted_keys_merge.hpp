@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <vector>
+
+namespace okon {
+
+// Returns the next key of a sorted sequence, std::nullopt after the last one.
+template <typename Key>
+using next_key_function_t = std::function<std::optional<Key>()>;
+
+struct merged_keys_count
+{
+  unsigned long long inserted{ 0u };
+
+  // Keys that were skipped, because an equal one had been inserted already.
+  unsigned long long duplicates{ 0u };
+
+  bool operator==(const merged_keys_count& other) const
+  {
+    return inserted == other.inserted && duplicates == other.duplicates;
+  }
+};
+
+// Inserts the keys of all the sorted sequences into the inserter, in ascending order (k-way merge).
+// A key that is in more than one sequence, or more than once in one of them, is inserted once.
+// Only the first compared_size bytes of keys are compared while deduplicating, so keys of a file
+// with truncated keys are deduplicated by their fingerprints.
+// Returns the numbers of inserted and skipped keys, or std::nullopt if a sequence turns out not to
+// be sorted. Keys inserted till then stay in the inserter.
+template <typename Key, typename Inserter>
+std::optional<merged_keys_count> merge_sorted_keys(std::vector<next_key_function_t<Key>> sequences,
+                                                   Inserter& inserter,
+                                                   uint32_t compared_size = sizeof(Key))
+{
+  struct head
+  {
+    Key key;
+    std::size_t sequence_index;
+
+    // std::priority_queue puts the greatest element on top.
+    bool operator<(const head& other) const
+    {
+      return other.key < key || (other.key == key && other.sequence_index < sequence_index);
+    }
+  };
+
+  std::priority_queue<head> heads;
+
+  for (auto i = 0u; i < sequences.size(); ++i) {
+    if (auto key = sequences[i]()) {
+      heads.push(head{ *key, i });
+    }
+  }
+
+  std::optional<Key> last_inserted;
+  merged_keys_count count;
+
+  while (!heads.empty()) {
+    const auto current = heads.top();
+    heads.pop();
+
+    if (!last_inserted ||
+        std::memcmp(last_inserted->data(), current.key.data(), compared_size) < 0) {
+      inserter.insert_sorted(current.key);
+      last_inserted = current.key;
+      ++count.inserted;
+    } else {
+      ++count.duplicates;
+    }
+
+    if (auto next = sequences[current.sequence_index]()) {
+      if (*next < current.key) {
+        return std::nullopt;
+      }
+
+      heads.push(head{ *next, current.sequence_index });
+    }
+  }
+
+  return count;
+}
+}
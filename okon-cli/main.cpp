@@ -1,14 +1,29 @@
 #include <okon/okon.h>
 
 #include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
-using parsed_args_t = std::unordered_map<std::string_view, std::string_view>;
+// Some of the arguments can be passed many times.
+using parsed_args_t = std::unordered_multimap<std::string_view, std::string_view>;
+
+std::vector<const char*> all_values_of(const parsed_args_t& args, std::string_view name)
+{
+  std::vector<const char*> values;
+  const auto [begin, end] = args.equal_range(name);
+  std::transform(begin, end, std::back_inserter(values),
+                 [](const auto& arg) { return arg.second.data(); });
+  return values;
+}
 
 std::optional<parsed_args_t> parse_args(const std::vector<std::string_view>& args)
 {
@@ -22,7 +37,21 @@ std::optional<parsed_args_t> parse_args(const std::vector<std::string_view>& arg
 
   const auto accepted_args = { arg_metadata{ "--path" },    arg_metadata{ "--hash" },
                                arg_metadata{ "--prepare" }, arg_metadata{ "--wd" },
-                               arg_metadata{ "--output" },  arg_metadata{ "--help", 0u } };
+                               arg_metadata{ "--output" },  arg_metadata{ "--format" },
+                               arg_metadata{ "--compress-leaves", 0u },
+                               arg_metadata{ "--bplus-tree", 0u },
+                               arg_metadata{ "--node-summaries", 0u },
+                               arg_metadata{ "--fingerprint-size" },
+                               arg_metadata{ "--hash-type" },
+                               arg_metadata{ "--merge" },
+                               arg_metadata{ "--add-prepared" },
+                               arg_metadata{ "--range" },
+                               arg_metadata{ "--export" },
+                               arg_metadata{ "--export-format" },
+                               arg_metadata{ "--verify", 0u },
+                               arg_metadata{ "--stats", 0u },
+                               arg_metadata{ "--threads" },
+                               arg_metadata{ "--help", 0u } };
 
   const auto find_argument =
     [&accepted_args](std::string_view passed_argument) -> std::optional<arg_metadata> {
@@ -46,7 +75,7 @@ std::optional<parsed_args_t> parse_args(const std::vector<std::string_view>& arg
       return std::nullopt;
     }
 
-    result[args[i]] = args[i + metadata->expected_value_count];
+    result.emplace(args[i], args[i + metadata->expected_value_count]);
 
     i += metadata->expected_value_count + 1u;
   }
@@ -54,11 +83,28 @@ std::optional<parsed_args_t> parse_args(const std::vector<std::string_view>& arg
   return result;
 }
 
+void print_progress(void*, int progress)
+{
+  if (progress ==
+      okon_prepare_progress_special_value::okon_prepare_progress_special_value_unknown) {
+    std::cout << "Preparing... ";
+    std::cout.flush();
+  }
+  if (progress % 10 == 0) {
+    std::cout << progress << "% ";
+    std::cout.flush();
+  }
+  if (progress == 100) {
+    std::cout << std::endl;
+  }
+}
+
 okon_prepare_result handle_prepare(const parsed_args_t& args)
 {
-  const auto found_prepare = args.find("--prepare");
-  if (found_prepare == std::cend(args)) {
-    std::cerr << "expected --prepare argument";
+  const auto input_file_paths = all_values_of(args, "--prepare");
+  const auto prepared_file_paths = all_values_of(args, "--add-prepared");
+  if (input_file_paths.empty() && prepared_file_paths.empty()) {
+    std::cerr << "expected --prepare or --add-prepared argument";
     return okon_prepare_result::okon_prepare_result_could_not_open_input_file;
   }
 
@@ -74,27 +120,129 @@ okon_prepare_result handle_prepare(const parsed_args_t& args)
     return okon_prepare_result::okon_prepare_result_could_not_open_output;
   }
 
-  const auto input_file_path = found_prepare->second;
   const auto working_directory_path = found_wd->second;
   const auto output_file_directory = found_output->second;
 
-  const auto progress = [](void*, int progress) {
-    if (progress ==
-        okon_prepare_progress_special_value::okon_prepare_progress_special_value_unknown) {
-      std::cout << "Preparing... ";
-      std::cout.flush();
+  okon_prepare_options options{};
+  options.format = okon_prepare_format::okon_prepare_format_compact;
+
+  const auto found_format = args.find("--format");
+  if (found_format != std::cend(args)) {
+    if (found_format->second == "compact") {
+      options.format = okon_prepare_format::okon_prepare_format_compact;
+    } else if (found_format->second == "legacy") {
+      options.format = okon_prepare_format::okon_prepare_format_legacy;
+    } else {
+      std::cerr << "unknown format: " << found_format->second.data() << '\n';
+      return okon_prepare_result::okon_prepare_result_unspecified_failure;
     }
-    if (progress % 10 == 0) {
-      std::cout << progress << "% ";
-      std::cout.flush();
+  }
+
+  auto key_size = 20u;
+
+  const auto found_hash_type = args.find("--hash-type");
+  if (found_hash_type != std::cend(args)) {
+    if (found_hash_type->second == "sha1") {
+      options.hash_type = okon_hash_type::okon_hash_type_sha1;
+    } else if (found_hash_type->second == "ntlm") {
+      options.hash_type = okon_hash_type::okon_hash_type_ntlm;
+      key_size = 16u;
+    } else if (found_hash_type->second == "sha256") {
+      options.hash_type = okon_hash_type::okon_hash_type_sha256;
+      key_size = 32u;
+    } else {
+      std::cerr << "unknown hash type: " << found_hash_type->second.data() << '\n';
+      return okon_prepare_result::okon_prepare_result_unspecified_failure;
     }
-    if (progress == 100) {
-      std::cout << std::endl;
+  }
+
+  if (args.find("--compress-leaves") != std::cend(args)) {
+    options.compress_leaves = 1;
+  }
+
+  if (args.find("--bplus-tree") != std::cend(args)) {
+    options.bplus_tree = 1;
+  }
+
+  if (args.find("--node-summaries") != std::cend(args)) {
+    options.node_summaries = 1;
+  }
+
+  const auto found_fingerprint_size = args.find("--fingerprint-size");
+  if (found_fingerprint_size != std::cend(args)) {
+    const auto value = found_fingerprint_size->second;
+    const auto [end, error] =
+      std::from_chars(value.data(), value.data() + value.size(), options.fingerprint_size);
+
+    if (error != std::errc{} || end != value.data() + value.size() ||
+        options.fingerprint_size < 1u || options.fingerprint_size >= key_size) {
+      std::cerr << "fingerprint size must be in range [1, " << key_size - 1u
+                << "]: " << value.data() << '\n';
+      return okon_prepare_result::okon_prepare_result_unspecified_failure;
     }
-  };
+  }
+
+  okon_prepare_stats stats{};
+  options.stats = &stats;
+
+  const auto result = okon_prepare_multiple(
+    input_file_paths.data(), static_cast<unsigned>(input_file_paths.size()),
+    prepared_file_paths.data(), static_cast<unsigned>(prepared_file_paths.size()),
+    working_directory_path.data(), output_file_directory.data(), &options, print_progress, nullptr);
+
+  if (result == okon_prepare_result::okon_prepare_result_incompatible_input) {
+    std::cerr << "prepared files to add need to have the same hash type and at least the same "
+                 "fingerprint size\n";
+  }
+
+  if (result != okon_prepare_result::okon_prepare_result_success) {
+    return result;
+  }
 
-  return okon_prepare(input_file_path.data(), working_directory_path.data(),
-                      output_file_directory.data(), progress, nullptr);
+  if (stats.duplicates_count > 0u) {
+    std::cout << "Duplicates removed: " << stats.duplicates_count << '\n';
+  }
+
+  if (stats.invalid_lines_count > 0u) {
+    std::cout << "Invalid lines skipped: " << stats.invalid_lines_count << '\n';
+  }
+
+  if (options.fingerprint_size > 0u) {
+    std::cout << "Expected false positive rate: " << stats.false_positive_rate << '\n';
+  }
+
+  return result;
+}
+
+okon_prepare_result handle_merge(const parsed_args_t& args)
+{
+  const auto found_path = args.find("--path");
+  if (found_path == std::cend(args)) {
+    std::cerr << "expected --path argument";
+    return okon_prepare_result::okon_prepare_result_could_not_open_input_file;
+  }
+
+  const auto found_wd = args.find("--wd");
+  if (found_wd == std::cend(args)) {
+    std::cerr << "expected --wd argument";
+    return okon_prepare_result::okon_prepare_result_could_not_open_intermediate_files;
+  }
+
+  const auto found_output = args.find("--output");
+  if (found_output == std::cend(args)) {
+    std::cerr << "expected --output argument";
+    return okon_prepare_result::okon_prepare_result_could_not_open_output;
+  }
+
+  const auto result =
+    okon_merge(found_path->second.data(), args.find("--merge")->second.data(),
+               found_wd->second.data(), found_output->second.data(), print_progress, nullptr);
+
+  if (result == okon_prepare_result::okon_prepare_result_input_not_sorted) {
+    std::cerr << "hashes to merge are not sorted\n";
+  }
+
+  return result;
 }
 
 int handle_check(const parsed_args_t& args)
@@ -111,9 +259,194 @@ int handle_check(const parsed_args_t& args)
     return -1;
   }
 
-  const auto file_path = found_path->second;
-  const auto hash = found_hash->second;
-  return okon_exists_text(hash.data(), file_path.data());
+  auto* handle = okon_open(found_path->second.data(), nullptr);
+  if (handle == nullptr) {
+    return okon_exists_result::okon_prepare_result_could_not_open_file;
+  }
+
+  // Length of the hash depends on the type of the file.
+  const auto hash_length = 2u * std::size_t{ okon_handle_key_size(handle) };
+  const auto is_hex = [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) != 0; };
+  if (found_hash->second.size() != hash_length ||
+      !std::all_of(std::cbegin(found_hash->second), std::cend(found_hash->second), is_hex)) {
+    std::cerr << "expected a hash of " << hash_length << " hex characters\n";
+    okon_close(handle);
+    return -1;
+  }
+
+  // Lookups may read up to 64 characters of the hash, whatever its length is.
+  auto hash = std::string{ found_hash->second };
+  hash.resize(std::max<std::size_t>(hash.size(), 64u), '0');
+
+  const auto result = okon_handle_exists_text(handle, hash.data());
+  okon_close(handle);
+
+  return result;
+}
+
+int handle_range(const parsed_args_t& args)
+{
+  const auto found_path = args.find("--path");
+  if (found_path == std::cend(args)) {
+    std::cerr << "expected --path argument";
+    return okon_exists_result::okon_prepare_result_could_not_open_file;
+  }
+
+  auto* handle = okon_open(found_path->second.data(), nullptr);
+  if (handle == nullptr) {
+    return okon_exists_result::okon_prepare_result_could_not_open_file;
+  }
+
+  struct range_printer
+  {
+    unsigned key_size;
+    std::size_t prefix_length;
+    std::string text;
+  };
+
+  const auto prefix = args.find("--range")->second;
+  range_printer printer{ okon_handle_key_size(handle), prefix.size(), {} };
+
+  // Like the HIBP range API, only suffixes of the found hashes are printed.
+  const auto print_suffix = [](void* user_data, const void* hash) {
+    auto& printer = *static_cast<range_printer*>(user_data);
+    const auto* bytes = static_cast<const uint8_t*>(hash);
+
+    printer.text.clear();
+    for (auto i = 0u; i < printer.key_size; ++i) {
+      printer.text += "0123456789ABCDEF"[bytes[i] >> 4u];
+      printer.text += "0123456789ABCDEF"[bytes[i] & 0xfu];
+    }
+
+    std::cout << std::string_view{ printer.text }.substr(
+                   std::min(printer.prefix_length, printer.text.size()))
+              << '\n';
+  };
+
+  okon_handle_for_each_with_prefix(handle, prefix.data(), static_cast<unsigned>(prefix.size()),
+                                   print_suffix, &printer);
+  okon_close(handle);
+
+  return 0;
+}
+
+int handle_export(const parsed_args_t& args)
+{
+  const auto found_path = args.find("--path");
+  if (found_path == std::cend(args)) {
+    std::cerr << "expected --path argument";
+    return okon_export_result::okon_export_result_could_not_open_input_file;
+  }
+
+  auto format = okon_export_format::okon_export_format_text;
+
+  const auto found_format = args.find("--export-format");
+  if (found_format != std::cend(args)) {
+    if (found_format->second == "binary") {
+      format = okon_export_format::okon_export_format_binary;
+    } else if (found_format->second != "text") {
+      std::cerr << "unknown export format: " << found_format->second.data() << '\n';
+      return -1;
+    }
+  }
+
+  unsigned long long exported_count{ 0u };
+  const auto result = okon_export(found_path->second.data(), args.find("--export")->second.data(),
+                                  format, &exported_count);
+
+  if (result == okon_export_result::okon_export_result_success) {
+    std::cout << "Exported hashes: " << exported_count << '\n';
+  }
+
+  return result;
+}
+
+int handle_stats(const parsed_args_t& args)
+{
+  const auto found_path = args.find("--path");
+  if (found_path == std::cend(args)) {
+    std::cerr << "expected --path argument";
+    return okon_exists_result::okon_prepare_result_could_not_open_file;
+  }
+
+  auto* handle = okon_open(found_path->second.data(), nullptr);
+  if (handle == nullptr) {
+    return okon_exists_result::okon_prepare_result_could_not_open_file;
+  }
+
+  okon_tree_stats stats{};
+  const auto result = okon_stats(handle, &stats);
+  okon_close(handle);
+
+  if (result == okon_stats_result::okon_stats_result_success) {
+    std::cout << "Hashes: " << stats.keys_count << '\n';
+  }
+
+  std::cout << "Nodes: " << stats.nodes_count << '\n'
+            << "Leaves: " << stats.leaf_nodes_count << '\n'
+            << "Order: " << stats.order << '\n';
+
+  if (result != okon_stats_result::okon_stats_result_success) {
+    std::cout << "The file has been prepared without the other stats\n";
+    return 0;
+  }
+
+  std::cout << "Height: " << stats.height << '\n';
+
+  const auto levels_count =
+    std::min<unsigned>(stats.height, okon_tree_stats_constants::okon_tree_stats_max_levels_count);
+  for (auto level = 0u; level < levels_count; ++level) {
+    std::cout << "Nodes of level " << level << ": " << stats.level_nodes_counts[level] << '\n';
+  }
+
+  return 0;
+}
+
+int handle_verify(const parsed_args_t& args)
+{
+  const auto found_path = args.find("--path");
+  if (found_path == std::cend(args)) {
+    std::cerr << "expected --path argument";
+    return okon_verify_result::okon_verify_result_could_not_open_file;
+  }
+
+  unsigned threads_count{ 0u };
+
+  const auto found_threads = args.find("--threads");
+  if (found_threads != std::cend(args)) {
+    const auto value = found_threads->second;
+    const auto [end, error] =
+      std::from_chars(value.data(), value.data() + value.size(), threads_count);
+
+    if (error != std::errc{} || end != value.data() + value.size()) {
+      std::cerr << "invalid number of threads: " << value.data() << '\n';
+      return -1;
+    }
+  }
+
+  const auto result = okon_verify(found_path->second.data(), threads_count);
+
+  switch (result) {
+    case okon_verify_result::okon_verify_result_ok:
+      std::cout << "OK\n";
+      break;
+    case okon_verify_result::okon_verify_result_no_checksums:
+      std::cout << "The file has no checksums\n";
+      break;
+    case okon_verify_result::okon_verify_result_corrupted_header:
+      std::cout << "Corrupted header\n";
+      break;
+    case okon_verify_result::okon_verify_result_truncated:
+      std::cout << "The file is truncated\n";
+      break;
+    case okon_verify_result::okon_verify_result_corrupted:
+      std::cout << "Corrupted\n";
+      break;
+    default:
+      break;
+  }
+
+  return result;
 }
 
 void print_help()
@@ -122,10 +455,42 @@ void print_help()
     << "To prepare a downloaded database:\n"
        "okon-cli --prepare path/to/downloaded/file.txt --wd path/to/working_directory "
        "--output path/to/prepared/file.okon\n"
+       "--prepare can be passed many times, hashes of all the files are stored in one file.\n"
+       "Optionally, --add-prepared path/to/prepared/file.okon can be passed (many times) to add\n"
+       "hashes of already prepared files. It doesn't need --prepare.\n"
+       "Optionally, --format compact|legacy can be passed. Default is compact.\n"
+       "Optionally, --hash-type sha1|ntlm|sha256 can be passed. Default is sha1. Hashes other\n"
+       "than sha1 are always prepared in the compact format.\n"
+       "Optionally, --compress-leaves can be passed to store common key prefixes of leaves once.\n"
+       "Optionally, --bplus-tree can be passed to store all hashes in leaves laid out in order,\n"
+       "so --range reads them sequentially.\n"
+       "Optionally, --node-summaries can be passed to store a summary of keys in every node, so\n"
+       "lookups search only a small part of a node.\n"
+       "Optionally, --fingerprint-size N can be passed to store only N first bytes of every hash.\n"
+       "It makes the file smaller, but lookups may report false positives. The expected false\n"
+       "positive rate is printed after the preparation.\n"
        "In case of an error, exit value is set to the error value.\n\n"
+       "To merge sorted hashes, e.g. a newer database, into a prepared file:\n"
+       "okon-cli --merge path/to/new/file.txt --path path/to/prepared/file.okon --wd "
+       "path/to/working_directory --output path/to/merged/file.okon\n"
+       "The merged file has the options of the prepared one.\n\n"
+       "To list hashes that start with a prefix, like the HIBP range API does:\n"
+       "okon-cli --path path/to/prepared/file.okon --range 21BD1\n"
+       "Suffixes of the found hashes are written to stdout, one per line.\n\n"
+       "To write all hashes of a prepared file to a file, in ascending order:\n"
+       "okon-cli --path path/to/prepared/file.okon --export path/to/output/file\n"
+       "Optionally, --export-format text|binary can be passed. Default is text, one hash per\n"
+       "line. binary writes the bytes of hashes one right after another.\n\n"
+       "To print the number of hashes and the shape of the tree of a prepared file:\n"
+       "okon-cli --path path/to/prepared/file.okon --stats\n\n"
+       "To check the integrity of a prepared file:\n"
+       "okon-cli --path path/to/prepared/file.okon --verify\n"
+       "Optionally, --threads N can be passed. Default is the number of hardware threads.\n"
+       "Exit value is 0 if the file is intact.\n\n"
        "To check whether a hash exists:\n"
        "okon-cli --path path/to/prepared/file.okon --hash "
        "0000000000000000000000000000000000000000\n"
+       "The hash needs to have as many hex characters as the hashes of the file.\n"
        "If the hash is present `okon-cli` will write `1` to stdout and set exit code to 1.\n"
        "If the hash is NOT present `okon-cli` will write `0` to stdout and set exit code to 0.\n"
        "In case of an error, exit value is set to the error value.";
@@ -152,7 +517,27 @@ int main(int argc, const char* argv[])
     }
   }
 
-  for (std::string_view argument : { "--prepare", "--wd", "--output" }) {
+  if (parsed_args->find("--merge") != std::cend(*parsed_args)) {
+    return handle_merge(*parsed_args);
+  }
+
+  if (parsed_args->find("--range") != std::cend(*parsed_args)) {
+    return handle_range(*parsed_args);
+  }
+
+  if (parsed_args->find("--export") != std::cend(*parsed_args)) {
+    return handle_export(*parsed_args);
+  }
+
+  if (parsed_args->find("--stats") != std::cend(*parsed_args)) {
+    return handle_stats(*parsed_args);
+  }
+
+  if (parsed_args->find("--verify") != std::cend(*parsed_args)) {
+    return handle_verify(*parsed_args);
+  }
+
+  for (std::string_view argument : { "--prepare", "--add-prepared", "--wd", "--output" }) {
     if (parsed_args->find(argument) != std::cend(*parsed_args)) {
       return handle_prepare(*parsed_args);
     }
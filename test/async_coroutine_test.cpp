@@ -0,0 +1,146 @@
+#include <okon/okon_coroutine.hpp>
+
+#include "sha1_utils.hpp"
+
+#include <gmock/gmock.h>
+
+#include <coroutine>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace okon::test {
+using ::testing::Eq;
+
+constexpr auto k_keys_count{ 300u };
+
+// Result of a lookup that hasn't been resumed yet.
+constexpr auto k_not_resumed{ okon_prepare_result_could_not_open_file };
+
+// Minimal coroutine type, started right away and destroyed when it's done.
+struct detached_task
+{
+  struct promise_type
+  {
+    detached_task get_return_object()
+    {
+      return {};
+    }
+
+    std::suspend_never initial_suspend() noexcept
+    {
+      return {};
+    }
+
+    std::suspend_never final_suspend() noexcept
+    {
+      return {};
+    }
+
+    void return_void()
+    {
+    }
+
+    void unhandled_exception()
+    {
+      std::terminate();
+    }
+  };
+};
+
+detached_task exists(okon_async* async, sha1_t key, okon_exists_result* result)
+{
+  *result = co_await async_exists(async, key.data());
+}
+
+sha1_t make_key(unsigned index)
+{
+  sha1_t key{};
+  for (auto i = 0u; i < key.size(); ++i) {
+    key[i] = static_cast<uint8_t>(i * 7u);
+  }
+
+  // The index is in the first bytes, so keys of different indices differ.
+  std::memcpy(key.data(), &index, sizeof(index));
+  return key;
+}
+
+class prepared_file
+{
+public:
+  prepared_file()
+    : m_directory{ std::filesystem::temp_directory_path() / "okon_async_coroutine_test" }
+  {
+    std::filesystem::create_directories(m_directory);
+
+    std::ofstream text{ text_path() };
+    for (auto i = 0u; i < k_keys_count; ++i) {
+      text << binary_sha1_to_string(make_key(i)) << ":1\n";
+    }
+  }
+
+  ~prepared_file()
+  {
+    std::filesystem::remove_all(m_directory);
+  }
+
+  std::string text_path() const
+  {
+    return (m_directory / "input.txt").string();
+  }
+
+  std::string path() const
+  {
+    return (m_directory / "prepared.okon").string();
+  }
+
+  std::string working_directory() const
+  {
+    // Intermediate files are named with this path as a prefix.
+    return (m_directory / "wd").string();
+  }
+
+private:
+  std::filesystem::path m_directory;
+};
+
+TEST(AsyncCoroutine, CoAwaitedLookups_AreResumedByPoll)
+{
+  const prepared_file file;
+  ASSERT_THAT(okon_prepare_with_options(file.text_path().c_str(), file.working_directory().c_str(),
+                                        file.path().c_str(), nullptr, nullptr, nullptr),
+              Eq(okon_prepare_result_success));
+
+  auto* handle = okon_open(file.path().c_str(), nullptr);
+  ASSERT_THAT(handle, ::testing::NotNull());
+  auto* async = okon_async_open(handle, /*queue_depth=*/8u);
+  ASSERT_THAT(async, ::testing::NotNull());
+
+  // Keys of even indices are stored, the others aren't.
+  std::vector<okon_exists_result> results(2u * k_keys_count, k_not_resumed);
+  for (auto i = 0u; i < results.size(); ++i) {
+    const auto key = i % 2u == 0u ? make_key(i / 2u) : make_key(k_keys_count + i);
+    exists(async, key, &results[i]);
+  }
+
+  // Coroutines are suspended till their lookups are polled.
+  EXPECT_THAT(std::count(std::begin(results), std::end(results), k_not_resumed),
+              Eq(static_cast<std::ptrdiff_t>(results.size())));
+
+  while (okon_async_in_flight(async) > 0u) {
+    okon_async_poll(async, /*wait=*/1);
+  }
+
+  for (auto i = 0u; i < results.size(); ++i) {
+    const auto expected =
+      i % 2u == 0u ? okon_exists_result_exists : okon_exists_result_doesnt_exist;
+    EXPECT_THAT(results[i], Eq(expected)) << i;
+  }
+
+  okon_async_close(async);
+  okon_close(handle);
+}
+}
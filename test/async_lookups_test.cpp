@@ -0,0 +1,181 @@
+#include "async_lookups.hpp"
+#include "btree.hpp"
+
+#include "btree_tests_utils.hpp"
+#include "memory_storage.hpp"
+
+#include <gmock/gmock.h>
+
+
+namespace okon::test {
+using ::testing::Eq;
+
+constexpr btree_node::order_t k_order{ 8u };
+
+struct result_callback
+{
+  void operator()(async_lookup_result result) const
+  {
+    *destination = result;
+  }
+
+  async_lookup_result* destination{ nullptr };
+};
+
+using async_lookups_t = async_lookups<btree<memory_storage>, result_callback>;
+
+std::vector<async_lookup_result> lookup_all(async_lookups_t& lookups,
+                                            const std::vector<sha1_t>& keys)
+{
+  std::vector<async_lookup_result> results(keys.size(), async_lookup_result::read_failed);
+
+  for (auto i = 0u; i < keys.size(); ++i) {
+    lookups.submit(keys[i], result_callback{ &results[i] });
+  }
+
+  while (lookups.in_flight_count() > 0u) {
+    lookups.poll(/*wait=*/true);
+  }
+
+  return results;
+}
+
+class AsyncLookupsTest : public ::testing::TestWithParam<async_backend>
+{
+};
+
+TEST_P(AsyncLookupsTest, Lookups_GiveTheSameResultsAsTree)
+{
+  const auto keys = make_random_keys(500u);
+  const auto absent_keys = make_random_keys(700u, /*seed=*/24u);
+
+  for (auto& storage : make_trees_of_all_layouts(keys, k_order)) {
+    const temp_file file{ storage.m_storage };
+    btree tree{ storage };
+    async_lookups_t lookups{ tree, file.path(), /*queue_depth=*/16u, GetParam() };
+    ASSERT_TRUE(lookups.is_open());
+
+    const auto found = lookup_all(lookups, keys);
+    for (auto i = 0u; i < keys.size(); ++i) {
+      EXPECT_THAT(found[i], Eq(async_lookup_result::found)) << i;
+    }
+
+    const auto absent = lookup_all(lookups, absent_keys);
+    for (auto i = 0u; i < absent_keys.size(); ++i) {
+      const auto expected = tree.contains(absent_keys[i]) ? async_lookup_result::found
+                                                          : async_lookup_result::not_found;
+      EXPECT_THAT(absent[i], Eq(expected)) << i;
+    }
+  }
+}
+
+TEST_P(AsyncLookupsTest, PinnedInnerNodes_OnlyLeavesAreRead)
+{
+  const auto keys = make_random_keys(500u);
+  auto trees = make_trees_of_all_layouts(keys, k_order);
+  auto& storage = trees[k_compact_compressed_leaves_tree];
+
+  const temp_file file{ storage.m_storage };
+  btree tree{ storage };
+  ASSERT_TRUE(tree.pin_inner_nodes(/*lock_in_memory=*/false));
+  async_lookups_t lookups{ tree, file.path(), /*queue_depth=*/16u, GetParam() };
+
+  // Every lookup needs at most one read, so it's done after one poll.
+  auto result = async_lookup_result::read_failed;
+  lookups.submit(keys[123], result_callback{ &result });
+  EXPECT_THAT(lookups.poll(/*wait=*/true), Eq(1u));
+  EXPECT_THAT(result, Eq(async_lookup_result::found));
+}
+
+TEST_P(AsyncLookupsTest, Callbacks_AreCalledOnlyFromPoll)
+{
+  const auto keys = make_random_keys(50u);
+  auto trees = make_trees_of_all_layouts(keys, k_order);
+  auto& storage = trees[k_compact_compressed_leaves_tree];
+
+  const temp_file file{ storage.m_storage };
+  btree tree{ storage };
+  ASSERT_TRUE(tree.pin_inner_nodes(/*lock_in_memory=*/false));
+  async_lookups_t lookups{ tree, file.path(), /*queue_depth=*/4u, GetParam() };
+
+  // Keys of the pinned inner nodes are found without reads, but their callbacks still wait for a
+  // poll.
+  std::vector<async_lookup_result> results(keys.size(), async_lookup_result::read_failed);
+  for (auto i = 0u; i < keys.size(); ++i) {
+    lookups.submit(keys[i], result_callback{ &results[i] });
+  }
+
+  EXPECT_THAT(std::count(std::begin(results), std::end(results), async_lookup_result::read_failed),
+              Eq(static_cast<std::ptrdiff_t>(keys.size())));
+  EXPECT_THAT(lookups.in_flight_count(), Eq(keys.size()));
+
+  while (lookups.in_flight_count() > 0u) {
+    lookups.poll(/*wait=*/true);
+  }
+
+  EXPECT_THAT(std::count(std::begin(results), std::end(results), async_lookup_result::found),
+              Eq(static_cast<std::ptrdiff_t>(keys.size())));
+}
+
+TEST_P(AsyncLookupsTest, ManyLookupsInFlight_MoreThanQueueDepth)
+{
+  const auto keys = make_random_keys(3000u);
+  auto trees = make_trees_of_all_layouts(keys, k_order);
+
+  const temp_file file{ trees[k_bplus_compressed_leaves_tree].m_storage };
+  btree tree{ trees[k_bplus_compressed_leaves_tree] };
+  async_lookups_t lookups{ tree, file.path(), /*queue_depth=*/8u, GetParam() };
+
+  const auto results = lookup_all(lookups, keys);
+  EXPECT_THAT(std::count(std::begin(results), std::end(results), async_lookup_result::found),
+              Eq(static_cast<std::ptrdiff_t>(keys.size())));
+  EXPECT_THAT(lookups.in_flight_count(), Eq(0u));
+  EXPECT_THAT(lookups.file().in_flight_count(), Eq(0u));
+  EXPECT_THAT(lookups.poll(/*wait=*/true), Eq(0u));
+}
+
+TEST_P(AsyncLookupsTest, Destruction_WithLookupsInFlight_DoesNotWaitForThemForever)
+{
+  const auto keys = make_random_keys(500u);
+  auto trees = make_trees_of_all_layouts(keys, k_order);
+
+  const temp_file file{ trees[k_legacy_tree].m_storage };
+  btree tree{ trees[k_legacy_tree] };
+  std::vector<async_lookup_result> results(keys.size(), async_lookup_result::read_failed);
+
+  {
+    // More lookups than the queue depth, so some of them wait for room in the queue.
+    async_lookups_t lookups{ tree, file.path(), /*queue_depth=*/4u, GetParam() };
+    for (auto i = 0u; i < keys.size(); ++i) {
+      lookups.submit(keys[i], result_callback{ &results[i] });
+    }
+
+    EXPECT_THAT(lookups.in_flight_count(), Eq(keys.size()));
+  }
+
+  // Callbacks of the lookups in flight are not called.
+  EXPECT_THAT(std::count(std::begin(results), std::end(results), async_lookup_result::read_failed),
+              Eq(static_cast<std::ptrdiff_t>(keys.size())));
+}
+
+TEST_P(AsyncLookupsTest, Destruction_AfterPartOfLookupsIsPolled_DoesNotWaitForThemForever)
+{
+  const auto keys = make_random_keys(500u);
+  auto trees = make_trees_of_all_layouts(keys, k_order);
+
+  const temp_file file{ trees[k_bplus_tree].m_storage };
+  btree tree{ trees[k_bplus_tree] };
+  std::vector<async_lookup_result> results(keys.size(), async_lookup_result::read_failed);
+
+  async_lookups_t lookups{ tree, file.path(), /*queue_depth=*/4u, GetParam() };
+  for (auto i = 0u; i < keys.size(); ++i) {
+    lookups.submit(keys[i], result_callback{ &results[i] });
+  }
+
+  lookups.poll(/*wait=*/true);
+  EXPECT_THAT(lookups.in_flight_count(), ::testing::Gt(0u));
+}
+
+INSTANTIATE_TEST_SUITE_P(AsyncLookups, AsyncLookupsTest,
+                         ::testing::Values(async_backend::automatic, async_backend::threads));
+}
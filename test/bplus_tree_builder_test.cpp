@@ -0,0 +1,130 @@
+#include "bplus_tree_builder.hpp"
+#include "btree.hpp"
+#include "btree_keys_reader.hpp"
+
+#include "btree_tests_utils.hpp"
+#include "memory_storage.hpp"
+
+#include <gmock/gmock.h>
+
+#include <numeric>
+
+namespace okon::test {
+using ::testing::ElementsAreArray;
+using ::testing::Eq;
+using ::testing::Lt;
+
+sha1_t make_sha1(unsigned value)
+{
+  sha1_t sha1{};
+  sha1[0] = static_cast<uint8_t>(value >> 8u);
+  sha1[1] = static_cast<uint8_t>(value);
+  sha1[19] = 1u;
+  return sha1;
+}
+
+memory_storage make_bplus_tree(unsigned keys_count, btree_node::order_t order,
+                               compact_format_options options = {})
+{
+  memory_storage storage;
+  bplus_tree_builder builder{ storage, order, options };
+
+  for (auto i = 0u; i < keys_count; ++i) {
+    builder.insert_sorted(make_sha1(2u * i));
+  }
+
+  builder.finalize_inserting();
+  return storage;
+}
+
+class BplusTreeBuilderTest
+  : public ::testing::TestWithParam<std::tuple<unsigned, compact_format_options>>
+{
+};
+
+TEST_P(BplusTreeBuilderTest, Build_TreeContainsAllTheKeys)
+{
+  const auto [keys_count, options] = GetParam();
+  auto storage = make_bplus_tree(keys_count, k_test_order_value, options);
+
+  btree tree{ storage };
+
+  for (auto i = 0u; i < keys_count; ++i) {
+    EXPECT_TRUE(tree.contains(make_sha1(2u * i))) << i;
+    EXPECT_FALSE(tree.contains(make_sha1(2u * i + 1u))) << i;
+  }
+}
+
+TEST_P(BplusTreeBuilderTest, Build_KeysReaderReturnsAllKeysOnceInOrder)
+{
+  const auto [keys_count, options] = GetParam();
+  auto storage = make_bplus_tree(keys_count, k_test_order_value, options);
+
+  // Truncated keys are read zero padded.
+  const auto stored_key_size = stored_key_size_of<sha1_t>(options);
+  std::vector<sha1_t> expected;
+  for (auto i = 0u; i < keys_count; ++i) {
+    auto key = make_sha1(2u * i);
+    std::fill(std::next(key.begin(), stored_key_size), key.end(), uint8_t{ 0u });
+    expected.push_back(key);
+  }
+
+  btree_keys_reader reader{ storage };
+  std::vector<sha1_t> keys;
+  while (const auto key = reader.next_key()) {
+    keys.push_back(*key);
+  }
+
+  EXPECT_THAT(keys, ElementsAreArray(expected));
+}
+
+TEST_P(BplusTreeBuilderTest, Build_WritesStatsOfTheTree)
+{
+  const auto [keys_count, options] = GetParam();
+  auto storage = make_bplus_tree(keys_count, k_test_order_value, options);
+
+  const auto header = read_file_header(storage);
+  EXPECT_THAT(header.keys_count, Eq(keys_count));
+  ASSERT_THAT(header.height, Lt(file_header::k_max_levels_in_header));
+  EXPECT_THAT(header.level_nodes_counts[0], Eq(1u));
+  EXPECT_THAT(header.level_nodes_counts[header.height - 1u], Eq(header.leaf_nodes_count));
+  EXPECT_THAT(header.level_nodes_counts[header.height], Eq(0u));
+
+  const auto nodes_count = std::accumulate(std::begin(header.level_nodes_counts),
+                                           std::end(header.level_nodes_counts), 0u);
+  EXPECT_THAT(nodes_count, Eq(header.inner_nodes_count + header.leaf_nodes_count));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  BplusTreeBuilder, BplusTreeBuilderTest,
+  ::testing::Combine(::testing::Values(0u, 1u, 2u, 3u, 9u, 10u, 26u, 50u, 2000u),
+                     ::testing::Values(compact_format_options{},
+                                       compact_format_options{ file_flag_prefix_compressed_leaves },
+                                       compact_format_options{ 0u, /*stored_key_size=*/8u })));
+
+TEST(BplusTreeBuilder, Build_WritesLeavesBeforeInnerNodes)
+{
+  // Three full leaves and a root with two separators.
+  auto storage = make_bplus_tree(/*keys_count=*/6u, k_test_order_value);
+
+  const auto header = read_file_header(storage);
+  EXPECT_TRUE(header.has_flag(file_flag_bplus_tree));
+  EXPECT_THAT(header.leaf_nodes_count, Eq(3u));
+  EXPECT_THAT(header.inner_nodes_count, Eq(1u));
+  EXPECT_THAT(header.root_ptr, Eq(0u));
+  EXPECT_THAT(header.keys_count, Eq(6u));
+  EXPECT_THAT(header.height, Eq(2u));
+
+  const auto leaf_size = btree_node::compact_leaf_binary_size(k_test_order_value);
+  EXPECT_THAT(header.leaves_size, Eq(3u * leaf_size));
+  EXPECT_THAT(storage.m_storage.size(),
+              Eq(header.header_size + header.leaves_size +
+                 btree_node::compact_inner_binary_size(k_test_order_value)));
+
+  // The second leaf starts with the third key.
+  sha1_t key;
+  storage.seek_in(header.header_size + leaf_size + node_view::k_keys_count_size);
+  storage.read(key.data(), sizeof(key));
+  EXPECT_THAT(key, Eq(make_sha1(4u)));
+}
+}
@@ -0,0 +1,228 @@
+#include "btree.hpp"
+#include "btree_compactor.hpp"
+#include "btree_sorted_keys_inserter.hpp"
+
+#include "btree_tests_utils.hpp"
+#include "memory_storage.hpp"
+
+#include <gmock/gmock.h>
+
+#include <numeric>
+
+namespace okon::test {
+using ::testing::DoubleNear;
+using ::testing::Eq;
+using ::testing::Lt;
+
+template <typename Key>
+Key make_key(unsigned value)
+{
+  auto key = Key{};
+  key[0] = static_cast<uint8_t>(value >> 8u);
+  key[1] = static_cast<uint8_t>(value);
+  key.back() = 1u;
+  return key;
+}
+
+template <typename Key>
+memory_storage make_legacy_tree_of(unsigned keys_count, btree_node::order_t order)
+{
+  memory_storage storage;
+  btree_sorted_keys_inserter<memory_storage, Key> inserter{ storage, order };
+
+  for (auto i = 0u; i < keys_count; ++i) {
+    inserter.insert_sorted(make_key<Key>(2u * i));
+  }
+
+  inserter.finalize_inserting();
+  return storage;
+}
+
+sha1_t make_sha1(unsigned value)
+{
+  return make_key<sha1_t>(value);
+}
+
+memory_storage make_legacy_tree(unsigned keys_count, btree_node::order_t order)
+{
+  return make_legacy_tree_of<sha1_t>(keys_count, order);
+}
+
+class BtreeCompactorTest
+  : public ::testing::TestWithParam<std::tuple<unsigned, compact_format_options>>
+{
+};
+
+TEST_P(BtreeCompactorTest, Compact_CompactTreeContainsTheSameKeys)
+{
+  const auto [keys_count, options] = GetParam();
+
+  auto legacy = make_legacy_tree(keys_count, k_test_order_value);
+  memory_storage compact;
+  btree_compactor{ legacy, compact, options }.compact();
+
+  btree tree{ compact };
+
+  for (auto i = 0u; i < keys_count; ++i) {
+    EXPECT_TRUE(tree.contains(make_sha1(2u * i))) << i;
+    EXPECT_FALSE(tree.contains(make_sha1(2u * i + 1u))) << i;
+  }
+
+  sha1_t greatest_sha1;
+  greatest_sha1.fill(0xffu);
+  EXPECT_FALSE(tree.contains(greatest_sha1));
+}
+
+TEST_P(BtreeCompactorTest, Compact_WritesStatsOfTheTree)
+{
+  const auto [keys_count, options] = GetParam();
+
+  auto legacy = make_legacy_tree(keys_count, k_test_order_value);
+  memory_storage compact;
+  btree_compactor{ legacy, compact, options }.compact();
+
+  const auto header = read_file_header(compact);
+  EXPECT_THAT(header.keys_count, Eq(keys_count));
+  ASSERT_THAT(header.height, Lt(file_header::k_max_levels_in_header));
+  EXPECT_THAT(header.level_nodes_counts[0], Eq(1u));
+  EXPECT_THAT(header.level_nodes_counts[header.height - 1u], Eq(header.leaf_nodes_count));
+  EXPECT_THAT(header.level_nodes_counts[header.height], Eq(0u));
+
+  const auto nodes_count = std::accumulate(std::begin(header.level_nodes_counts),
+                                           std::end(header.level_nodes_counts), 0u);
+  EXPECT_THAT(nodes_count, Eq(header.inner_nodes_count + header.leaf_nodes_count));
+}
+
+TEST_P(BtreeCompactorTest, Compact_CompactTreeIsSmaller)
+{
+  const auto [keys_count, options] = GetParam();
+
+  auto legacy = make_legacy_tree(keys_count, /*order=*/16u);
+  memory_storage compact;
+  btree_compactor{ legacy, compact, options }.compact();
+
+  // The compact header describes the tree, so for a couple of keys it outweighs the saved bytes.
+  const auto compact_tree_size = compact.m_storage.size() - read_file_header(compact).header_size;
+  const auto legacy_tree_size = legacy.m_storage.size() - file_header::k_legacy_header_size;
+  EXPECT_THAT(compact_tree_size, Lt(legacy_tree_size));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  BtreeCompactor, BtreeCompactorTest,
+  ::testing::Combine(::testing::Values(1u, 2u, 3u, 9u, 10u, 26u, 50u),
+                     ::testing::Values(compact_format_options{},
+                                       compact_format_options{ file_flag_prefix_compressed_leaves },
+                                       compact_format_options{ 0u, /*stored_key_size=*/8u },
+                                       compact_format_options{ file_flag_prefix_compressed_leaves,
+                                                               /*stored_key_size=*/8u })));
+
+TEST(BtreeCompactor, Compact_WritesHeaderWithNodesCount)
+{
+  // Tree of height 2: root and two leaves.
+  auto legacy = make_legacy_tree(/*keys_count=*/5u, k_test_order_value);
+  memory_storage compact;
+  btree_compactor{ legacy, compact }.compact();
+
+  const auto header = read_file_header(compact);
+  EXPECT_THAT(header.format, Eq(file_format::compact));
+  EXPECT_THAT(header.order, Eq(k_test_order_value));
+  EXPECT_THAT(header.root_ptr, Eq(0u));
+  EXPECT_THAT(header.inner_nodes_count, Eq(1u));
+  EXPECT_THAT(header.leaf_nodes_count, Eq(2u));
+  EXPECT_THAT(header.height, Eq(2u));
+  EXPECT_THAT(header.level_nodes_counts[0], Eq(1u));
+  EXPECT_THAT(header.level_nodes_counts[1], Eq(2u));
+
+  const auto expected_size = header.header_size +
+    btree_node::compact_inner_binary_size(k_test_order_value) +
+    2u * btree_node::compact_leaf_binary_size(k_test_order_value);
+  EXPECT_THAT(compact.m_storage.size(), Eq(expected_size));
+}
+
+TEST(BtreeCompactor, Compact_RootIsLeaf_RootPointsToFirstLeaf)
+{
+  auto legacy = make_legacy_tree(/*keys_count=*/1u, k_test_order_value);
+  memory_storage compact;
+  btree_compactor{ legacy, compact }.compact();
+
+  const auto header = read_file_header(compact);
+  EXPECT_THAT(header.root_ptr, Eq(btree_node::k_leaf_pointer_flag));
+  EXPECT_THAT(header.inner_nodes_count, Eq(0u));
+  EXPECT_THAT(header.leaf_nodes_count, Eq(1u));
+}
+
+TEST(BtreeCompactor, Compact_PrefixCompressedLeaves_WritesFlagAndIsSmallerThanCompact)
+{
+  auto legacy = make_legacy_tree(/*keys_count=*/50u, /*order=*/16u);
+  memory_storage compact;
+  btree_compactor{ legacy, compact }.compact();
+  memory_storage compressed;
+  btree_compactor{ legacy, compressed, { file_flag_prefix_compressed_leaves } }.compact();
+
+  const auto header = read_file_header(compressed);
+  EXPECT_TRUE(header.has_flag(file_flag_prefix_compressed_leaves));
+  EXPECT_THAT(compressed.m_storage.size(), Lt(compact.m_storage.size()));
+}
+
+TEST(BtreeCompactor, Compact_TruncatedKeys_FindsKeysOfTheSameFingerprint)
+{
+  auto legacy = make_legacy_tree(/*keys_count=*/50u, k_test_order_value);
+  memory_storage compact;
+  btree_compactor{ legacy, compact, { 0u, /*stored_key_size=*/1u } }.compact();
+
+  EXPECT_THAT(read_file_header(compact).stored_key_size, Eq(1u));
+
+  // The first byte of all the keys is zero.
+  btree tree{ compact };
+  auto sha1 = make_sha1(1000u);
+  sha1[0] = 0u;
+  EXPECT_TRUE(tree.contains(sha1));
+
+  sha1[0] = 1u;
+  EXPECT_FALSE(tree.contains(sha1));
+}
+
+template <typename Key>
+class BtreeCompactorKeyTypeTest : public ::testing::Test
+{
+};
+
+using key_types = ::testing::Types<ntlm_t, sha256_t>;
+TYPED_TEST_SUITE(BtreeCompactorKeyTypeTest, key_types);
+
+TYPED_TEST(BtreeCompactorKeyTypeTest, Compact_CompactTreeContainsTheSameKeys)
+{
+  using key_t = TypeParam;
+  constexpr auto keys_count = 50u;
+
+  auto legacy = make_legacy_tree_of<key_t>(keys_count, k_test_order_value);
+
+  for (const auto options : { compact_format_options{},
+                              compact_format_options{ file_flag_prefix_compressed_leaves } }) {
+    memory_storage compact;
+    btree_compactor<memory_storage, key_t>{ legacy, compact, options }.compact();
+
+    const auto header = read_file_header(compact);
+    EXPECT_THAT(header.key_size, Eq(sizeof(key_t)));
+    EXPECT_THAT(header.stored_key_size, Eq(sizeof(key_t)));
+
+    btree<memory_storage, key_t> tree{ compact };
+
+    for (auto i = 0u; i < keys_count; ++i) {
+      EXPECT_TRUE(tree.contains(make_key<key_t>(2u * i))) << i;
+      EXPECT_FALSE(tree.contains(make_key<key_t>(2u * i + 1u))) << i;
+    }
+  }
+}
+
+TEST(BtreeCompactor, ExpectedFalsePositiveRate)
+{
+  const auto key_size = uint32_t{ sizeof(sha1_t) };
+
+  EXPECT_THAT(expected_false_positive_rate(1000u, key_size, key_size), Eq(0.0));
+  EXPECT_THAT(expected_false_positive_rate(1u, 1u, key_size), DoubleNear(1.0 / 256.0, 1e-12));
+  EXPECT_THAT(expected_false_positive_rate(600'000'000u, 8u, key_size),
+              DoubleNear(3.25e-11, 1e-13));
+  EXPECT_THAT(expected_false_positive_rate(1000u, 16u, sizeof(ntlm_t)), Eq(0.0));
+}
+}
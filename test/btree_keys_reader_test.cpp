@@ -0,0 +1,96 @@
+#include "btree_compactor.hpp"
+#include "btree_keys_reader.hpp"
+#include "btree_sorted_keys_inserter.hpp"
+
+#include "btree_tests_utils.hpp"
+#include "memory_storage.hpp"
+
+#include <gmock/gmock.h>
+
+namespace okon::test {
+using ::testing::ElementsAreArray;
+using ::testing::Eq;
+
+std::vector<sha1_t> make_sorted_sha1s(unsigned count)
+{
+  std::vector<sha1_t> sha1s(count);
+
+  for (auto i = 0u; i < count; ++i) {
+    sha1s[i][0] = static_cast<uint8_t>(i >> 8u);
+    sha1s[i][1] = static_cast<uint8_t>(i);
+    sha1s[i][19] = 1u;
+  }
+
+  return sha1s;
+}
+
+memory_storage make_legacy_tree(const std::vector<sha1_t>& sha1s)
+{
+  memory_storage storage;
+  btree_sorted_keys_inserter inserter{ storage, k_test_order_value };
+
+  for (const auto& sha1 : sha1s) {
+    inserter.insert_sorted(sha1);
+  }
+
+  inserter.finalize_inserting();
+  return storage;
+}
+
+std::vector<sha1_t> read_all_keys(memory_storage& storage)
+{
+  btree_keys_reader reader{ storage };
+  std::vector<sha1_t> keys;
+
+  while (const auto key = reader.next_key()) {
+    keys.push_back(*key);
+  }
+
+  return keys;
+}
+
+class BtreeKeysReaderTest : public ::testing::TestWithParam<unsigned>
+{
+};
+
+TEST_P(BtreeKeysReaderTest, NextKey_LegacyTree_ReturnsAllKeysInOrder)
+{
+  const auto sha1s = make_sorted_sha1s(GetParam());
+  auto legacy = make_legacy_tree(sha1s);
+
+  EXPECT_THAT(read_all_keys(legacy), ElementsAreArray(sha1s));
+}
+
+TEST_P(BtreeKeysReaderTest, NextKey_CompactTree_ReturnsAllKeysInOrder)
+{
+  const auto sha1s = make_sorted_sha1s(GetParam());
+  auto legacy = make_legacy_tree(sha1s);
+
+  for (const auto flags : { 0u, uint32_t{ file_flag_prefix_compressed_leaves } }) {
+    memory_storage compact;
+    btree_compactor{ legacy, compact, { flags } }.compact();
+
+    EXPECT_THAT(read_all_keys(compact), ElementsAreArray(sha1s)) << flags;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(BtreeKeysReader, BtreeKeysReaderTest,
+                         ::testing::Values(0u, 1u, 2u, 3u, 9u, 10u, 26u, 50u));
+
+TEST(BtreeKeysReader, NextKey_TruncatedKeys_ReturnsZeroPaddedFingerprints)
+{
+  const auto sha1s = make_sorted_sha1s(/*count=*/10u);
+  auto legacy = make_legacy_tree(sha1s);
+  memory_storage compact;
+  btree_compactor{ legacy, compact, { 0u, /*stored_key_size=*/2u } }.compact();
+
+  const auto keys = read_all_keys(compact);
+  ASSERT_THAT(keys.size(), Eq(sha1s.size()));
+
+  for (auto i = 0u; i < keys.size(); ++i) {
+    auto expected = sha1s[i];
+    expected[19] = 0u;
+    EXPECT_THAT(keys[i], Eq(expected)) << i;
+  }
+}
+}
@@ -1,8 +1,21 @@
+#include "bplus_tree_builder.hpp"
 #include "btree.hpp"
+#include "btree_compactor.hpp"
+#include "btree_sorted_keys_inserter.hpp"
 #include "btree_tests_utils.hpp"
 #include "memory_storage.hpp"
 
+#include <gmock/gmock.h>
+
+#include <random>
+
 namespace okon::test {
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+using ::testing::IsNull;
+using ::testing::NotNull;
 TEST(Btree, Contains_RootWithoutKey_ReturnsFalse)
 {
   const std::vector<btree_node> nodes = { make_node(
@@ -181,4 +194,194 @@ TEST(Btree, Contains_KeyInNonLeafChildOfRoot_ReturnsTrue)
     tree.contains(details::string_sha1_to_binary("E000000000000000000000000000000000000000"));
   EXPECT_TRUE(result);
 }
+
+TEST(Btree, Contains_WithNodeCache_SecondLookupDoesNotReadStorage)
+{
+  const std::vector<btree_node> nodes = {
+    make_node(
+      /*is_leaf=*/false, /*keys_count=*/1u, { 1u, 2u, btree_node::k_unused_pointer },
+      { "2000000000000000000000000000000000000000", k_empty_sha1 }, btree_node::k_unused_pointer),
+    make_node(
+      /*is_leaf=*/true, /*keys_count=*/2u,
+      { btree_node::k_unused_pointer, btree_node::k_unused_pointer, 0u },
+      { "0000000000000000000000000000000000000000", "1000000000000000000000000000000000000000" },
+      btree_node::k_unused_pointer),
+    make_node(
+      /*is_leaf=*/true, /*keys_count=*/3u,
+      { btree_node::k_unused_pointer, btree_node::k_unused_pointer, 0u },
+      { "3000000000000000000000000000000000000000", "4000000000000000000000000000000000000000" },
+      btree_node::k_unused_pointer)
+  };
+
+  memory_storage storage;
+  storage.m_storage = to_storage(k_test_order_value, 0u, nodes);
+
+  node_cache cache{ 1024u * 1024u };
+  btree tree{ storage, &cache };
+  const auto sha1 = details::string_sha1_to_binary("1000000000000000000000000000000000000000");
+  EXPECT_TRUE(tree.contains(sha1));
+
+  // Wipe out all the nodes. The lookup should be served from the cache.
+  std::fill(std::next(std::begin(storage.m_storage), k_file_metadata_size),
+            std::end(storage.m_storage), uint8_t{ 0u });
+
+  EXPECT_TRUE(tree.contains(sha1));
+  EXPECT_THAT(cache.nodes_count(), ::testing::Eq(2u));
+}
+
+// Keys 0x00, 0x04, 0x08, ... on the first two bytes, so 16 of them share every first byte.
+std::vector<sha1_t> make_keys_for_prefix_tests()
+{
+  std::vector<sha1_t> keys(48u);
+
+  for (auto i = 0u; i < keys.size(); ++i) {
+    keys[i][0] = static_cast<uint8_t>(i / 16u);
+    keys[i][1] = static_cast<uint8_t>((i % 16u) * 16u + 4u);
+    keys[i][19] = 1u;
+  }
+
+  return keys;
+}
+
+std::vector<sha1_t> keys_with_prefix(memory_storage& storage, const sha1_t& prefix,
+                                     uint32_t prefix_bits)
+{
+  std::vector<sha1_t> keys;
+  btree tree{ storage };
+  tree.for_each_key_with_prefix(prefix, prefix_bits,
+                                [&keys](const sha1_t& key) { keys.push_back(key); });
+  return keys;
+}
+
+TEST(Btree, ForEachKeyWithPrefix_WholeBytePrefix_ReturnsKeysOfThePrefixInOrder)
+{
+  const auto keys = make_keys_for_prefix_tests();
+  const std::vector<sha1_t> expected(std::next(keys.begin(), 16), std::next(keys.begin(), 32));
+
+  for (auto& tree : make_trees_of_all_layouts(keys)) {
+    EXPECT_THAT(keys_with_prefix(tree, keys[16], /*prefix_bits=*/8u), ElementsAreArray(expected));
+  }
+}
+
+TEST(Btree, ForEachKeyWithPrefix_HalfBytePrefix_ReturnsKeysOfThePrefix)
+{
+  const auto keys = make_keys_for_prefix_tests();
+
+  // Bytes 0x02 0xA? - the prefix of keys[42] is 5 characters long, like in the HIBP range API.
+  for (auto& tree : make_trees_of_all_layouts(keys)) {
+    EXPECT_THAT(keys_with_prefix(tree, keys[42], /*prefix_bits=*/20u), ElementsAre(keys[42]));
+    EXPECT_THAT(keys_with_prefix(tree, keys[42], /*prefix_bits=*/12u), ElementsAre(keys[42]));
+  }
+}
+
+TEST(Btree, ForEachKeyWithPrefix_NoKeyOfThePrefix_ReturnsNothing)
+{
+  const auto keys = make_keys_for_prefix_tests();
+  sha1_t prefix{};
+  prefix[0] = 0x01u;
+  prefix[1] = 0x05u;
+
+  for (auto& tree : make_trees_of_all_layouts(keys)) {
+    EXPECT_THAT(keys_with_prefix(tree, prefix, /*prefix_bits=*/16u), IsEmpty());
+    prefix[0] = 0x03u;
+    EXPECT_THAT(keys_with_prefix(tree, prefix, /*prefix_bits=*/8u), IsEmpty());
+    prefix[0] = 0x01u;
+  }
+}
+
+TEST(Btree, ForEachKeyWithPrefix_EmptyPrefix_ReturnsAllKeys)
+{
+  const auto keys = make_keys_for_prefix_tests();
+
+  for (auto& tree : make_trees_of_all_layouts(keys)) {
+    EXPECT_THAT(keys_with_prefix(tree, sha1_t{}, /*prefix_bits=*/0u), ElementsAreArray(keys));
+  }
+}
+
+TEST(Btree, PinInnerNodes_LookupsDoNotReadInnerNodesFromStorage)
+{
+  const auto keys = make_keys_for_prefix_tests();
+  auto trees = make_trees_of_all_layouts(keys);
+
+  // The first tree has the legacy layout.
+  static_assert(k_legacy_tree == 0u);
+  for (auto i = 1u; i < trees.size(); ++i) {
+    auto& storage = trees[i];
+    const auto header = read_file_header(storage);
+
+    btree tree{ storage };
+    ASSERT_TRUE(tree.pin_inner_nodes(/*lock_in_memory=*/false));
+    ASSERT_THAT(tree.pinned_inner_nodes(), NotNull());
+    EXPECT_THAT(tree.pinned_inner_nodes()->nodes_count(), Eq(header.inner_nodes_count));
+
+    // Wipe out the inner nodes. Lookups should use the pinned ones.
+    const auto inner_size = node_view::max_stored_size(
+      node_format{ node_layout::compact_inner, header.order, header.stored_key_size,
+                   header.has_flag(file_flag_node_summaries) });
+    const auto inner_offset = header.header_size +
+      (header.has_flag(file_flag_bplus_tree) ? header.leaves_size : 0u);
+    const auto inner_begin = std::next(std::begin(storage.m_storage), inner_offset);
+    std::fill_n(inner_begin, inner_size * header.inner_nodes_count, uint8_t{ 0u });
+
+    for (const auto& key : keys) {
+      EXPECT_TRUE(tree.contains(key)) << i;
+    }
+
+    std::vector<sha1_t> found;
+    tree.for_each_key_with_prefix(keys[16], /*prefix_bits=*/8u,
+                                  [&found](const sha1_t& key) { found.push_back(key); });
+    EXPECT_THAT(found.size(), Eq(16u)) << i;
+  }
+}
+
+TEST(Btree, PinInnerNodes_LegacyLayout_PinsNothing)
+{
+  auto trees = make_trees_of_all_layouts(make_keys_for_prefix_tests());
+
+  btree tree{ trees[k_legacy_tree] };
+  EXPECT_TRUE(tree.pin_inner_nodes(/*lock_in_memory=*/false));
+  EXPECT_THAT(tree.pinned_inner_nodes(), IsNull());
+}
+
+TEST(Btree, PartialNodeReads_GiveTheSameResultsAsReadingWholeNodes)
+{
+  // Nodes of the order have more keys than fit into the window of partial reads.
+  constexpr btree_node::order_t order{ 512u };
+  const auto keys = make_random_keys(5000u, 42u);
+  const auto other_keys = make_random_keys(5000u, 24u);
+
+  for (auto& storage : make_trees_of_all_layouts(keys, order)) {
+    const btree whole_nodes_tree{ storage };
+
+    for (const auto pin : { false, true }) {
+      btree tree{ storage };
+      tree.set_partial_node_reads(true);
+      if (pin) {
+        ASSERT_TRUE(tree.pin_inner_nodes(/*lock_in_memory=*/false));
+      }
+
+      for (const auto& key : keys) {
+        EXPECT_THAT(tree.contains(key), Eq(whole_nodes_tree.contains(key)));
+      }
+      for (const auto& key : other_keys) {
+        EXPECT_THAT(tree.contains(key), Eq(whole_nodes_tree.contains(key)));
+      }
+    }
+  }
+}
+
+TEST(Btree, PartialNodeReads_SmallNodes_FindAllKeys)
+{
+  const auto keys = make_keys_for_prefix_tests();
+
+  for (auto& storage : make_trees_of_all_layouts(keys)) {
+    btree tree{ storage };
+    tree.set_partial_node_reads(true);
+
+    for (const auto& key : keys) {
+      EXPECT_TRUE(tree.contains(key));
+    }
+    EXPECT_FALSE(tree.contains(sha1_t{}));
+  }
+}
 }
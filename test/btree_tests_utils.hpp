@@ -1,7 +1,19 @@
 #pragma once
 
+#include "bplus_tree_builder.hpp"
+#include "btree_compactor.hpp"
+#include "btree_sorted_keys_inserter.hpp"
+
+#include "memory_storage.hpp"
+
 #include <gmock/gmock.h>
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
 #define GTEST_COUT std::cerr << "[          ] [ INFO ] "
 
 namespace okon::test {
@@ -192,4 +204,112 @@ MATCHER_P(StorageOrder3Eq, expected, "")
 {
   return storage_eq_impl<3u>(arg, expected);
 }
+
+// Sorted keys without duplicates, uniformly distributed like hashes are.
+inline std::vector<sha1_t> make_random_keys(unsigned count, unsigned seed = 42u)
+{
+  std::mt19937 engine{ seed };
+  std::vector<sha1_t> keys(count);
+
+  for (auto& key : keys) {
+    for (auto& byte : key) {
+      byte = static_cast<uint8_t>(engine());
+    }
+  }
+
+  std::sort(std::begin(keys), std::end(keys));
+  keys.erase(std::unique(std::begin(keys), std::end(keys)), std::end(keys));
+  return keys;
+}
+
+// Indices of the trees returned by make_trees_of_all_layouts().
+enum tree_layout_index : unsigned
+{
+  k_legacy_tree,
+  k_compact_tree,
+  k_compact_compressed_leaves_tree,
+  k_bplus_tree,
+  k_bplus_compressed_leaves_tree,
+  k_compact_summaries_tree,
+  k_bplus_summaries_tree,
+  k_tree_layouts_count
+};
+
+// The keys stored in a tree of every layout, see tree_layout_index. stored_key_size is used by all
+// the layouts but the legacy one, which always stores whole keys.
+inline std::vector<memory_storage> make_trees_of_all_layouts(
+  const std::vector<sha1_t>& keys, btree_node::order_t order = k_test_order_value,
+  uint32_t stored_key_size = 0u)
+{
+  std::vector<memory_storage> trees(k_tree_layouts_count);
+  {
+    btree_sorted_keys_inserter inserter{ trees[k_legacy_tree], order };
+    for (const auto& key : keys) {
+      inserter.insert_sorted(key);
+    }
+    inserter.finalize_inserting();
+  }
+
+  const auto compact = [&](tree_layout_index index, uint32_t flags) {
+    btree_compactor{ trees[k_legacy_tree], trees[index], { flags, stored_key_size } }.compact();
+  };
+
+  const auto bplus = [&](tree_layout_index index, uint32_t flags) {
+    bplus_tree_builder builder{ trees[index], order, { flags, stored_key_size } };
+    for (const auto& key : keys) {
+      builder.insert_sorted(key);
+    }
+    builder.finalize_inserting();
+  };
+
+  compact(k_compact_tree, 0u);
+  compact(k_compact_compressed_leaves_tree, file_flag_prefix_compressed_leaves);
+  compact(k_compact_summaries_tree, file_flag_node_summaries);
+  bplus(k_bplus_tree, 0u);
+  bplus(k_bplus_compressed_leaves_tree, file_flag_prefix_compressed_leaves);
+  bplus(k_bplus_summaries_tree, file_flag_node_summaries);
+
+  return trees;
+}
+
+// File in the temporary directory, removed when the object is destroyed. Named after the running
+// test, so test binaries run in parallel don't share files.
+class temp_file
+{
+public:
+  explicit temp_file(const std::vector<uint8_t>& content)
+    : m_path{ make_path() }
+  {
+    std::ofstream file{ m_path, std::ios::out | std::ios::binary };
+    file.write(reinterpret_cast<const char*>(content.data()),
+               static_cast<std::streamsize>(content.size()));
+  }
+
+  ~temp_file()
+  {
+    std::filesystem::remove(m_path);
+  }
+
+  temp_file(const temp_file&) = delete;
+  temp_file& operator=(const temp_file&) = delete;
+
+  const std::string& path() const
+  {
+    return m_path;
+  }
+
+private:
+  static std::string make_path()
+  {
+    const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+    auto name = std::string{ "okon_" } + info->test_suite_name() + "_" + info->name() + "_" +
+      std::to_string(s_files_count++);
+    std::replace(std::begin(name), std::end(name), '/', '_');
+
+    return (std::filesystem::temp_directory_path() / name).string();
+  }
+
+  static inline unsigned s_files_count{ 0u };
+  std::string m_path;
+};
 }
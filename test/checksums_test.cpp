@@ -0,0 +1,145 @@
+#include "bplus_tree_builder.hpp"
+#include "btree.hpp"
+#include "checksums.hpp"
+
+#include "btree_tests_utils.hpp"
+#include "memory_storage.hpp"
+
+#include <gmock/gmock.h>
+
+#include <string_view>
+
+namespace okon::test {
+using ::testing::Eq;
+
+sha1_t make_sha1(unsigned value)
+{
+  sha1_t sha1{};
+  sha1[0] = static_cast<uint8_t>(value >> 8u);
+  sha1[1] = static_cast<uint8_t>(value);
+  return sha1;
+}
+
+memory_storage make_tree_with_checksums(unsigned keys_count)
+{
+  memory_storage storage;
+  bplus_tree_builder builder{ storage, k_test_order_value };
+
+  for (auto i = 0u; i < keys_count; ++i) {
+    builder.insert_sorted(make_sha1(i));
+  }
+
+  builder.finalize_inserting();
+  append_checksums(storage);
+  return storage;
+}
+
+verify_result verify_all(const memory_storage& storage, unsigned threads_count)
+{
+  return verify_checksums([&storage] { return storage; }, threads_count);
+}
+
+TEST(Crc32c, KnownValue)
+{
+  constexpr std::string_view k_data{ "123456789" };
+  EXPECT_THAT(crc32c(k_data.data(), k_data.size()), Eq(0xe3069283u));
+}
+
+TEST(Crc32c, ComputedInParts_SameAsAtOnce)
+{
+  constexpr std::string_view k_data{ "The quick brown fox jumps over the lazy dog" };
+
+  const auto first = crc32c(k_data.data(), 11u);
+  EXPECT_THAT(crc32c(k_data.data() + 11u, k_data.size() - 11u, first),
+              Eq(crc32c(k_data.data(), k_data.size())));
+}
+
+TEST(Checksums, AppendedChecksums_FileIsValid)
+{
+  auto storage = make_tree_with_checksums(100u);
+
+  EXPECT_TRUE(read_file_header(storage).has_flag(file_flag_checksums));
+  EXPECT_THAT(verify_header(storage), Eq(verify_result::valid));
+  EXPECT_THAT(verify_all(storage, 4u), Eq(verify_result::valid));
+}
+
+TEST(Checksums, AppendedChecksums_TreeContainsAllTheKeys)
+{
+  auto storage = make_tree_with_checksums(100u);
+  btree tree{ storage };
+
+  for (auto i = 0u; i < 100u; ++i) {
+    EXPECT_TRUE(tree.contains(make_sha1(i))) << i;
+  }
+}
+
+TEST(Checksums, NoChecksums_ReportsNoChecksums)
+{
+  memory_storage storage;
+  bplus_tree_builder builder{ storage, k_test_order_value };
+  builder.insert_sorted(make_sha1(0u));
+  builder.finalize_inserting();
+
+  EXPECT_THAT(verify_header(storage), Eq(verify_result::no_checksums));
+  EXPECT_THAT(verify_all(storage, 1u), Eq(verify_result::no_checksums));
+}
+
+TEST(Checksums, ChangedHeader_ReportsCorruptedHeader)
+{
+  auto storage = make_tree_with_checksums(100u);
+  ++storage.m_storage[sizeof(file_header::k_magic) + sizeof(file_format) + sizeof(uint32_t)];
+
+  EXPECT_THAT(verify_header(storage), Eq(verify_result::corrupted_header));
+}
+
+void set_header_size(memory_storage& storage, uint32_t header_size)
+{
+  storage.seek_out(sizeof(file_header::k_magic) + sizeof(file_format));
+  storage.write(&header_size, sizeof(header_size));
+}
+
+TEST(Checksums, HugeHeaderSize_ReportsCorruptedHeader)
+{
+  auto storage = make_tree_with_checksums(100u);
+  set_header_size(storage, 0xffffffffu);
+
+  EXPECT_THAT(verify_header(storage), Eq(verify_result::corrupted_header));
+  EXPECT_THAT(verify_all(storage, 2u), Eq(verify_result::corrupted_header));
+}
+
+TEST(Checksums, HeaderSizeBiggerThanFile_ReportsCorruptedHeader)
+{
+  auto storage = make_tree_with_checksums(1u);
+  set_header_size(storage, static_cast<uint32_t>(storage.m_storage.size() + 1u));
+
+  EXPECT_THAT(verify_header(storage), Eq(verify_result::corrupted_header));
+}
+
+TEST(Checksums, TooSmallHeaderSize_ReportsCorruptedHeader)
+{
+  auto storage = make_tree_with_checksums(100u);
+  set_header_size(storage, file_header::k_compact_header_size - 1u);
+
+  EXPECT_THAT(verify_header(storage), Eq(verify_result::corrupted_header));
+}
+
+TEST(Checksums, TruncatedFile_ReportsTruncated)
+{
+  auto storage = make_tree_with_checksums(100u);
+  storage.m_storage.pop_back();
+
+  EXPECT_THAT(verify_header(storage), Eq(verify_result::truncated));
+  EXPECT_THAT(verify_all(storage, 2u), Eq(verify_result::truncated));
+}
+
+TEST(Checksums, ChangedNode_ReportsCorrupted)
+{
+  auto storage = make_tree_with_checksums(100u);
+  const auto header = read_file_header(storage);
+  ++storage.m_storage[header.header_size + header.leaves_size / 2u];
+
+  // Only blocks are read by the cheap check.
+  EXPECT_THAT(verify_header(storage), Eq(verify_result::valid));
+  EXPECT_THAT(verify_all(storage, 3u), Eq(verify_result::corrupted));
+}
+}
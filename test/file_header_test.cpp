@@ -0,0 +1,105 @@
+#include "file_header.hpp"
+
+#include "memory_storage.hpp"
+
+#include <gmock/gmock.h>
+
+namespace okon::test {
+using ::testing::Eq;
+
+file_header make_compact_header()
+{
+  file_header header;
+  header.format = file_format::compact;
+  header.header_size = file_header::k_compact_header_size;
+  header.order = 1024u;
+  header.root_ptr = 123u;
+  header.inner_nodes_count = 4u;
+  header.leaf_nodes_count = 56u;
+  header.flags = file_flag_bplus_tree;
+  header.stored_key_size = 8u;
+  header.key_size = sizeof(ntlm_t);
+  header.leaves_size = 789u;
+  return header;
+}
+
+TEST(FileHeader, LegacyFile_ReadsOrderAndRootPointer)
+{
+  memory_storage storage;
+  const btree_node::order_t order{ 1024u };
+  const btree_node::pointer_t root_ptr{ 1234u };
+  storage.seek_out(0u);
+  storage.write(&order, sizeof(order));
+  storage.write(&root_ptr, sizeof(root_ptr));
+
+  const auto header = read_file_header(storage);
+
+  EXPECT_THAT(header.format, Eq(file_format::legacy));
+  EXPECT_THAT(header.header_size, Eq(file_header::k_legacy_header_size));
+  EXPECT_THAT(header.order, Eq(order));
+  EXPECT_THAT(header.root_ptr, Eq(root_ptr));
+  EXPECT_THAT(header.key_size, Eq(sizeof(sha1_t)));
+  EXPECT_TRUE(is_supported(header));
+}
+
+TEST(FileHeader, WrittenHeader_ReadsTheSameFields)
+{
+  memory_storage storage;
+  write_file_header(storage, make_compact_header());
+
+  const auto header = read_file_header(storage);
+
+  EXPECT_THAT(storage.total_size(), Eq(file_header::k_compact_header_size));
+  EXPECT_THAT(header.format, Eq(file_format::compact));
+  EXPECT_THAT(header.order, Eq(1024u));
+  EXPECT_THAT(header.root_ptr, Eq(123u));
+  EXPECT_THAT(header.inner_nodes_count, Eq(4u));
+  EXPECT_THAT(header.leaf_nodes_count, Eq(56u));
+  EXPECT_THAT(header.flags, Eq(file_flag_bplus_tree));
+  EXPECT_THAT(header.stored_key_size, Eq(8u));
+  EXPECT_THAT(header.key_size, Eq(sizeof(ntlm_t)));
+  EXPECT_THAT(header.leaves_size, Eq(789u));
+  EXPECT_THAT(header.version, Eq(file_header::k_version));
+  EXPECT_TRUE(is_supported(header));
+}
+
+TEST(FileHeader, OlderHeader_FieldsBeyondItHaveDefaultValues)
+{
+  auto written = make_compact_header();
+  written.header_size = file_header::k_header_checksum_offset;
+  written.checksum_block_size = 1u;
+
+  memory_storage storage;
+  write_file_header(storage, written);
+  // The tree starts right after the shorter header.
+  storage.m_storage.resize(written.header_size);
+  storage.m_storage.resize(written.header_size + 100u, uint8_t{ 0xffu });
+
+  const auto header = read_file_header(storage);
+
+  EXPECT_THAT(header.leaves_size, Eq(789u));
+  EXPECT_THAT(header.checksum_block_size, Eq(1u));
+  EXPECT_THAT(header.header_checksum, Eq(0u));
+  EXPECT_THAT(header.version, Eq(1u));
+  EXPECT_TRUE(is_supported(header));
+}
+
+TEST(FileHeader, UnknownFeatures_NotSupported)
+{
+  auto header = make_compact_header();
+  header.flags |= 1u << 31u;
+  EXPECT_FALSE(is_supported(header));
+
+  header = make_compact_header();
+  header.version = file_header::k_version + 1u;
+  EXPECT_FALSE(is_supported(header));
+
+  header = make_compact_header();
+  header.key_size = 24u;
+  EXPECT_FALSE(is_supported(header));
+
+  header = make_compact_header();
+  header.stored_key_size = header.key_size + 1u;
+  EXPECT_FALSE(is_supported(header));
+}
+}
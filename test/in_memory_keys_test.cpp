@@ -0,0 +1,127 @@
+#include "btree.hpp"
+#include "in_memory_keys.hpp"
+
+#include "btree_tests_utils.hpp"
+#include "memory_storage.hpp"
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <random>
+
+namespace okon::test {
+using ::testing::ElementsAreArray;
+using ::testing::Eq;
+
+// Order big enough to have thousands of keys in a couple of levels.
+constexpr btree_node::order_t k_order{ 50u };
+
+// Trees of all the layouts, storing whole keys and fingerprints.
+std::vector<memory_storage> make_trees(const std::vector<sha1_t>& keys)
+{
+  auto trees = make_trees_of_all_layouts(keys, k_order);
+  for (auto& tree : make_trees_of_all_layouts(keys, k_order, /*stored_key_size=*/6u)) {
+    trees.push_back(std::move(tree));
+  }
+
+  return trees;
+}
+
+TEST(InMemoryKeys, Contains_GivesTheSameResultsAsTree)
+{
+  const auto keys = make_random_keys(3000u);
+  auto absent_keys = make_random_keys(6000u, /*seed=*/24u);
+
+  for (auto& storage : make_trees(keys)) {
+    btree tree{ storage };
+    const in_memory_keys<sha1_t> loaded{ storage };
+    ASSERT_TRUE(loaded.is_loaded());
+    EXPECT_THAT(loaded.keys_count(), Eq(keys.size()));
+
+    for (const auto& key : keys) {
+      EXPECT_TRUE(loaded.contains(key));
+    }
+
+    // Truncated keys give false positives, the same as the tree does.
+    for (const auto& key : absent_keys) {
+      EXPECT_THAT(loaded.contains(key), Eq(tree.contains(key)));
+    }
+  }
+}
+
+TEST(InMemoryKeys, Contains_KeysOutsideOfTheRange_ReturnsFalse)
+{
+  const auto keys = make_random_keys(200u);
+  sha1_t lowest{};
+  sha1_t highest{};
+  highest.fill(0xffu);
+
+  for (auto& storage : make_trees(keys)) {
+    const in_memory_keys<sha1_t> loaded{ storage };
+    EXPECT_FALSE(loaded.contains(lowest));
+    EXPECT_FALSE(loaded.contains(highest));
+  }
+}
+
+TEST(InMemoryKeys, ForEachKeyWithPrefix_GivesTheSameKeysAsTree)
+{
+  const auto keys = make_random_keys(3000u);
+
+  for (auto& storage : make_trees(keys)) {
+    btree tree{ storage };
+    const in_memory_keys<sha1_t> loaded{ storage };
+
+    for (const auto prefix_bits : { 0u, 4u, 8u, 12u, 20u }) {
+      for (const auto& prefix : { keys[0], keys[1000], keys.back() }) {
+        std::vector<sha1_t> expected;
+        tree.for_each_key_with_prefix(prefix, prefix_bits,
+                                      [&expected](const sha1_t& key) { expected.push_back(key); });
+
+        std::vector<sha1_t> found;
+        loaded.for_each_key_with_prefix(prefix, prefix_bits,
+                                        [&found](const sha1_t& key) { found.push_back(key); });
+
+        EXPECT_THAT(found, ElementsAreArray(expected)) << prefix_bits;
+      }
+    }
+  }
+}
+
+TEST(InMemoryKeys, ContainsBatch_GivesTheSameResultsAsContains)
+{
+  const auto keys = make_random_keys(3000u);
+
+  // Present and absent keys, shuffled.
+  auto batch = make_random_keys(2000u, /*seed=*/24u);
+  batch.insert(std::end(batch), std::begin(keys), std::end(keys));
+  std::shuffle(std::begin(batch), std::end(batch), std::mt19937{ 7u });
+
+  for (auto& storage : make_trees(keys)) {
+    const in_memory_keys<sha1_t> loaded{ storage };
+
+    for (const auto count : { 0u, 1u, 5u, 17u, 100u, static_cast<unsigned>(batch.size()) }) {
+      std::vector<int> results(count, -1);
+      loaded.contains_batch(batch.data(), count, [&results](uint64_t index, bool found) {
+        ASSERT_THAT(results[index], Eq(-1));
+        results[index] = found ? 1 : 0;
+      });
+
+      for (auto i = 0u; i < count; ++i) {
+        EXPECT_THAT(results[i], Eq(loaded.contains(batch[i]) ? 1 : 0)) << i;
+      }
+    }
+  }
+}
+
+TEST(InMemoryKeys, EmptyTree_ContainsNothing)
+{
+  memory_storage storage;
+  bplus_tree_builder builder{ storage, k_order, {} };
+  builder.finalize_inserting();
+
+  const in_memory_keys<sha1_t> loaded{ storage };
+  ASSERT_TRUE(loaded.is_loaded());
+  EXPECT_THAT(loaded.keys_count(), Eq(0u));
+  EXPECT_FALSE(loaded.contains(sha1_t{}));
+}
+}
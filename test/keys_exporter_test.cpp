@@ -0,0 +1,109 @@
+#include "bplus_tree_builder.hpp"
+#include "btree_compactor.hpp"
+#include "btree_sorted_keys_inserter.hpp"
+#include "keys_exporter.hpp"
+#include "read_ahead_storage.hpp"
+
+#include "btree_tests_utils.hpp"
+#include "memory_storage.hpp"
+
+#include <gmock/gmock.h>
+
+#include <sstream>
+
+namespace okon::test {
+using ::testing::Eq;
+
+sha1_t make_sha1(unsigned value)
+{
+  sha1_t sha1{};
+  sha1[0] = static_cast<uint8_t>(value >> 8u);
+  sha1[1] = static_cast<uint8_t>(value);
+  sha1[19] = 0xabu;
+  return sha1;
+}
+
+memory_storage make_legacy_tree(unsigned keys_count)
+{
+  memory_storage storage;
+  btree_sorted_keys_inserter inserter{ storage, k_test_order_value };
+
+  for (auto i = 0u; i < keys_count; ++i) {
+    inserter.insert_sorted(make_sha1(i));
+  }
+
+  inserter.finalize_inserting();
+  return storage;
+}
+
+std::string expected_text(unsigned keys_count)
+{
+  std::string text;
+
+  for (auto i = 0u; i < keys_count; ++i) {
+    text += binary_sha1_to_string(make_sha1(i)) + '\n';
+  }
+
+  return text;
+}
+
+std::string export_to_string(memory_storage& storage, export_format format)
+{
+  std::ostringstream output;
+  export_keys<sha1_t>(storage, output, format);
+  return output.str();
+}
+
+TEST(KeysExporter, Text_WritesAllKeysInOrderOnePerLine)
+{
+  constexpr auto keys_count = 50u;
+  auto legacy = make_legacy_tree(keys_count);
+  memory_storage compact;
+  btree_compactor{ legacy, compact }.compact();
+
+  EXPECT_THAT(export_to_string(legacy, export_format::text), Eq(expected_text(keys_count)));
+  EXPECT_THAT(export_to_string(compact, export_format::text), Eq(expected_text(keys_count)));
+}
+
+TEST(KeysExporter, Binary_WritesBytesOfAllKeysInOrder)
+{
+  constexpr auto keys_count = 300u;
+  memory_storage storage;
+  bplus_tree_builder builder{ storage, k_test_order_value };
+  std::string expected;
+
+  for (auto i = 0u; i < keys_count; ++i) {
+    const auto sha1 = make_sha1(i);
+    builder.insert_sorted(sha1);
+    expected.append(reinterpret_cast<const char*>(sha1.data()), sha1.size());
+  }
+
+  builder.finalize_inserting();
+
+  EXPECT_THAT(export_to_string(storage, export_format::binary), Eq(expected));
+}
+
+TEST(KeysExporter, TruncatedKeys_WritesOnlyFingerprints)
+{
+  auto legacy = make_legacy_tree(/*keys_count=*/3u);
+  memory_storage compact;
+  btree_compactor{ legacy, compact, { 0u, /*stored_key_size=*/2u } }.compact();
+
+  EXPECT_THAT(export_to_string(compact, export_format::text), Eq("0000\n0001\n0002\n"));
+}
+
+TEST(KeysExporter, ThroughReadAheadStorage_WritesAllKeys)
+{
+  constexpr auto keys_count = 50u;
+  auto legacy = make_legacy_tree(keys_count);
+  memory_storage compact;
+  btree_compactor{ legacy, compact, { file_flag_prefix_compressed_leaves } }.compact();
+
+  // Small chunks, so nodes span many of them.
+  read_ahead_storage storage{ compact, /*chunk_size=*/7u };
+  std::ostringstream output;
+
+  EXPECT_THAT(export_keys<sha1_t>(storage, output, export_format::text), Eq(keys_count));
+  EXPECT_THAT(output.str(), Eq(expected_text(keys_count)));
+}
+}
@@ -0,0 +1,103 @@
+#include "btree.hpp"
+#include "node_cache.hpp"
+
+#include "btree_tests_utils.hpp"
+#include "memory_storage.hpp"
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+// Counts allocations of the whole test binary.
+std::atomic<uint64_t> g_allocations_count{ 0u };
+}
+
+// The replaced operators are a malloc and free pair, GCC takes it for a mismatch when inlined.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size)
+{
+  ++g_allocations_count;
+  if (auto* ptr = std::malloc(size == 0u ? 1u : size)) {
+    return ptr;
+  }
+
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace okon::test {
+using ::testing::Eq;
+
+constexpr btree_node::order_t k_order{ 8u };
+
+// Number of allocations done by looking up all the keys, after they have been looked up once.
+template <typename Tree>
+uint64_t allocations_of_lookups(const Tree& tree, const std::vector<sha1_t>& keys)
+{
+  for (const auto& key : keys) {
+    tree.contains(key);
+  }
+
+  const auto before = g_allocations_count.load();
+  auto found_count = 0u;
+  for (const auto& key : keys) {
+    found_count += tree.contains(key) ? 1u : 0u;
+  }
+  const auto after = g_allocations_count.load();
+
+  EXPECT_THAT(found_count, Eq(keys.size()));
+  return after - before;
+}
+
+TEST(LookupAllocations, Contains_WithoutCache_DoesNotAllocate)
+{
+  const auto keys = make_random_keys(500u);
+
+  for (auto& storage : make_trees_of_all_layouts(keys, k_order)) {
+    const btree tree{ storage };
+    EXPECT_THAT(allocations_of_lookups(tree, keys), Eq(0u));
+  }
+}
+
+TEST(LookupAllocations, Contains_PinnedInnerNodes_DoesNotAllocate)
+{
+  const auto keys = make_random_keys(500u);
+
+  for (auto& storage : make_trees_of_all_layouts(keys, k_order)) {
+    btree tree{ storage };
+    ASSERT_TRUE(tree.pin_inner_nodes(/*lock_in_memory=*/false));
+    EXPECT_THAT(allocations_of_lookups(tree, keys), Eq(0u));
+  }
+}
+
+TEST(LookupAllocations, Contains_AllNodesCached_DoesNotAllocate)
+{
+  const auto keys = make_random_keys(500u);
+
+  for (auto& storage : make_trees_of_all_layouts(keys, k_order)) {
+    node_cache cache{ 64u * 1024u * 1024u };
+    const btree tree{ storage, &cache };
+    EXPECT_THAT(allocations_of_lookups(tree, keys), Eq(0u));
+  }
+}
+}
@@ -0,0 +1,92 @@
+#include "lookup_metrics.hpp"
+
+#include <gmock/gmock.h>
+
+namespace okon::test {
+using ::testing::Eq;
+
+TEST(LookupMetrics, BucketIndex_SmallValues_AreCountedExactly)
+{
+  for (auto value = 0u; value < 8u; ++value) {
+    EXPECT_THAT(latency_histogram_bucket_index(value), Eq(value));
+  }
+}
+
+TEST(LookupMetrics, BucketIndex_PowerOfTwoIsSplitIntoFourSubBuckets)
+{
+  const auto first_bucket = latency_histogram_bucket_index(1024u);
+
+  EXPECT_THAT(latency_histogram_bucket_index(1279u), Eq(first_bucket));
+  EXPECT_THAT(latency_histogram_bucket_index(1280u), Eq(first_bucket + 1u));
+  EXPECT_THAT(latency_histogram_bucket_index(2047u), Eq(first_bucket + 3u));
+  EXPECT_THAT(latency_histogram_bucket_index(2048u), Eq(first_bucket + 4u));
+}
+
+TEST(LookupMetrics, BucketLowerBound_IsInverseOfBucketIndex)
+{
+  for (auto i = 0u; i < k_latency_histogram_buckets_count; ++i) {
+    const auto lower_bound = latency_histogram_bucket_lower_bound(i);
+    EXPECT_THAT(latency_histogram_bucket_index(lower_bound), Eq(i));
+
+    if (i > 0u) {
+      EXPECT_THAT(latency_histogram_bucket_index(lower_bound - 1u), Eq(i - 1u));
+    }
+  }
+}
+
+TEST(LookupMetrics, BucketIndex_HugeValue_ReturnsLastBucket)
+{
+  EXPECT_THAT(latency_histogram_bucket_index(~uint64_t{ 0u }),
+              Eq(k_latency_histogram_buckets_count - 1u));
+}
+
+TEST(LookupMetrics, BucketLowerBound_IndexPastLastBucket_ReturnsLowerBoundOfLastBucket)
+{
+  const auto last_lower_bound =
+    latency_histogram_bucket_lower_bound(k_latency_histogram_buckets_count - 1u);
+
+  for (const auto index : { k_latency_histogram_buckets_count, 1000u, ~0u }) {
+    EXPECT_THAT(latency_histogram_bucket_lower_bound(index), Eq(last_lower_bound));
+  }
+}
+
+TEST(LookupMetrics, Snapshot_ReturnsRecordedValues)
+{
+  lookup_metrics metrics;
+  metrics.record_node_visit();
+  metrics.record_node_visit();
+  metrics.record_bytes_read(100u);
+  metrics.record_bytes_read(20u);
+  metrics.record_cache_hit();
+  metrics.record_cache_miss();
+  metrics.record_cache_miss();
+  metrics.record_lookup(std::chrono::nanoseconds{ 1500 });
+
+  okon_lookup_metrics result{};
+  metrics.snapshot(result);
+
+  EXPECT_THAT(result.lookups, Eq(1u));
+  EXPECT_THAT(result.nodes_visited, Eq(2u));
+  EXPECT_THAT(result.bytes_read, Eq(120u));
+  EXPECT_THAT(result.cache_hits, Eq(1u));
+  EXPECT_THAT(result.cache_misses, Eq(2u));
+  EXPECT_THAT(result.latency_histogram[latency_histogram_bucket_index(1500u)], Eq(1u));
+}
+
+TEST(LookupMetrics, Reset_ZeroesEverything)
+{
+  lookup_metrics metrics;
+  metrics.record_node_visit();
+  metrics.record_bytes_read(100u);
+  metrics.record_lookup(std::chrono::nanoseconds{ 1500 });
+  metrics.reset();
+
+  okon_lookup_metrics result{};
+  metrics.snapshot(result);
+
+  EXPECT_THAT(result.lookups, Eq(0u));
+  EXPECT_THAT(result.nodes_visited, Eq(0u));
+  EXPECT_THAT(result.bytes_read, Eq(0u));
+  EXPECT_THAT(result.latency_histogram[latency_histogram_bucket_index(1500u)], Eq(0u));
+}
+}
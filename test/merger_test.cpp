@@ -0,0 +1,186 @@
+#include "merger.hpp"
+#include "sorted_keys_merge.hpp"
+
+#include "btree.hpp"
+#include "btree_keys_reader.hpp"
+#include "btree_sorted_keys_inserter.hpp"
+#include "fstream_wrapper.hpp"
+
+#include "btree_tests_utils.hpp"
+#include "memory_storage.hpp"
+
+#include <gmock/gmock.h>
+
+namespace okon::test {
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+using ::testing::Optional;
+
+sha1_t make_sha1(uint8_t first_byte, uint8_t last_byte = 0u)
+{
+  sha1_t sha1{};
+  sha1[0] = first_byte;
+  sha1[19] = last_byte;
+  return sha1;
+}
+
+struct vector_inserter
+{
+  void insert_sorted(const sha1_t& sha1)
+  {
+    keys.push_back(sha1);
+  }
+
+  std::vector<sha1_t> keys;
+};
+
+auto next_key_of(const std::vector<sha1_t>& keys)
+{
+  return [&keys, it = std::cbegin(keys)]() mutable -> std::optional<sha1_t> {
+    if (it == std::cend(keys)) {
+      return std::nullopt;
+    }
+
+    return *it++;
+  };
+}
+
+TEST(MergeSortedKeys, BothEmpty_InsertsNothing)
+{
+  const std::vector<sha1_t> source;
+  const std::vector<sha1_t> delta;
+  vector_inserter inserter;
+
+  EXPECT_THAT(merge_sorted_keys<sha1_t>({ next_key_of(source), next_key_of(delta) }, inserter),
+              Optional(merged_keys_count{ 0u, 0u }));
+  EXPECT_THAT(inserter.keys, IsEmpty());
+}
+
+TEST(MergeSortedKeys, Interleaved_InsertsAllKeysInOrder)
+{
+  const std::vector<sha1_t> source{ make_sha1(1u), make_sha1(4u), make_sha1(5u) };
+  const std::vector<sha1_t> delta{ make_sha1(0u), make_sha1(2u), make_sha1(3u), make_sha1(9u) };
+  vector_inserter inserter;
+
+  EXPECT_THAT(merge_sorted_keys<sha1_t>({ next_key_of(source), next_key_of(delta) }, inserter),
+              Optional(merged_keys_count{ 7u, 0u }));
+  EXPECT_THAT(inserter.keys, ElementsAre(make_sha1(0u), make_sha1(1u), make_sha1(2u),
+                                         make_sha1(3u), make_sha1(4u), make_sha1(5u),
+                                         make_sha1(9u)));
+}
+
+TEST(MergeSortedKeys, Duplicates_InsertsEveryKeyOnceAndCountsCopies)
+{
+  const std::vector<sha1_t> source{ make_sha1(1u), make_sha1(2u), make_sha1(3u) };
+  const std::vector<sha1_t> delta{ make_sha1(1u), make_sha1(1u), make_sha1(3u), make_sha1(4u) };
+  vector_inserter inserter;
+
+  EXPECT_THAT(merge_sorted_keys<sha1_t>({ next_key_of(source), next_key_of(delta) }, inserter),
+              Optional(merged_keys_count{ 4u, 3u }));
+  EXPECT_THAT(inserter.keys,
+              ElementsAre(make_sha1(1u), make_sha1(2u), make_sha1(3u), make_sha1(4u)));
+}
+
+TEST(MergeSortedKeys, ManySequences_InsertsAllKeysInOrderOnce)
+{
+  const std::vector<sha1_t> first{ make_sha1(1u), make_sha1(6u) };
+  const std::vector<sha1_t> second{ make_sha1(2u), make_sha1(6u), make_sha1(7u) };
+  const std::vector<sha1_t> third{ make_sha1(0u), make_sha1(1u), make_sha1(8u) };
+  vector_inserter inserter;
+
+  const auto merged_count = merge_sorted_keys<sha1_t>(
+    { next_key_of(first), next_key_of(second), next_key_of(third) }, inserter);
+
+  EXPECT_THAT(merged_count, Optional(merged_keys_count{ 6u, 2u }));
+  EXPECT_THAT(inserter.keys, ElementsAre(make_sha1(0u), make_sha1(1u), make_sha1(2u),
+                                         make_sha1(6u), make_sha1(7u), make_sha1(8u)));
+}
+
+TEST(MergeSortedKeys, DeltaNotSorted_ReturnsFalse)
+{
+  const std::vector<sha1_t> source{ make_sha1(1u) };
+  const std::vector<sha1_t> delta{ make_sha1(3u), make_sha1(2u) };
+  vector_inserter inserter;
+
+  EXPECT_THAT(merge_sorted_keys<sha1_t>({ next_key_of(source), next_key_of(delta) }, inserter),
+              Eq(std::nullopt));
+}
+
+TEST(MergeSortedKeys, ComparedSize_DeduplicatesKeysOfTheSameFingerprint)
+{
+  const std::vector<sha1_t> source{ make_sha1(1u), make_sha1(2u) };
+  const std::vector<sha1_t> delta{ make_sha1(1u, 5u), make_sha1(3u, 5u) };
+  vector_inserter inserter;
+
+  EXPECT_THAT(merge_sorted_keys<sha1_t>({ next_key_of(source), next_key_of(delta) }, inserter,
+                                        /*compared_size=*/1u),
+              Optional(merged_keys_count{ 3u, 1u }));
+  EXPECT_THAT(inserter.keys, ElementsAre(make_sha1(1u), make_sha1(2u), make_sha1(3u, 5u)));
+}
+
+TEST(MergeSortedKeys, PreparedTree_MergedTreeContainsKeysOfBoth)
+{
+  std::vector<sha1_t> source_keys;
+  std::vector<sha1_t> delta_keys;
+  for (auto i = 0u; i < 40u; ++i) {
+    (i % 3u == 0u ? delta_keys : source_keys).push_back(make_sha1(static_cast<uint8_t>(2u * i)));
+  }
+
+  memory_storage source_storage;
+  {
+    btree_sorted_keys_inserter inserter{ source_storage, k_test_order_value };
+    for (const auto& key : source_keys) {
+      inserter.insert_sorted(key);
+    }
+    inserter.finalize_inserting();
+  }
+
+  memory_storage merged_storage;
+  {
+    btree_keys_reader source{ source_storage };
+    btree_sorted_keys_inserter inserter{ merged_storage, k_test_order_value };
+    const auto merged_count = merge_sorted_keys<sha1_t>(
+      { [&source] { return source.next_key(); }, next_key_of(delta_keys) }, inserter);
+    EXPECT_THAT(merged_count, Optional(merged_keys_count{ 40u, 0u }));
+    inserter.finalize_inserting();
+  }
+
+  btree merged{ merged_storage };
+  for (auto i = 0u; i < 40u; ++i) {
+    EXPECT_TRUE(merged.contains(make_sha1(static_cast<uint8_t>(2u * i)))) << i;
+    EXPECT_FALSE(merged.contains(make_sha1(static_cast<uint8_t>(2u * i + 1u)))) << i;
+  }
+}
+
+TEST(Merger, InvalidLineInDelta_IsSkippedAndCounted)
+{
+  memory_storage source_storage;
+  {
+    btree_sorted_keys_inserter inserter{ source_storage, k_test_order_value };
+    inserter.insert_sorted(make_sha1(2u));
+    inserter.finalize_inserting();
+  }
+
+  // The invalid line is between two sorted keys, so it can't be taken as an unsorted key.
+  const auto delta_text = binary_sha1_to_string(make_sha1(1u)) + ":1\n" + std::string(40u, 'x') +
+    ":1\n" + binary_sha1_to_string(make_sha1(3u)) + ":1\n";
+
+  const temp_file source_file{ source_storage.m_storage };
+  const temp_file delta_file{ std::vector<uint8_t>(delta_text.begin(), delta_text.end()) };
+  const temp_file output_file{ {} };
+  const auto working_directory = std::filesystem::temp_directory_path().string();
+
+  basic_merger<sha1_t> merger{ source_file.path(), delta_file.path(), working_directory,
+                               output_file.path(), [](int) {} };
+  ASSERT_THAT(merger.merge(), Eq(prepare_result::success));
+  EXPECT_THAT(merger.keys_count(), Eq(3u));
+  EXPECT_THAT(merger.invalid_lines_count(), Eq(1u));
+
+  fstream_wrapper output{ output_file.path(), std::ios::in | std::ios::binary };
+  btree merged{ output };
+  for (auto i = 1u; i <= 3u; ++i) {
+    EXPECT_TRUE(merged.contains(make_sha1(static_cast<uint8_t>(i)))) << i;
+  }
+}
+}
@@ -0,0 +1,91 @@
+#include "node_cache.hpp"
+
+#include <gmock/gmock.h>
+
+namespace okon::test {
+using ::testing::Eq;
+using ::testing::IsNull;
+using ::testing::NotNull;
+
+constexpr auto k_cached_node_size{ 100u };
+constexpr unsigned k_leaf_level{ node_cache::k_pinned_levels };
+
+auto make_cached_node(btree_node::pointer_t ptr)
+{
+  auto node = std::make_shared<node_bytes_t>(k_cached_node_size, static_cast<uint8_t>(ptr));
+  return std::shared_ptr<const node_bytes_t>{ std::move(node) };
+}
+
+auto node_cost()
+{
+  return node_cache::node_cost(*make_cached_node(0u));
+}
+
+TEST(NodeCache, Find_Empty_ReturnsNull)
+{
+  node_cache cache{ 10u * node_cost() };
+  EXPECT_THAT(cache.find(0u), IsNull());
+}
+
+TEST(NodeCache, Find_InsertedNode_ReturnsNode)
+{
+  node_cache cache{ 10u * node_cost() };
+  cache.insert(1u, make_cached_node(1u), k_leaf_level);
+
+  const auto result = cache.find(1u);
+  ASSERT_THAT(result, NotNull());
+  EXPECT_THAT(result->front(), Eq(1u));
+  EXPECT_THAT(cache.used_bytes(), Eq(node_cost()));
+}
+
+TEST(NodeCache, Insert_NodeBiggerThanBudget_DoesNotCache)
+{
+  node_cache cache{ node_cost() - 1u };
+  cache.insert(1u, make_cached_node(1u), k_leaf_level);
+
+  EXPECT_THAT(cache.find(1u), IsNull());
+  EXPECT_THAT(cache.used_bytes(), Eq(0u));
+}
+
+TEST(NodeCache, Insert_BudgetExceeded_EvictsNotReferencedNode)
+{
+  node_cache cache{ 2u * node_cost() };
+  cache.insert(1u, make_cached_node(1u), k_leaf_level);
+  cache.insert(2u, make_cached_node(2u), k_leaf_level);
+
+  // Reference the first node, so the second one is the eviction candidate.
+  cache.find(1u);
+
+  cache.insert(3u, make_cached_node(3u), k_leaf_level);
+
+  EXPECT_THAT(cache.find(1u), NotNull());
+  EXPECT_THAT(cache.find(2u), IsNull());
+  EXPECT_THAT(cache.find(3u), NotNull());
+  EXPECT_THAT(cache.nodes_count(), Eq(2u));
+}
+
+TEST(NodeCache, Insert_BudgetExceeded_DoesNotEvictPinnedNode)
+{
+  node_cache cache{ 2u * node_cost() };
+  cache.insert(1u, make_cached_node(1u), /*level=*/0u);
+  cache.insert(2u, make_cached_node(2u), k_leaf_level);
+  cache.insert(3u, make_cached_node(3u), k_leaf_level);
+  cache.insert(4u, make_cached_node(4u), k_leaf_level);
+
+  EXPECT_THAT(cache.find(1u), NotNull());
+  EXPECT_THAT(cache.find(4u), NotNull());
+  EXPECT_THAT(cache.used_bytes(), Eq(2u * node_cost()));
+}
+
+TEST(NodeCache, Insert_PinnedNodesExceedHalfOfBudget_AreEvictable)
+{
+  node_cache cache{ 2u * node_cost() };
+  cache.insert(1u, make_cached_node(1u), /*level=*/0u);
+  cache.insert(2u, make_cached_node(2u), /*level=*/1u);
+  cache.insert(3u, make_cached_node(3u), k_leaf_level);
+
+  EXPECT_THAT(cache.find(1u), NotNull());
+  EXPECT_THAT(cache.find(2u), IsNull());
+  EXPECT_THAT(cache.find(3u), NotNull());
+}
+}
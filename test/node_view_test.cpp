@@ -0,0 +1,236 @@
+#include "node_view.hpp"
+
+#include "btree_tests_utils.hpp"
+
+#include <gmock/gmock.h>
+
+#include <cstring>
+
+namespace okon::test {
+using ::testing::Eq;
+
+constexpr btree_node::order_t k_view_test_order{ 4u };
+constexpr node_format k_prefix_compressed_format{ node_layout::prefix_compressed_leaf,
+                                                  k_view_test_order, sizeof(sha1_t) };
+
+btree_node make_leaf(const std::vector<std::string_view>& keys)
+{
+  btree_node node{ k_view_test_order, btree_node::k_unused_pointer };
+  node.is_leaf = true;
+
+  for (const auto key : keys) {
+    node.push_back(details::string_sha1_to_binary(key.data()));
+  }
+
+  return node;
+}
+
+node_bytes_t to_prefix_compressed_bytes(const btree_node& leaf)
+{
+  const auto prefix_length = common_prefix_length(leaf);
+
+  node_bytes_t bytes(sizeof(leaf.keys_count));
+  std::memcpy(bytes.data(), &leaf.keys_count, sizeof(leaf.keys_count));
+  bytes.push_back(static_cast<uint8_t>(prefix_length));
+  bytes.insert(std::end(bytes), std::cbegin(leaf.keys[0]),
+               std::next(std::cbegin(leaf.keys[0]), prefix_length));
+
+  for (auto i = 0u; i < leaf.keys_count; ++i) {
+    bytes.insert(std::end(bytes), std::next(std::cbegin(leaf.keys[i]), prefix_length),
+                 std::cend(leaf.keys[i]));
+  }
+
+  return bytes;
+}
+
+sha1_t to_sha1(std::string_view sha1)
+{
+  return details::string_sha1_to_binary(sha1.data());
+}
+
+node_view::search_result search(const node_view& view, std::string_view sha1)
+{
+  return view.search(to_sha1(sha1).data());
+}
+
+const auto k_prefixed_leaf = make_leaf({ "ABCD000000000000000000000000000000000001",
+                                         "ABCD000000000000000000000000000000000003",
+                                         "ABCD0000000000000000000000000000000000F0" });
+
+TEST(NodeView, CommonPrefixLength_KeysSharePrefix_ReturnsLengthInBytes)
+{
+  EXPECT_THAT(common_prefix_length(k_prefixed_leaf), Eq(19u));
+}
+
+TEST(NodeView, CommonPrefixLength_SingleKey_ReturnsWholeKey)
+{
+  const auto leaf = make_leaf({ "ABCD000000000000000000000000000000000001" });
+  EXPECT_THAT(common_prefix_length(leaf), Eq(sizeof(sha1_t)));
+}
+
+TEST(NodeView, StoredSize_PrefixCompressedLeaf_EqualsEncodedSize)
+{
+  const auto bytes = to_prefix_compressed_bytes(k_prefixed_leaf);
+  const auto size = node_view::stored_size(k_prefix_compressed_format, bytes.data());
+
+  EXPECT_THAT(size, Eq(bytes.size()));
+  EXPECT_THAT(prefix_compressed_leaf_size(k_prefixed_leaf), Eq(bytes.size()));
+}
+
+TEST(NodeView, Search_PrefixCompressedLeaf_FindsStoredKeys)
+{
+  const auto bytes = to_prefix_compressed_bytes(k_prefixed_leaf);
+  const node_view view{ k_prefix_compressed_format, bytes.data() };
+
+  for (auto i = 0u; i < k_prefixed_leaf.keys_count; ++i) {
+    const auto result = view.search(k_prefixed_leaf.keys[i].data());
+    EXPECT_TRUE(result.found) << i;
+    EXPECT_THAT(result.place, Eq(i));
+    EXPECT_THAT(view.key<sha1_t>(i), Eq(k_prefixed_leaf.keys[i]));
+  }
+}
+
+TEST(NodeView, Search_PrefixCompressedLeaf_DoesNotFindAbsentKeys)
+{
+  const auto bytes = to_prefix_compressed_bytes(k_prefixed_leaf);
+  const node_view view{ k_prefix_compressed_format, bytes.data() };
+
+  const auto less_prefix = search(view, "ABCC000000000000000000000000000000000002");
+  EXPECT_FALSE(less_prefix.found);
+  EXPECT_THAT(less_prefix.place, Eq(0u));
+
+  const auto same_prefix = search(view, "ABCD000000000000000000000000000000000002");
+  EXPECT_FALSE(same_prefix.found);
+  EXPECT_THAT(same_prefix.place, Eq(1u));
+
+  const auto greater_prefix = search(view, "ABCE000000000000000000000000000000000002");
+  EXPECT_FALSE(greater_prefix.found);
+  EXPECT_THAT(greater_prefix.place, Eq(3u));
+}
+
+TEST(NodeView, Search_TruncatedKeys_ComparesOnlyStoredBytes)
+{
+  const auto leaf = make_leaf({ "1111111111111111000000000000000000000000",
+                                "2222222222222222000000000000000000000000" });
+  const auto key_size = 8u;
+
+  node_bytes_t bytes(sizeof(leaf.keys_count));
+  std::memcpy(bytes.data(), &leaf.keys_count, sizeof(leaf.keys_count));
+  for (auto i = 0u; i < leaf.keys_count; ++i) {
+    bytes.insert(std::end(bytes), std::cbegin(leaf.keys[i]),
+                 std::next(std::cbegin(leaf.keys[i]), key_size));
+  }
+
+  const node_view view{ node_format{ node_layout::compact_leaf, k_view_test_order, key_size },
+                        bytes.data() };
+
+  EXPECT_TRUE(search(view, "2222222222222222FFFFFFFFFFFFFFFFFFFFFFFF").found);
+  EXPECT_FALSE(search(view, "2222222222222223000000000000000000000000").found);
+}
+
+TEST(NodeView, Child_CompactInnerNode_ReturnsPointerForPlace)
+{
+  const std::vector<btree_node::pointer_t> pointers{ 7u, 8u, btree_node::k_unused_pointer,
+                                                     btree_node::k_unused_pointer,
+                                                     btree_node::k_unused_pointer };
+  const auto key = to_sha1("5000000000000000000000000000000000000000");
+  const auto keys_count = uint32_t{ 1u };
+
+  node_bytes_t bytes(sizeof(keys_count) + pointers.size() * sizeof(btree_node::pointer_t));
+  std::memcpy(bytes.data(), &keys_count, sizeof(keys_count));
+  std::memcpy(bytes.data() + sizeof(keys_count), pointers.data(),
+              pointers.size() * sizeof(btree_node::pointer_t));
+  bytes.insert(std::end(bytes), std::cbegin(key), std::cend(key));
+
+  const node_view view{
+    node_format{ node_layout::compact_inner, k_view_test_order, sizeof(sha1_t) }, bytes.data()
+  };
+  EXPECT_FALSE(view.is_leaf());
+
+  const auto result = search(view, "6000000000000000000000000000000000000000");
+  EXPECT_FALSE(result.found);
+  EXPECT_THAT(view.child(result.place), Eq(8u));
+}
+
+// Leaf of keys_count keys, every key has its index on the first two bytes, times two, so odd
+// values are absent.
+btree_node make_leaf_with_summary_keys(btree_node::order_t order, uint32_t keys_count)
+{
+  btree_node node{ order, btree_node::k_unused_pointer };
+  node.is_leaf = true;
+
+  for (auto i = 0u; i < keys_count; ++i) {
+    sha1_t key{};
+    key[0] = static_cast<uint8_t>((2u * i) >> 8u);
+    key[1] = static_cast<uint8_t>(2u * i);
+    node.push_back(key);
+  }
+
+  return node;
+}
+
+node_bytes_t to_compact_leaf_with_summary(const btree_node& leaf, const node_format& format)
+{
+  node_bytes_t bytes(sizeof(leaf.keys_count) + node_view::summary_size(format));
+  std::memcpy(bytes.data(), &leaf.keys_count, sizeof(leaf.keys_count));
+  write_summary(leaf, format, bytes.data() + sizeof(leaf.keys_count));
+
+  for (auto i = 0u; i < leaf.keys_count; ++i) {
+    bytes.insert(std::end(bytes), std::cbegin(leaf.keys[i]), std::cend(leaf.keys[i]));
+  }
+
+  return bytes;
+}
+
+TEST(NodeView, SummarySize_IsEntryPerSummaryStepOfOrder)
+{
+  const node_format format{ node_layout::compact_leaf, 100u, sizeof(sha1_t), true };
+  EXPECT_THAT(node_view::summary_size(format), Eq(4u * node_view::k_summary_entry_size));
+
+  const node_format compressed{ node_layout::prefix_compressed_leaf, 100u, sizeof(sha1_t), true };
+  EXPECT_THAT(node_view::summary_size(compressed), Eq(0u));
+}
+
+TEST(NodeView, Search_NodeWithSummary_FindsStoredKeysAndNotAbsentOnes)
+{
+  const btree_node::order_t order{ 100u };
+  const node_format format{ node_layout::compact_leaf, order, sizeof(sha1_t), true };
+
+  for (const auto keys_count : { 0u, 1u, 31u, 32u, 33u, 64u, 65u, 100u }) {
+    const auto leaf = make_leaf_with_summary_keys(order, keys_count);
+    const auto bytes = to_compact_leaf_with_summary(leaf, format);
+    const node_view view{ format, bytes.data() };
+
+    for (auto i = 0u; i < 2u * keys_count + 1u; ++i) {
+      sha1_t key{};
+      key[0] = static_cast<uint8_t>(i >> 8u);
+      key[1] = static_cast<uint8_t>(i);
+
+      const auto result = view.search(key.data());
+      EXPECT_THAT(result.found, Eq(i % 2u == 0u && i / 2u < keys_count)) << keys_count << ' ' << i;
+      EXPECT_THAT(result.place, Eq((i + 1u) / 2u)) << keys_count << ' ' << i;
+    }
+  }
+}
+
+TEST(NodeView, SummaryRange_IsNarrowedToKeysBetweenTwoEntries)
+{
+  const btree_node::order_t order{ 100u };
+  const node_format format{ node_layout::compact_leaf, order, sizeof(sha1_t), true };
+  const auto leaf = make_leaf_with_summary_keys(order, order);
+  const auto bytes = to_compact_leaf_with_summary(leaf, format);
+  const auto* summary = bytes.data() + sizeof(leaf.keys_count);
+
+  // Key 40 is between the entries of keys 32 and 64.
+  const auto range =
+    node_view::summary_range(summary, leaf.keys_count, sizeof(sha1_t), leaf.keys[40].data());
+  EXPECT_THAT(range.first, Eq(33u));
+  EXPECT_THAT(range.count, Eq(31u));
+
+  // Keys after a key of an entry can have its leading bytes too, so they're in the range as well.
+  const auto entry_range =
+    node_view::summary_range(summary, leaf.keys_count, sizeof(sha1_t), leaf.keys[64].data());
+  EXPECT_THAT(entry_range.first, Eq(33u));
+  EXPECT_THAT(entry_range.count, Eq(63u));
+}
+}
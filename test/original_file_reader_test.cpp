@@ -4,6 +4,8 @@
 
 #include <gmock/gmock.h>
 
+#include <random>
+
 namespace okon::test {
 using ::testing::Eq;
 
@@ -170,4 +172,90 @@ TEST(OriginalFileReader, NextSha1_BufferBiggerThanInput_ReturnsHashesAndThenNull
   const auto next_next_result = reader.next_sha1();
   EXPECT_THAT(next_next_result, Eq(std::nullopt));
 }
+
+TEST(OriginalFileReader, NextSha1s_ReturnsAllHashesForAnyBufferSize)
+{
+  std::string content;
+  std::vector<std::string> expected;
+  for (auto i = 0u; i < 100u; ++i) {
+    expected.push_back(binary_sha1_to_string(sha1_t{ static_cast<uint8_t>(i) }));
+    content += expected.back() + ":" + std::to_string(i) + '\n';
+  }
+
+  for (const auto buffer_size : { 40u, 41u, 50u, 97u, 1024u, 64u * 1024u }) {
+    auto storage = to_storage(content);
+    auto reader = make_original_file_reader(storage, buffer_size);
+
+    std::vector<std::string> result;
+    std::array<const char*, 8u> texts{};
+    while (const auto count = reader.next_sha1s(texts.data(), texts.size())) {
+      for (auto i = 0u; i < count; ++i) {
+        result.emplace_back(texts[i], k_text_sha1_length);
+      }
+    }
+
+    EXPECT_THAT(result, Eq(expected));
+  }
+}
+
+TEST(OriginalFileReader, IndexNewLines_FindsAllNewLinesOfTheText)
+{
+  std::mt19937 engine{ 42u };
+  std::string text(1000u + k_text_sha1_length_for_simd, '\n');
+  for (auto& c : text) {
+    c = engine() % 8u == 0u ? '\n' : 'a';
+  }
+
+  for (const auto size : { 0u, 1u, 63u, 64u, 65u, 128u, 1000u }) {
+    std::vector<uint32_t> expected;
+    for (auto i = 0u; i < size; ++i) {
+      if (text[i] == '\n') {
+        expected.push_back(i);
+      }
+    }
+
+    std::vector<uint32_t> positions(size);
+    const auto count = details::index_new_lines(text.data(), size, positions.data());
+    positions.resize(count);
+
+    EXPECT_THAT(positions, Eq(expected));
+  }
+}
+
+TEST(OriginalFileReader, NextSha1_ShortLines_AreSkipped)
+{
+  auto storage = to_storage(std::string{ k_zero_hash } + "\n\nshort\n" + std::string{ k_one_hash } +
+                            ":1\n");
+  auto reader = make_original_file_reader(storage, /*buffer_size=*/1024u);
+
+  EXPECT_THAT(reader.next_sha1(), Eq(k_zero_hash));
+  EXPECT_THAT(reader.next_sha1(), Eq(k_one_hash));
+  EXPECT_THAT(reader.next_sha1(), Eq(std::nullopt));
+}
+
+TEST(OriginalFileReader, NextSha1s_ShortLines_AreSkippedForAnyBufferSize)
+{
+  std::string content;
+  std::vector<std::string> expected;
+  for (auto i = 0u; i < 50u; ++i) {
+    expected.push_back(binary_sha1_to_string(sha1_t{ static_cast<uint8_t>(i) }));
+    content += expected.back() + ":" + std::to_string(i) + "\n\n" +
+      std::string(i % k_text_sha1_length, 'f') + '\n';
+  }
+
+  for (auto buffer_size = 40u; buffer_size < 200u; ++buffer_size) {
+    auto storage = to_storage(content);
+    auto reader = make_original_file_reader(storage, buffer_size);
+
+    std::vector<std::string> result;
+    std::array<const char*, 8u> texts{};
+    while (const auto count = reader.next_sha1s(texts.data(), texts.size())) {
+      for (auto i = 0u; i < count; ++i) {
+        result.emplace_back(texts[i], k_text_sha1_length);
+      }
+    }
+
+    EXPECT_THAT(result, Eq(expected)) << buffer_size;
+  }
+}
 }
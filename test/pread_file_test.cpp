@@ -0,0 +1,87 @@
+#include "btree.hpp"
+#include "pread_file.hpp"
+
+#include "btree_tests_utils.hpp"
+#include "memory_storage.hpp"
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <thread>
+
+namespace okon::test {
+using ::testing::ElementsAreArray;
+using ::testing::Eq;
+
+constexpr btree_node::order_t k_order{ 8u };
+constexpr auto k_threads_count{ 8u };
+
+TEST(PreadFile, ReadAt_ReadsAtTheOffsetWithoutMovingThePosition)
+{
+  const std::vector<uint8_t> content{ 1u, 2u, 3u, 4u, 5u, 6u };
+  const temp_file file{ content };
+  pread_file pread{ file.path() };
+  ASSERT_TRUE(pread.is_open());
+  EXPECT_THAT(pread.total_size(), Eq(content.size()));
+
+  std::vector<uint8_t> read(3u);
+  EXPECT_THAT(pread.read_at(2u, read.data(), read.size()), Eq(3u));
+  EXPECT_THAT(read, ElementsAreArray({ 3u, 4u, 5u }));
+  EXPECT_THAT(pread.tell_in(), Eq(0u));
+
+  pread.seek_in(4u);
+  EXPECT_THAT(pread.read(read.data(), read.size()), Eq(2u));
+  EXPECT_THAT(pread.tell_in(), Eq(6u));
+}
+
+TEST(PreadFile, NotExistingFile_IsNotOpen)
+{
+  const pread_file file{ "okon_pread_file_test_not_existing_file" };
+  EXPECT_FALSE(file.is_open());
+
+  uint8_t byte{ 0u };
+  EXPECT_THAT(file.read_at(0u, &byte, 1u), Eq(0u));
+}
+
+TEST(PreadFile, ConcurrentLookups_GiveTheSameResultsAsSingleThreaded)
+{
+  const auto keys = make_random_keys(2000u, /*seed=*/42u);
+  const auto other_keys = make_random_keys(2000u, /*seed=*/24u);
+
+  for (auto& storage : make_trees_of_all_layouts(keys, k_order)) {
+    const temp_file file{ storage.m_storage };
+    pread_file pread{ file.path() };
+    const btree<pread_file> tree{ pread };
+    const btree<memory_storage> expected_tree{ storage };
+
+    std::vector<bool> expected(other_keys.size());
+    for (auto i = 0u; i < other_keys.size(); ++i) {
+      expected[i] = expected_tree.contains(other_keys[i]);
+    }
+
+    // Every thread looks up all the keys, starting at a different one.
+    std::atomic<unsigned> mismatches_count{ 0u };
+    std::vector<std::thread> threads;
+
+    for (auto t = 0u; t < k_threads_count; ++t) {
+      threads.emplace_back([&, t] {
+        for (auto n = 0u; n < keys.size(); ++n) {
+          const auto i = (n + t * 251u) % keys.size();
+          if (!tree.contains(keys[i])) {
+            ++mismatches_count;
+          }
+          if (i < other_keys.size() && tree.contains(other_keys[i]) != expected[i]) {
+            ++mismatches_count;
+          }
+        }
+      });
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    EXPECT_THAT(mismatches_count.load(), Eq(0u));
+  }
+}
+}
@@ -47,4 +47,90 @@ TEST_P(SIMDSha1ToBinaryTest, ProducesCorrectBinary)
 }
 
 INSTANTIATE_TEST_SUITE_P(TextSha1ToBinary, SIMDSha1ToBinaryTest, testing::ValuesIn(values));
+
+TEST(TextKeyToBinary, Ntlm_ProducesCorrectBinary)
+{
+  const auto text = "0123456789ABCDEFfedcba9876543210 --------------------------------"sv;
+  const auto expected = ntlm_t{ 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+                                0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10 };
+
+  EXPECT_THAT(details::string_key_to_binary<ntlm_t>(text.data()), Eq(expected));
+  EXPECT_THAT(details::simd_string_key_to_binary<ntlm_t>(text.data()), Eq(expected));
+}
+
+TEST(TextKeyToBinary, Sha256_ProducesCorrectBinary)
+{
+  const auto text = "0123456789ABCDEFfedcba98765432100123456789abcdefFEDCBA9876543210"sv;
+  const auto expected =
+    sha256_t{ 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0xFE, 0xDC, 0xBA,
+              0x98, 0x76, 0x54, 0x32, 0x10, 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB,
+              0xCD, 0xEF, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10 };
+
+  EXPECT_THAT(details::string_key_to_binary<sha256_t>(text.data()), Eq(expected));
+  EXPECT_THAT(details::simd_string_key_to_binary<sha256_t>(text.data()), Eq(expected));
+}
+
+TEST(TextKeysToBinary, DecodesAllTheTextsOfTheBatch)
+{
+  std::vector<std::string> lines;
+  std::vector<const char*> texts;
+  std::vector<sha1_t> expected;
+  for (auto i = 0u; i < k_text_keys_batch_size; ++i) {
+    sha1_t key{};
+    for (auto& byte : key) {
+      byte = static_cast<uint8_t>(i * 37u + (&byte - key.data()) * 11u);
+    }
+    expected.push_back(key);
+    lines.push_back(binary_sha1_to_string(key) + ":1\n" + std::string(64u, '-'));
+  }
+  for (const auto& line : lines) {
+    texts.push_back(line.data());
+  }
+
+  std::vector<sha1_t> keys(k_text_keys_batch_size);
+  const auto valid_mask =
+    text_keys_to_binary<sha1_t>(texts.data(), k_text_keys_batch_size, keys.data());
+
+  EXPECT_THAT(valid_mask, Eq(~uint64_t{ 0u }));
+  EXPECT_THAT(keys, Eq(expected));
+}
+
+TEST(TextKeysToBinary, InvalidTexts_AreNotMarkedAsValid)
+{
+  const std::string padding(64u, '-');
+  const std::string texts_storage[] = {
+    "0123456789ABCDEFfedcba987654321001234567" + padding,
+    "0123456789ABCDEFfedcba98765432100123456" + padding,
+    "\n0123456789ABCDEFfedcba98765432100123456" + padding,
+    "0123456789ABCDEFfedcba98765432100123456g" + padding,
+    "G123456789ABCDEFfedcba987654321001234567" + padding,
+    "01234567:9ABCDEFfedcba987654321001234567" + padding,
+    "ffffffffffffffffffffffffffffffffffffffff" + padding,
+  };
+
+  std::vector<const char*> texts;
+  for (const auto& text : texts_storage) {
+    texts.push_back(text.data());
+  }
+
+  std::vector<sha1_t> keys(texts.size());
+  const auto valid_mask =
+    text_keys_to_binary<sha1_t>(texts.data(), static_cast<unsigned>(texts.size()), keys.data());
+
+  EXPECT_THAT(valid_mask, Eq(0b1000001u));
+  EXPECT_THAT(keys[0], Eq(details::string_sha1_to_binary(texts[0])));
+  EXPECT_THAT(keys[6], Eq(details::string_sha1_to_binary(texts[6])));
+}
+
+TEST(TextKeysToBinary, Sha256_ValidatesAllTheCharacters)
+{
+  const std::string valid(64u, 'a');
+  auto invalid = valid;
+  invalid[63] = 'x';
+  const char* texts[] = { valid.data(), invalid.data() };
+
+  std::array<sha256_t, 2u> keys{};
+  EXPECT_THAT(text_keys_to_binary<sha256_t>(texts, 2u, keys.data()), Eq(0b01u));
+  EXPECT_THAT(keys[0], Eq(details::string_key_to_binary<sha256_t>(valid.data())));
+}
 }